@@ -0,0 +1,18 @@
+#version 450 core
+
+layout (binding = 0) uniform sampler2D accumulation;
+layout (binding = 1) uniform sampler2D revealage;
+
+out vec4 color;
+
+// Blended with glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA) over the opaque scene
+void main() {
+	const ivec2 texel = ivec2(gl_FragCoord.xy);
+	const float reveal = texelFetch(revealage, texel, 0).r;
+	if (reveal == 1.f) {
+		discard;
+	}
+
+	const vec4 accumulated = texelFetch(accumulation, texel, 0);
+	color = vec4(accumulated.rgb / max(accumulated.a, 1e-5f), reveal);
+}
\ No newline at end of file
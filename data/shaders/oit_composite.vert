@@ -0,0 +1,7 @@
+#version 450 core
+
+// A triangle covering the whole screen
+void main() {
+	const vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(position * 2.f - 1.f, 0.f, 1.f);
+}
\ No newline at end of file
@@ -1,34 +1,52 @@
-#version 450 core
-
-layout (binding = 0) uniform sampler2D diffuse;
-layout (binding = 1) uniform sampler2D normal;
-layout (binding = 2) uniform sampler2D orm;
-layout (binding = 3) uniform sampler2D emissive;
-layout (binding = 4) uniform sampler2D teamColor;
-layout (binding = 5) uniform sampler2D environment;
-
-layout (location = 1) uniform float alpha_test;
-layout (location = 2) uniform bool show_lighting;
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+
+// Should match DrawData in draw_commands.ixx
+struct DrawData {
+	uvec2 textures[6];
+	uint instance_offset;
+	uint layer_color_offset;
+	uint layer_skip_count;
+	uint layer_index;
+	uint vertex_offset;
+	uint preskinned_offset;
+	uint instance_vertex_count;
+	float alpha_test;
+	uint show_lighting;
+	uint padding;
+};
+
+layout(std430, binding = 6) readonly buffer layoutName6 {
+	DrawData draws[];
+};
 
 in vec2 UV;
 in vec3 tangent_light_direction;
 in vec4 vertexColor;
+flat in uint draw_index;
 
 out vec4 color;
 
 void main() {
 	// color = vec4(1.f, 1.f, 1.f, 1.f);
 
+	const DrawData draw = draws[draw_index];
+	sampler2D diffuse = sampler2D(draw.textures[0]);
+	sampler2D normal_map = sampler2D(draw.textures[1]);
+	sampler2D orm = sampler2D(draw.textures[2]);
+	sampler2D emissive = sampler2D(draw.textures[3]);
+	sampler2D teamColor = sampler2D(draw.textures[4]);
+
 	color = texture(diffuse, UV) * vertexColor;
 	
-	if (show_lighting) {
+	if (draw.show_lighting != 0) {
 		vec3 emissive_texel = texture(emissive, UV).rgb;
 		vec4 orm_texel = texture(orm, UV);
 		vec3 tc_texel = texture(teamColor, UV).rgb;
 		color.rgb = (color.rgb * (1 - orm_texel.w) + color.rgb * tc_texel * orm_texel.w);
 
 		// normal is a 2 channel normal map so we have to deduce the 3rd value
-		vec2 normal_texel = texture(normal, UV).xy * 2.0 - 1.0;
+		vec2 normal_texel = texture(normal_map, UV).xy * 2.0 - 1.0;
 		vec3 normal = vec3(normal_texel, sqrt(1.0 - dot(normal_texel, normal_texel)));
 
 		float lambert = clamp(dot(normal, -tangent_light_direction), 0.f, 1.f);
@@ -37,7 +55,7 @@ void main() {
 	}
 
 
-	if (color.a < alpha_test) {
+	if (color.a < draw.alpha_test) {
 		discard;
 	}
 }
\ No newline at end of file
@@ -1,9 +1,27 @@
-#version 450 core
+#version 460 core
 
 layout (location = 0) uniform mat4 VP;
-layout (location = 4) uniform int layer_skip_count;
-layout (location = 5) uniform int layer_index;
-layout (location = 6) uniform uint instance_vertex_count;
+// The index of the first command of this glMultiDrawElementsIndirect call, gl_DrawID starts at 0 for every call
+layout (location = 1) uniform uint draw_offset;
+
+// Should match DrawData in draw_commands.ixx
+struct DrawData {
+	uvec2 textures[6];
+	uint instance_offset;
+	uint layer_color_offset;
+	uint layer_skip_count;
+	uint layer_index;
+	uint vertex_offset;
+	uint preskinned_offset;
+	uint instance_vertex_count;
+	float alpha_test;
+	uint show_lighting;
+	uint padding;
+};
+
+layout(std430, binding = 6) readonly buffer layoutName6 {
+	DrawData draws[];
+};
 
 layout(std430, binding = 0) buffer layoutName {
     vec4 layer_colors[];
@@ -28,6 +46,7 @@ layout(std430, binding = 5) buffer layoutName5 {
 out vec2 UV;
 out vec3 tangent_light_direction;
 out vec4 vertexColor;
+flat out uint draw_index;
 
 vec2 sign_not_zero(vec2 v) {
 	return vec2((v.x >= 0.f) ? +1.f : -1.f, (v.y >= 0.f) ? +1.f : -1.f);
@@ -42,12 +61,16 @@ vec3 oct_to_float32x3(vec2 e) {
 }
 
 void main() {
-	const uint vertex_index = gl_InstanceID * instance_vertex_count + gl_VertexID;
+	draw_index = draw_offset + gl_DrawID;
+	const DrawData draw = draws[draw_index];
+
+	// gl_VertexID includes the base vertex, which is the offset of the mesh in the shared vertex buffers
+	const uint vertex_index = draw.preskinned_offset + gl_InstanceID * draw.instance_vertex_count + (gl_VertexID - draw.vertex_offset);
 	vec2 xy = unpackSnorm2x16(vertices[vertex_index].x) * 1024.f;
 	vec2 zw = unpackSnorm2x16(vertices[vertex_index].y) * 1024.f;
-	gl_Position = VP * instance_matrices[gl_InstanceID] * vec4(xy, zw.x, 1.f);
+	gl_Position = VP * instance_matrices[draw.instance_offset + gl_InstanceID] * vec4(xy, zw.x, 1.f);
 
 	UV = unpackSnorm2x16(uvs[gl_VertexID]) * 4.f - 1.f;
 	tangent_light_direction = oct_to_float32x3(unpackSnorm2x16(tangent_light_directions[vertex_index]));
-	vertexColor = layer_colors[gl_InstanceID * layer_skip_count + layer_index];
+	vertexColor = layer_colors[draw.layer_color_offset + gl_InstanceID * draw.layer_skip_count + draw.layer_index];
 }
\ No newline at end of file
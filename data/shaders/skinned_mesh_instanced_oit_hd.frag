@@ -0,0 +1,65 @@
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+
+// Should match DrawData in draw_commands.ixx
+struct DrawData {
+	uvec2 textures[6];
+	uint instance_offset;
+	uint layer_color_offset;
+	uint layer_skip_count;
+	uint layer_index;
+	uint vertex_offset;
+	uint preskinned_offset;
+	uint instance_vertex_count;
+	float alpha_test;
+	uint show_lighting;
+	uint padding;
+};
+
+layout(std430, binding = 6) readonly buffer layoutName6 {
+	DrawData draws[];
+};
+
+in vec2 UV;
+in vec3 tangent_light_direction;
+in vec4 vertexColor;
+flat in uint draw_index;
+
+// Weighted blended order independent transparency, see McGuire and Bavoil 2013
+layout (location = 0) out vec4 accumulation;
+layout (location = 1) out float revealage;
+
+void main() {
+	const DrawData draw = draws[draw_index];
+	sampler2D diffuse = sampler2D(draw.textures[0]);
+	sampler2D normal_map = sampler2D(draw.textures[1]);
+	sampler2D orm = sampler2D(draw.textures[2]);
+	sampler2D emissive = sampler2D(draw.textures[3]);
+	sampler2D teamColor = sampler2D(draw.textures[4]);
+
+	vec4 color = texture(diffuse, UV) * vertexColor;
+	
+	if (draw.show_lighting != 0) {
+		vec3 emissive_texel = texture(emissive, UV).rgb;
+		vec4 orm_texel = texture(orm, UV);
+		vec3 tc_texel = texture(teamColor, UV).rgb;
+		color.rgb = (color.rgb * (1 - orm_texel.w) + color.rgb * tc_texel * orm_texel.w);
+
+		// normal is a 2 channel normal map so we have to deduce the 3rd value
+		vec2 normal_texel = texture(normal_map, UV).xy * 2.0 - 1.0;
+		vec3 normal = vec3(normal_texel, sqrt(1.0 - dot(normal_texel, normal_texel)));
+
+		float lambert = clamp(dot(normal, -tangent_light_direction), 0.f, 1.f);
+		color.rgb *= clamp(lambert + 0.1, 0.f, 1.f);
+		color.rgb += emissive_texel;
+	}
+
+	if (color.a < draw.alpha_test) {
+		discard;
+	}
+
+	// Closer and more opaque fragments weigh more
+	const float weight = clamp(pow(min(1.f, color.a * 10.f) + 0.01f, 3.f) * 1e8f * pow(1.f - gl_FragCoord.z * 0.9f, 3.f), 1e-2f, 3e3f);
+	accumulation = vec4(color.rgb * color.a, color.a) * weight;
+	revealage = color.a;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+
+layout (location = 3) uniform vec3 light_direction;
+
+// Should match DrawData in draw_commands.ixx
+struct DrawData {
+	uvec2 textures[6];
+	uint instance_offset;
+	uint layer_color_offset;
+	uint layer_skip_count;
+	uint layer_index;
+	uint vertex_offset;
+	uint preskinned_offset;
+	uint instance_vertex_count;
+	float alpha_test;
+	uint show_lighting;
+	uint padding;
+};
+
+layout(std430, binding = 6) readonly buffer layoutName6 {
+	DrawData draws[];
+};
+
+in vec2 UV;
+in vec3 Normal;
+in vec4 vertexColor;
+flat in uint draw_index;
+
+// Weighted blended order independent transparency, see McGuire and Bavoil 2013
+layout (location = 0) out vec4 accumulation;
+layout (location = 1) out float revealage;
+
+void main() {
+	sampler2D image = sampler2D(draws[draw_index].textures[0]);
+	vec4 color = texture(image, UV) * vertexColor;
+
+	if (draws[draw_index].show_lighting != 0) {
+		float contribution = (dot(Normal, -light_direction) + 1.f) * 0.5f;
+		color.rgb *= clamp(contribution, 0.f, 1.f);
+	}
+
+	if (vertexColor.a == 0.0 || color.a < draws[draw_index].alpha_test) {
+		discard;
+	}
+
+	// Closer and more opaque fragments weigh more
+	const float weight = clamp(pow(min(1.f, color.a * 10.f) + 0.01f, 3.f) * 1e8f * pow(1.f - gl_FragCoord.z * 0.9f, 3.f), 1e-2f, 3e3f);
+	accumulation = vec4(color.rgb * color.a, color.a) * weight;
+	revealage = color.a;
+}
\ No newline at end of file
@@ -1,26 +1,44 @@
-#version 450 core
+#version 460 core
+#extension GL_ARB_bindless_texture : require
 
-layout (binding = 0) uniform sampler2D image;
-
-layout (location = 1) uniform float alpha_test;
-layout (location = 2) uniform bool show_lighting;
 layout (location = 3) uniform vec3 light_direction;
 
+// Should match DrawData in draw_commands.ixx
+struct DrawData {
+	uvec2 textures[6];
+	uint instance_offset;
+	uint layer_color_offset;
+	uint layer_skip_count;
+	uint layer_index;
+	uint vertex_offset;
+	uint preskinned_offset;
+	uint instance_vertex_count;
+	float alpha_test;
+	uint show_lighting;
+	uint padding;
+};
+
+layout(std430, binding = 6) readonly buffer layoutName6 {
+	DrawData draws[];
+};
+
 in vec2 UV;
 in vec3 Normal;
 in vec4 vertexColor;
+flat in uint draw_index;
 
 out vec4 color;
 
 void main() {
+	sampler2D image = sampler2D(draws[draw_index].textures[0]);
 	color = texture(image, UV) * vertexColor;
 
-	if (show_lighting) {
+	if (draws[draw_index].show_lighting != 0) {
 		float contribution = (dot(Normal, -light_direction) + 1.f) * 0.5f;
 		color.rgb *= clamp(contribution, 0.f, 1.f);
 	}
 
-	if (vertexColor.a == 0.0 || color.a < alpha_test) {
+	if (vertexColor.a == 0.0 || color.a < draws[draw_index].alpha_test) {
 		discard;
 	}
 }
\ No newline at end of file
@@ -2,10 +2,14 @@
 
 // Should match the uniform locations in skinned_mesh_hd.vert
 layout (location = 0) uniform mat4 VP;
-layout (location = 4) uniform int instanceID;
+layout (location = 4) uniform uint instance_list_offset;
 layout (location = 6) uniform int layer_skip_count;
 layout (location = 7) uniform int layer_index;
 layout (location = 9) uniform uint instance_vertex_count;
+layout (location = 10) uniform uint instance_offset;
+layout (location = 11) uniform uint layer_color_offset;
+layout (location = 12) uniform uint vertex_offset;
+layout (location = 13) uniform uint preskinned_offset;
 
 layout(std430, binding = 0) buffer layoutName {
     vec4 layer_colors[];
@@ -27,6 +31,11 @@ layout(std430, binding = 5) buffer layoutName5 {
     mat4 instance_matrices[];
 };
 
+// The instances drawn by this call, indexed with gl_InstanceID
+layout(std430, binding = 7) buffer layoutName7 {
+    uint transparent_instances[];
+};
+
 out vec2 UV;
 out vec3 Normal;
 out vec4 vertexColor;
@@ -44,12 +53,18 @@ vec3 oct_to_float32x3(vec2 e) {
 }
 
 void main() {
-	const uint vertex_index = instanceID * instance_vertex_count + gl_VertexID;
+	const uint instanceID = transparent_instances[instance_list_offset + gl_InstanceID];
+	const uint vertex_index = preskinned_offset + instanceID * instance_vertex_count + (gl_VertexID - vertex_offset);
 	vec2 xy = unpackSnorm2x16(vertices[vertex_index].x) * 1024.f;
 	vec2 zw = unpackSnorm2x16(vertices[vertex_index].y) * 1024.f;
-	gl_Position = VP * instance_matrices[instanceID] * vec4(xy, zw.x, 1.f);
+	gl_Position = VP * instance_matrices[instance_offset + instanceID] * vec4(xy, zw.x, 1.f);
 
 	UV = unpackSnorm2x16(uvs[gl_VertexID]) * 4.f - 1.f;
 	Normal = oct_to_float32x3(unpackSnorm2x16(normals[gl_VertexID]));
-	vertexColor = layer_colors[instanceID * layer_skip_count + layer_index];
+	vertexColor = layer_colors[layer_color_offset + instanceID * layer_skip_count + layer_index];
+
+	// The layer is invisible for this instance but not for others drawn by the same call, move all vertices outside of the clip volume
+	if (vertexColor.a <= 0.01f) {
+		gl_Position = vec4(2.f, 2.f, 2.f, 1.f);
+	}
 }
\ No newline at end of file
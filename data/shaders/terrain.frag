@@ -7,10 +7,12 @@ layout (location = 3) uniform bool show_lighting;
 layout (location = 4) uniform vec3 light_direction;
 layout (location = 5) uniform vec2 brush_position;
 layout (location = 6) uniform bool render_brush;
+layout (location = 8) uniform bool show_components;
 
 layout (binding = 17) uniform usampler2D pathing_map_static;
 layout (binding = 18) uniform usampler2D pathing_map_dynamic;
 layout (binding = 19) uniform sampler2D brush;
+layout (binding = 20) uniform usampler2D component_map;
 
 layout (location = 0) in vec2 UV;
 layout (location = 1) in flat uvec4 texture_indices;
@@ -24,6 +26,12 @@ layout(std430, binding = 4) buffer TextureHandles {
 	sampler2DArray textures[];
 };
 
+// A stable, well spread colour per component
+vec3 component_color(uint component) {
+	uint hash = component * 2654435761u;
+	return vec3((hash >> 8) & 0xFFu, (hash >> 16) & 0xFFu, (hash >> 24) & 0xFFu) / 255.f;
+}
+
 vec4 get_fragment(uint id, vec3 uv) {
 	if (id == 0xFFFFu) {
 		return vec4(0, 0, 0, 0);
@@ -53,6 +61,11 @@ void main() {
 		color.rgb = (final & 0xEu) > 0 ? mix(color.rgb, pathing_color, 0.50) : color.rgb;
 	}
 
+	if (show_components) {
+		uint component = texelFetch(component_map, ivec2(pathing_map_uv), 0).r;
+		color.rgb = component == 0 ? color.rgb * 0.25f : mix(color.rgb, component_color(component), 0.5f);
+	}
+
 	if (render_brush) {
 		ivec2 brush_texture_size = textureSize(brush, 0);
 
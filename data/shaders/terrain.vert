@@ -12,6 +12,9 @@ layout (location = 4) out vec2 world_position;
 
 layout (location = 7) uniform ivec2 map_size;
 
+// Should match TerrainChunks::chunk_size
+const int chunk_size = 32;
+
 const vec2[6] position = vec2[6](
 	vec2(1, 1),
 	vec2(0, 1),
@@ -37,9 +40,18 @@ layout(std430, binding = 3) buffer layoutName3 {
     uint terrain_exists[];
 };
 
+// Bottom left tile of the chunks that passed culling, each chunk is chunk_size * chunk_size instances
+layout(std430, binding = 5) buffer layoutName5 {
+    ivec2 visible_chunks[];
+};
+
 
 void main() { 
-	const ivec2 pos = ivec2(gl_InstanceID % (map_size.x - 1), gl_InstanceID / (map_size.x - 1));
+	const int tile = gl_InstanceID % (chunk_size * chunk_size);
+	const ivec2 chunk_pos = visible_chunks[gl_InstanceID / (chunk_size * chunk_size)] + ivec2(tile % chunk_size, tile / chunk_size);
+	// Chunks on the top and right edge stick out of the map
+	const bool inside = chunk_pos.x < map_size.x - 1 && chunk_pos.y < map_size.y - 1;
+	const ivec2 pos = min(chunk_pos, map_size - 2);
 
 	vec2 vPosition = position[gl_VertexID];
 	const ivec2 height_pos = ivec2(vPosition + pos);
@@ -56,8 +68,7 @@ void main() {
 	texture_indices = terrain_texture_list[pos.y * (map_size.x - 1) + pos.x];
 	pathing_map_uv = (vPosition + pos) * 4;	
 
-	const ivec2 pos2 = ivec2(gl_InstanceID % map_size.x, gl_InstanceID / map_size.x);
-	const bool is_ground = terrain_exists[pos2.y * map_size.x + pos2.x] > 0u;
+	const bool is_ground = inside && terrain_exists[pos.y * (map_size.x - 1) + pos.x] > 0u;
 
 	gl_Position = is_ground ? MVP * vec4(vPosition + pos, height, 1) : vec4(2.0, 0.0, 0.0, 1.0);
 	world_position = vPosition + pos;
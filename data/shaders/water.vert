@@ -8,6 +8,9 @@ layout (location = 4) uniform vec4 deep_color_max;
 layout (location = 5) uniform float water_offset;
 layout (location = 7) uniform ivec2 map_size;
 
+// Should match TerrainChunks::chunk_size
+const int chunk_size = 32;
+
 out vec2 UV;
 out vec4 Color;
 
@@ -36,14 +39,23 @@ layout(std430, binding = 2) buffer layoutName3 {
 	uint water_exists[];
 };
 
+// Bottom left tile of the chunks that contain water and passed culling, each chunk is chunk_size * chunk_size instances
+layout(std430, binding = 3) buffer layoutName4 {
+	ivec2 visible_chunks[];
+};
+
 void main() { 
 	// Position of the quad's bottom left vertex
-	ivec2 quad_pos = ivec2(gl_InstanceID % map_size.x, gl_InstanceID / map_size.x);
-	
-	bool is_water = water_exists[quad_pos.y * map_size.x + quad_pos.x] > 0u
+	const int tile = gl_InstanceID % (chunk_size * chunk_size);
+	const ivec2 chunk_pos = visible_chunks[gl_InstanceID / (chunk_size * chunk_size)] + ivec2(tile % chunk_size, tile / chunk_size);
+	// Chunks on the top and right edge stick out of the map
+	const bool inside = chunk_pos.x < map_size.x - 1 && chunk_pos.y < map_size.y - 1;
+	ivec2 quad_pos = min(chunk_pos, map_size - 2);
+
+	bool is_water = inside && (water_exists[quad_pos.y * map_size.x + quad_pos.x] > 0u
 				 || water_exists[quad_pos.y * map_size.x + quad_pos.x + 1] > 0u
 				 || water_exists[(quad_pos.y + 1) * map_size.x + quad_pos.x] > 0u
-				 || water_exists[(quad_pos.y + 1) * map_size.x + quad_pos.x + 1] > 0u;
+				 || water_exists[(quad_pos.y + 1) * map_size.x + quad_pos.x + 1] > 0u);
 
 	UV = vec2(position[gl_VertexID].x, 1.f - position[gl_VertexID].y);
 
@@ -6,8 +6,48 @@ export module DoodadsUndo;
 
 import std;
 import Doodads;
+import Terrain;
+import SkinnedMesh;
+import SkeletalModelInstance;
+import Utilities;
 import WorldUndoManager;
 
+/// The animation state of a doodad is larger than the rest of it and is rebuilt from its mesh, so the history keeps doodads without it
+void strip_skeletons(std::vector<Doodad>& doodads) {
+	for (auto& i : doodads) {
+		i.skeleton = SkeletalModelInstance();
+	}
+	doodads.shrink_to_fit();
+}
+
+void rebuild_skeleton(Doodad& doodad, const Terrain& terrain) {
+	doodad.skeleton = SkeletalModelInstance(doodad.mesh->model, doodad.mesh->topology);
+	doodad.update(terrain);
+}
+
+/// Takes the state of the stored doodad while the live doodad keeps its animation.
+/// The model may have changed since the state was stored, the animation of the other model would not match the mesh so it is rebuilt
+void restore_state(Doodad& target, const Doodad& state, const Terrain& terrain) {
+	if (target.mesh != state.mesh) {
+		target = state;
+		rebuild_skeleton(target, terrain);
+		return;
+	}
+
+	SkeletalModelInstance skeleton = std::move(target.skeleton);
+	target = state;
+	target.skeleton = std::move(skeleton);
+	target.update(terrain);
+}
+
+size_t doodads_memory_size(const std::vector<Doodad>& doodads) {
+	size_t bytes = doodads.capacity() * sizeof(Doodad);
+	for (const auto& i : doodads) {
+		bytes += i.item_sets.capacity() * sizeof(ItemSet);
+	}
+	return bytes;
+}
+
 // Undo/redo structures
 export class DoodadAddAction final : public WorldCommand {
 public:
@@ -20,8 +60,19 @@ public:
 
 	void redo(WorldEditContext& ctx) override {
 		ctx.doodads.doodads.insert(ctx.doodads.doodads.end(), doodads.begin(), doodads.end());
+		for (auto i = ctx.doodads.doodads.end() - doodads.size(); i != ctx.doodads.doodads.end(); ++i) {
+			rebuild_skeleton(*i, ctx.terrain);
+		}
 		ctx.doodads.update_doodad_pathing(doodads, ctx.pathing_map);
 	}
+
+	size_t memory_size() const override {
+		return sizeof(DoodadAddAction) + doodads_memory_size(doodads);
+	}
+
+	void compact() override {
+		strip_skeletons(doodads);
+	}
 };
 
 export class DoodadDeleteAction final : public WorldCommand {
@@ -34,6 +85,9 @@ public:
 		}
 
 		ctx.doodads.doodads.insert(ctx.doodads.doodads.end(), doodads.begin(), doodads.end());
+		for (auto i = ctx.doodads.doodads.end() - doodads.size(); i != ctx.doodads.doodads.end(); ++i) {
+			rebuild_skeleton(*i, ctx.terrain);
+		}
 		ctx.doodads.update_doodad_pathing(doodads, ctx.pathing_map);
 	}
 
@@ -46,6 +100,13 @@ public:
 		ctx.doodads.update_doodad_pathing(doodads, ctx.pathing_map);
 	}
 
+	size_t memory_size() const override {
+		return sizeof(DoodadDeleteAction) + doodads_memory_size(doodads);
+	}
+
+	void compact() override {
+		strip_skeletons(doodads);
+	}
 
 };
 
@@ -65,7 +126,7 @@ public:
 					update_pathing_area |= { j.position.x, j.position.y, 1.f, 1.f };
 					update_pathing_area |= { i.position.x, i.position.y, 1.f, 1.f };
 
-					j = i;
+					restore_state(j, i, ctx.terrain);
 				}
 			}
 		}
@@ -83,12 +144,21 @@ public:
 					update_pathing_area |= { j.position.x, j.position.y, 1.f, 1.f };
 					update_pathing_area |= { i.position.x, i.position.y, 1.f, 1.f };
 
-					j = i;
+					restore_state(j, i, ctx.terrain);
 				}
 			}
 		}
 		ctx.doodads.update_doodad_pathing(update_pathing_area, ctx.pathing_map);
 	}
+
+	size_t memory_size() const override {
+		return sizeof(DoodadStateAction) + doodads_memory_size(old_doodads) + doodads_memory_size(new_doodads);
+	}
+
+	void compact() override {
+		strip_skeletons(old_doodads);
+		strip_skeletons(new_doodads);
+	}
 };
 
 
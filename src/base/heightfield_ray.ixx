@@ -0,0 +1,100 @@
+export module HeightfieldRay;
+
+import std;
+import Picking;
+import <glm/glm.hpp>;
+
+/// Intersects a ray with a heightfield of width * height corners (row major) where corner (i, j) lies at world (i, j).
+/// Every tile is split into the triangles terrain.vert draws, along the diagonal from its bottom left to its top right corner.
+/// The tiles under the ray are walked front to back with a 2D DDA, so the first hit found is the nearest one.
+/// Cliffs and ramps are only represented as far as they are baked into the heights, like Terrain::final_ground_heights
+export std::optional<glm::vec3> intersect_heightfield(
+	const std::span<const float> heights,
+	const int width,
+	const int height,
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float max_distance
+) {
+	if (width < 2 || height < 2) {
+		return {};
+	}
+
+	// Clip the ray to the columns above the map
+	const glm::vec3 inverse_direction = 1.f / direction;
+	float t_enter = 0.f;
+	float t_exit = max_distance;
+	for (int axis = 0; axis < 2; axis++) {
+		const float limit = axis == 0 ? width - 1.f : height - 1.f;
+		if (direction[axis] == 0.f) {
+			if (origin[axis] < 0.f || origin[axis] > limit) {
+				return {};
+			}
+			continue;
+		}
+		const float t1 = (0.f - origin[axis]) * inverse_direction[axis];
+		const float t2 = (limit - origin[axis]) * inverse_direction[axis];
+		t_enter = std::max(t_enter, std::min(t1, t2));
+		t_exit = std::min(t_exit, std::max(t1, t2));
+	}
+	if (t_enter > t_exit) {
+		return {};
+	}
+
+	const glm::vec3 start = origin + direction * t_enter;
+	int x = std::clamp(static_cast<int>(std::floor(start.x)), 0, width - 2);
+	int y = std::clamp(static_cast<int>(std::floor(start.y)), 0, height - 2);
+
+	const int step_x = direction.x > 0.f ? 1 : -1;
+	const int step_y = direction.y > 0.f ? 1 : -1;
+	// Distance along the ray to the next vertical/horizontal grid line and between two of them
+	const float delta_x = direction.x != 0.f ? std::abs(inverse_direction.x) : std::numeric_limits<float>::infinity();
+	const float delta_y = direction.y != 0.f ? std::abs(inverse_direction.y) : std::numeric_limits<float>::infinity();
+	float next_x = direction.x != 0.f ? ((x + (step_x > 0 ? 1 : 0)) - origin.x) * inverse_direction.x : std::numeric_limits<float>::infinity();
+	float next_y = direction.y != 0.f ? ((y + (step_y > 0 ? 1 : 0)) - origin.y) * inverse_direction.y : std::numeric_limits<float>::infinity();
+
+	float t_cell = t_enter;
+	while (t_cell <= t_exit) {
+		const float t_cell_exit = std::min({ next_x, next_y, t_exit });
+
+		const float bottom_left = heights[y * width + x];
+		const float bottom_right = heights[y * width + x + 1];
+		const float top_left = heights[(y + 1) * width + x];
+		const float top_right = heights[(y + 1) * width + x + 1];
+
+		// Skip the triangle tests when the ray stays above or below the whole tile
+		const float ray_low = std::min(origin.z + direction.z * t_cell, origin.z + direction.z * t_cell_exit);
+		const float ray_high = std::max(origin.z + direction.z * t_cell, origin.z + direction.z * t_cell_exit);
+		if (ray_low <= std::max({ bottom_left, bottom_right, top_left, top_right }) && ray_high >= std::min({ bottom_left, bottom_right, top_left, top_right })) {
+			const glm::vec3 a = { x, y, bottom_left };
+			const glm::vec3 b = { x + 1, y, bottom_right };
+			const glm::vec3 c = { x + 1, y + 1, top_right };
+			const glm::vec3 d = { x, y + 1, top_left };
+
+			std::optional<float> nearest = ray_triangle_distance(origin, direction, c, d, a);
+			const std::optional<float> second = ray_triangle_distance(origin, direction, a, b, c);
+			if (second && (!nearest || *second < *nearest)) {
+				nearest = second;
+			}
+			if (nearest && *nearest <= max_distance) {
+				return origin + direction * *nearest;
+			}
+		}
+
+		if (next_x < next_y) {
+			x += step_x;
+			t_cell = next_x;
+			next_x += delta_x;
+		} else {
+			y += step_y;
+			t_cell = next_y;
+			next_y += delta_y;
+		}
+
+		if (x < 0 || x > width - 2 || y < 0 || y > height - 2) {
+			break;
+		}
+	}
+
+	return {};
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 module;
 
 #include <QMessageBox>
+#include <QSettings>
+#include <QRect>
 
 export module Map;
 
@@ -28,6 +30,16 @@ import TableModel;
 import Globals;
 import Units;
 import Doodads;
+import SkeletalModelInstance;
+import SkeletonBatch;
+import SkinnedMesh;
+import Visibility;
+import HeightfieldRay;
+import Walkability;
+import Pathfinding;
+import FrameArena;
+import Profiler;
+import Shader;
 import <ankerl/unordered_dense.h>;
 import Triggers;
 import Terrain;
@@ -71,7 +83,9 @@ export class Map: public QObject {
 	bool render_brush = true;
 	bool render_lighting = true;
 	bool render_wireframe = false;
+	bool render_weighted_transparency = false; // Order independent transparency for alpha blended layers instead of sorting
 	bool render_debug = false;
+	bool render_walkability = false; // Colours the walkable regions, relabeled in render() after the pathing changes
 
 	glm::vec3 light_direction = glm::normalize(glm::vec3(1.f, 1.f, -3.f));
 
@@ -80,6 +94,36 @@ export class Map: public QObject {
 
 	RenderManager render_manager;
 
+	// Scratch space for batching the skeleton evaluations in update(), kept around to avoid reallocating every frame
+	std::vector<u8> unit_evaluation_due;
+	std::vector<u8> doodad_evaluation_due;
+	ankerl::unordered_dense::map<SkinnedMesh*, std::vector<SkeletalModelInstance*>> skeleton_batches;
+
+	// Ground pathfinders per footprint in cells, repaired from the changed pathing cells before a query
+	std::unordered_map<int, HierarchicalPathfinder> ground_pathfinders;
+	// The pathfinders for the footprints of the ground units, built on workers after loading, and the cells changed since they started.
+	// A query waits for the build of its footprint and takes the other builds that are done
+	std::unordered_map<int, std::future<HierarchicalPathfinder>> ground_pathfinder_builds;
+	QRect ground_pathfinder_build_changes;
+
+	// The pathing_map.cells_version the walkability overlay was labeled from. While the pathing keeps changing it is relabeled at most every interval
+	size_t walkability_version = 0;
+	Timer walkability_timer;
+	static constexpr double walkability_interval_ms = 100.0;
+	// The relabeling of the walkability overlay running on a worker and the cells_version it labels
+	std::future<PathingComponents> walkability_labeling;
+	size_t walkability_labeling_version = 0;
+
+	// Which objects intersect the view frustum, computed once per frame in update() and used by both the animation and the rendering
+	VisibilitySet unit_visibility;
+	VisibilitySet item_visibility;
+	VisibilitySet doodad_visibility;
+	VisibilitySet special_doodad_visibility;
+
+	// The visible objects of the frame, gathered per block of objects in parallel
+	std::vector<std::vector<RenderManager::QueuedInstance>> render_blocks;
+	frame_vector<RenderManager::QueuedInstance> render_queue;
+
 	void load(const fs::path& path) {
 		Timer timer;
 
@@ -350,6 +394,13 @@ export class Map: public QObject {
 		doodads.create(terrain, pathing_map);
 
 		std::println("Doodad loading:\t {:>5}ms", timer.elapsed_ms());
+		if (!doodads.doodads.empty()) {
+			size_t skeleton_bytes = 0;
+			for (const auto& i : doodads.doodads) {
+				skeleton_bytes += i.skeleton.memory_usage();
+			}
+			std::println("Doodad skeletons: {} bytes per doodad", skeleton_bytes / doodads.doodads.size());
+		}
 		timer.reset();
 
 		if (hierarchy.map_file_exists("war3map.w3u")) {
@@ -422,10 +473,15 @@ export class Map: public QObject {
 		std::println("Misc loading:\t {:>5}ms", timer.elapsed_ms());
 		timer.reset();
 
+		// Includes the shaders loaded before the map, like those of the RenderManager
+		std::println("Shaders:\t {:>5}ms, {} from the binary cache, {} compiled", Shader::load_ms, Shader::cache_hits, Shader::compiled);
+
 		// Center camera
 		camera.position = glm::vec3(terrain.width / 2, terrain.height / 2, 0);
 		camera.position.z = terrain.interpolated_height(camera.position.x, camera.position.y, true);
 
+		build_ground_pathfinders();
+
 		loaded = true;
 
 		connect(
@@ -556,7 +612,9 @@ export class Map: public QObject {
 			mode = ScriptMode::lua;
 		}
 
-		const auto result = triggers.generate_map_script(terrain, units, doodads, info, sounds, regions, cameras, mode);
+		QSettings settings;
+		const bool pack_preplaced_objects = settings.value("packPreplacedObjects", "False").toString() != "False";
+		const auto result = triggers.generate_map_script(terrain, units, doodads, info, sounds, regions, cameras, mode, pack_preplaced_objects);
 		if (!result.has_value()) {
 			QMessageBox::information(nullptr, "vJass output", "There were compilation errors:\n" + QString::fromStdString(result.error()), QMessageBox::StandardButton::Ok);
 		}
@@ -588,112 +646,356 @@ export class Map: public QObject {
 
 		// Map mouse coordinates to world coordinates
 		if (input_handler.mouse != input_handler.previous_mouse) {
+			ProfileScope scope("mouse ray");
 			glm::vec3 window = {input_handler.mouse.x, height - input_handler.mouse.y, 1.f};
 			glm::vec3 pos = glm::unProject(window, camera.view, camera.projection, glm::vec4(0, 0, width, height));
 			glm::vec3 origin = camera.position - camera.direction * camera.distance;
 			glm::vec3 direction = glm::normalize(pos - origin);
-			glm::vec3 toto = origin + direction * 2000.f;
-
-			btVector3 from(origin.x, origin.y, origin.z);
-			btVector3 to(toto.x, toto.y, toto.z);
 
-			btCollisionWorld::ClosestRayResultCallback res(from, to);
-			res.m_collisionFilterGroup = 32;
-			res.m_collisionFilterMask = 32;
-			physics.dynamicsWorld->rayTest(from, to, res);
-
-			if (res.hasHit()) {
-				auto& hit = res.m_hitPointWorld;
+			const auto hit = intersect_heightfield(terrain.final_ground_heights, terrain.width, terrain.height, origin, direction, 2000.f);
+			if (hit) {
 				input_handler.previous_mouse_world = input_handler.mouse_world;
-				input_handler.mouse_world = glm::vec3(hit.x(), hit.y(), hit.z());
+				input_handler.mouse_world = *hit;
 			}
 		}
 
+		SkeletalModelInstance::skeletal_evaluations = 0;
+
+		{
+			ProfileScope scope("visibility");
+			update_visibility();
+		}
+
+		ProfileScope animation_scope("animation");
+
+		// Instances that are small on screen or outside of the view frustum are animated at a reduced rate
+		const auto skeleton_lod = [&](const SkeletalModelInstance& skeleton, const bool visible) {
+			glm::vec3 min;
+			glm::vec3 max;
+			skeleton_bounds(skeleton, min, max);
+			return animation_lod(camera, min, max, visible);
+		};
+
 		// Animate units
+		unit_evaluation_due.resize(units.units.size());
 		std::for_each(std::execution::par_unseq, units.units.begin(), units.units.end(), [&](Unit& i) {
+			const size_t index = &i - units.units.data();
 			if (i.id == "sloc") {
+				unit_evaluation_due[index] = false;
 				return;
 			} // ToDo handle starting locations
 
-			mdx::Extent& extent = i.mesh->model->sequences[i.skeleton.sequence_index].extent;
-			if (!camera.inside_frustrum(
-					i.skeleton.matrix * glm::vec4(extent.minimum, 1.f),
-					i.skeleton.matrix * glm::vec4(extent.maximum, 1.f)
-				)) {
-				return;
-			}
-
-			i.skeleton.update(delta);
+			unit_evaluation_due[index] = i.skeleton.advance(delta, skeleton_lod(i.skeleton, unit_visibility.visible(index)));
 		});
 
 		// Animate items
-		for (auto& i : units.items) {
-			i.skeleton.update(delta);
+		for (size_t i = 0; i < units.items.size(); i++) {
+			units.items[i].skeleton.update(delta, skeleton_lod(units.items[i].skeleton, item_visibility.visible(i)));
 		}
 
 		// Animate doodads
+		doodad_evaluation_due.resize(doodads.doodads.size());
 		std::for_each(std::execution::par_unseq, doodads.doodads.begin(), doodads.doodads.end(), [&](Doodad& i) {
-			mdx::Extent& extent = i.mesh->model->sequences[i.skeleton.sequence_index].extent;
-			if (!camera.inside_frustrum(
-					i.skeleton.matrix * glm::vec4(extent.minimum, 1.f),
-					i.skeleton.matrix * glm::vec4(extent.maximum, 1.f)
-				)) {
+			const size_t index = &i - doodads.doodads.data();
+			doodad_evaluation_due[index] = i.skeleton.advance(delta, skeleton_lod(i.skeleton, doodad_visibility.visible(index)));
+		});
+
+		// The skeletons that are due for an evaluation are grouped per model and evaluated in batches
+		for (auto& [mesh, batch] : skeleton_batches) {
+			batch.clear();
+		}
+
+		for (size_t i = 0; i < units.units.size(); i++) {
+			if (unit_evaluation_due[i]) {
+				skeleton_batches[units.units[i].mesh.get()].push_back(&units.units[i].skeleton);
+			}
+		}
+
+		for (size_t i = 0; i < doodads.doodads.size(); i++) {
+			if (doodad_evaluation_due[i]) {
+				skeleton_batches[doodads.doodads[i].mesh.get()].push_back(&doodads.doodads[i].skeleton);
+			}
+		}
+
+		std::for_each(std::execution::par, skeleton_batches.begin(), skeleton_batches.end(), [](auto& entry) {
+			if (!entry.second.empty()) {
+				update_nodes_batched(*entry.first->topology, entry.second);
+			}
+		});
+	}
+
+	/// Labels the regions that ground units, air units and buildings can reach, shows the walkable ones in the walkability overlay
+	/// and reports the largest regions and the start locations from which no other start location can be reached
+	void analyze_walkability() {
+		Timer timer;
+
+		const PathingComponents walkable = label_pathing_components(pathing_map.pathing_cells_static, pathing_map.pathing_cells_dynamic, pathing_map.width, pathing_map.height, PathingMap::Flags::unwalkable);
+		const PathingComponents flyable = label_pathing_components(pathing_map.pathing_cells_static, pathing_map.pathing_cells_dynamic, pathing_map.width, pathing_map.height, PathingMap::Flags::unflyable);
+		const PathingComponents buildable = label_pathing_components(pathing_map.pathing_cells_static, pathing_map.pathing_cells_dynamic, pathing_map.width, pathing_map.height, PathingMap::Flags::unbuildable);
+		const double analysis_ms = timer.elapsed_ms();
+
+		pathing_map.upload_components(walkable);
+		walkability_version = pathing_map.cells_version;
+		walkability_timer.reset();
+
+		std::println("Pathing regions of {}x{} cells analyzed in {:.1f}ms", pathing_map.width, pathing_map.height, analysis_ms);
+		const std::array<std::pair<std::string_view, const PathingComponents*>, 3> kinds = { { { "Walkable", &walkable }, { "Flyable", &flyable }, { "Buildable", &buildable } } };
+		for (const auto& [kind, components] : kinds) {
+			// Sizes are sorted largest first
+			const size_t shown = std::min<size_t>(components->count(), 5);
+			std::println("{}:\t {} regions, largest {} cells", kind, components->count(), std::span(components->sizes).subspan(1, shown));
+		}
+
+		std::vector<glm::ivec2> start_locations;
+		std::vector<int> start_players;
+		for (const auto& unit : units.units) {
+			if (unit.id == "sloc") {
+				start_locations.push_back(glm::ivec2(glm::floor(glm::vec2(unit.position) * 4.f)));
+				start_players.push_back(unit.player);
+			}
+		}
+		for (const auto i : isolated_start_locations(walkable, start_locations)) {
+			const u32 region = walkable.label(start_locations[i].x, start_locations[i].y);
+			if (region == 0) {
+				std::println("Start location of player {} at cell ({}, {}) is on unwalkable pathing", start_players[i] + 1, start_locations[i].x, start_locations[i].y);
+			} else {
+				std::println("Start location of player {} at cell ({}, {}) can't reach any other start location, its region has {} cells", start_players[i] + 1, start_locations[i].x, start_locations[i].y, walkable.sizes[region]);
+			}
+		}
+	}
+
+	/// Relabels only the walkable regions for the overlay, without the report of analyze_walkability().
+	/// Labeling a large map takes tens of milliseconds, so it runs on a worker from a copy of the cells and the labels are uploaded in a later frame once it is done
+	void update_walkability_overlay() {
+		if (walkability_labeling.valid()) {
+			if (walkability_labeling.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
 				return;
 			}
+			const PathingComponents walkable = walkability_labeling.get();
+			// analyze_walkability() may have labeled newer cells in the meantime, or the map may have been resized
+			if (walkability_labeling_version > walkability_version && walkable.width == pathing_map.width && walkable.height == pathing_map.height) {
+				pathing_map.upload_components(walkable);
+				walkability_version = walkability_labeling_version;
+			}
+		}
 
-			i.skeleton.update(delta);
+		if (walkability_version == pathing_map.cells_version || walkability_timer.elapsed_ms() < walkability_interval_ms) {
+			return;
+		}
+		walkability_labeling_version = pathing_map.cells_version;
+		walkability_timer.reset();
+		walkability_labeling = std::async(std::launch::async, [static_cells = pathing_map.pathing_cells_static, dynamic_cells = pathing_map.pathing_cells_dynamic, width = pathing_map.width, height = pathing_map.height] {
+			return label_pathing_components(static_cells, dynamic_cells, width, height, PathingMap::Flags::unwalkable);
 		});
 	}
 
+	/// Starts building the pathfinders for the footprints of the ground units on workers, building one takes about a second on the largest maps
+	void build_ground_pathfinders() {
+		std::set<int> footprints;
+		for (size_t i = 0; i < units_slk.rows(); i++) {
+			const std::string& id = units_slk.index_to_row.at(i);
+			const std::string move_type = units_slk.data("movetp", id);
+			if (!move_type.empty() && move_type != "fly") {
+				footprints.insert(pathing_footprint(units_slk.data<float>("collision", id)));
+			}
+		}
+
+		// The builds start from the cells as they are now, later changes are repaired when a build is taken
+		pathing_map.take_changed_cells();
+		const auto static_cells = std::make_shared<const std::vector<u8>>(pathing_map.pathing_cells_static);
+		const auto dynamic_cells = std::make_shared<const std::vector<u8>>(pathing_map.pathing_cells_dynamic);
+		for (const int footprint : footprints) {
+			ground_pathfinder_builds.emplace(footprint, std::async(std::launch::async, [footprint, static_cells, dynamic_cells, width = pathing_map.width, height = pathing_map.height] {
+				HierarchicalPathfinder pathfinder(footprint, PathingMap::Flags::unwalkable);
+				pathfinder.build(*static_cells, *dynamic_cells, width, height);
+				return pathfinder;
+			}));
+		}
+	}
+
+	/// The shortest ground path between two pathing cells for a unit with the given footprint
+	std::optional<GridPath> find_ground_path(const glm::ivec2 from, const glm::ivec2 to, const int footprint) {
+		const auto changed = pathing_map.take_changed_cells();
+		for (auto& [size, pathfinder] : ground_pathfinders) {
+			if (pathfinder.map_width() != pathing_map.width || pathfinder.map_height() != pathing_map.height) {
+				pathfinder.build(pathing_map.pathing_cells_static, pathing_map.pathing_cells_dynamic, pathing_map.width, pathing_map.height);
+			} else if (!changed.isEmpty()) {
+				pathfinder.repair(pathing_map.pathing_cells_static, pathing_map.pathing_cells_dynamic, changed.left(), changed.top(), changed.right() + 1, changed.bottom() + 1);
+			}
+		}
+
+		ground_pathfinder_build_changes |= changed;
+		for (auto i = ground_pathfinder_builds.begin(); i != ground_pathfinder_builds.end();) {
+			auto& [size, build] = *i;
+			const bool ready = build.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			if (!ready && size != footprint) {
+				++i;
+				continue;
+			}
+
+			Timer timer;
+			HierarchicalPathfinder& pathfinder = ground_pathfinders.insert_or_assign(size, build.get()).first->second;
+			if (!ready) {
+				std::println("Waited {:.1f}ms for the pathfinder of footprint {} to be built", timer.elapsed_ms(), footprint);
+			}
+
+			const QRect& build_changed = ground_pathfinder_build_changes;
+			if (pathfinder.map_width() != pathing_map.width || pathfinder.map_height() != pathing_map.height) {
+				pathfinder.build(pathing_map.pathing_cells_static, pathing_map.pathing_cells_dynamic, pathing_map.width, pathing_map.height);
+			} else if (!build_changed.isEmpty()) {
+				pathfinder.repair(pathing_map.pathing_cells_static, pathing_map.pathing_cells_dynamic, build_changed.left(), build_changed.top(), build_changed.right() + 1, build_changed.bottom() + 1);
+			}
+			i = ground_pathfinder_builds.erase(i);
+		}
+		if (ground_pathfinder_builds.empty()) {
+			ground_pathfinder_build_changes = QRect();
+		}
+
+		auto [found, inserted] = ground_pathfinders.try_emplace(footprint, footprint, PathingMap::Flags::unwalkable);
+		if (inserted) {
+			Timer timer;
+			found->second.build(pathing_map.pathing_cells_static, pathing_map.pathing_cells_dynamic, pathing_map.width, pathing_map.height);
+			std::println("Pathfinder for footprint {} built in {}ms", footprint, timer.elapsed_ms());
+		}
+		return found->second.find_path(from, to);
+	}
+
 	void render() {
 		// While switching maps it may happen that render is called before loading has finished.
 		if (!loaded) {
 			return;
 		}
 
+		// The render lists of the previous frame have been released by RenderManager::render()
+		frame_arena().reset();
+
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		glPolygonMode(GL_FRONT_AND_BACK, render_wireframe ? GL_LINE : GL_FILL);
 
-		terrain.render_ground(render_pathing, render_lighting, light_direction, brush, pathing_map);
+		if (render_walkability) {
+			ProfileScope scope("walkability");
+			update_walkability_overlay();
+		}
 
-		if (render_doodads) {
-			for (const auto& i : doodads.doodads) {
-				render_manager.queue_render(*i.mesh, i.skeleton, i.color);
-				bool is_doodad = doodads_slk.row_headers.contains(i.id);
-				slk::SLK& slk = is_doodad ? doodads_slk : destructibles_slk;
-				if (slk.data<bool>("useclickhelper", i.id)) {
-					render_manager.queue_click_helper(i.skeleton.matrix);
-				}
-			}
-			for (const auto& i : doodads.special_doodads) {
-				render_manager.queue_render(*i.mesh, i.skeleton, glm::vec3(1.f));
-			}
+		{
+			ProfileScope scope("terrain", true);
+			terrain.render_ground(render_pathing, render_walkability, render_lighting, light_direction, brush, pathing_map);
 		}
 
-		if (render_units) {
-			for (auto& i : units.units) {
-				if (i.id == "sloc") {
-					continue;
-				} // ToDo handle starting locations
+		// Objects may have been added or removed since the last update()
+		if (unit_visibility.count != units.units.size() || item_visibility.count != units.items.size()
+			|| doodad_visibility.count != doodads.doodads.size() || special_doodad_visibility.count != doodads.special_doodads.size()) {
+			update_visibility();
+		}
+
+		{
+			ProfileScope scope("queue_render");
 
-				render_manager.queue_render(*i.mesh, i.skeleton, i.color);
+			// Sized up front, growing would leave the smaller copies behind in the frame arena
+			size_t queued = 0;
+			if (render_doodads) {
+				queued += doodad_visibility.visible_count() + special_doodad_visibility.visible_count();
+			}
+			if (render_units) {
+				queued += unit_visibility.visible_count() + item_visibility.visible_count();
 			}
-			for (auto& i : units.items) {
-				render_manager.queue_render(*i.mesh, i.skeleton, i.color);
+			render_queue.reserve(queued);
+
+			if (render_doodads) {
+				queue_visible(doodads.doodads, doodad_visibility, [](const Doodad& i) { return i.color; });
+				queue_visible(doodads.special_doodads, special_doodad_visibility, [](const SpecialDoodad&) { return glm::vec3(1.f); });
+
+				doodad_visibility.for_each_visible(0, doodads.doodads.size(), [&](const size_t index) {
+					const Doodad& doodad = doodads.doodads[index];
+					bool is_doodad = doodads_slk.row_headers.contains(doodad.id);
+					slk::SLK& slk = is_doodad ? doodads_slk : destructibles_slk;
+					if (slk.data<bool>("useclickhelper", doodad.id)) {
+						render_manager.queue_click_helper(doodad.skeleton.matrix);
+					}
+				});
 			}
+
+			if (render_units) {
+				queue_visible(units.units, unit_visibility, [](const Unit& i) { return i.color; });
+				queue_visible(units.items, item_visibility, [](const Unit& i) { return i.color; });
+			}
+			render_manager.queue_visible(render_queue);
+			release(render_queue);
 		}
 
 		if (render_brush && brush) {
 			brush->render();
 		}
 
-		render_manager.render(render_lighting, light_direction);
-		terrain.render_water();
+		render_manager.render(render_lighting, light_direction, render_weighted_transparency);
+
+		{
+			ProfileScope scope("water", true);
+			terrain.render_water();
+		}
 
 		// physics.dynamicsWorld->debugDrawWorld();
 		// physics.draw->render();
 	}
 
+	/// The world space bounds of the current sequence
+	static void skeleton_bounds(const SkeletalModelInstance& skeleton, glm::vec3& min, glm::vec3& max) {
+		const mdx::Extent& extent = skeleton.model->sequences[skeleton.sequence_index].extent;
+		min = skeleton.matrix * glm::vec4(extent.minimum, 1.f);
+		max = skeleton.matrix * glm::vec4(extent.maximum, 1.f);
+	}
+
+	/// Tests all units, items and doodads against the view frustum in a single parallel pass
+	void update_visibility() {
+		const std::span<const glm::vec4> planes(camera.frustum_planes, 5); // The same planes as Camera::inside_frustrum()
+
+		unit_visibility.update(planes, units.units.size(), [&](const size_t index, glm::vec3& min, glm::vec3& max) {
+			const Unit& unit = units.units[index];
+			if (unit.id == "sloc") {
+				return false;
+			} // ToDo handle starting locations
+
+			skeleton_bounds(unit.skeleton, min, max);
+			return true;
+		});
+
+		item_visibility.update(planes, units.items.size(), [&](const size_t index, glm::vec3& min, glm::vec3& max) {
+			skeleton_bounds(units.items[index].skeleton, min, max);
+			return true;
+		});
+
+		doodad_visibility.update(planes, doodads.doodads.size(), [&](const size_t index, glm::vec3& min, glm::vec3& max) {
+			skeleton_bounds(doodads.doodads[index].skeleton, min, max);
+			return true;
+		});
+
+		special_doodad_visibility.update(planes, doodads.special_doodads.size(), [&](const size_t index, glm::vec3& min, glm::vec3& max) {
+			skeleton_bounds(doodads.special_doodads[index].skeleton, min, max);
+			return true;
+		});
+	}
+
+	/// Appends the visible objects to render_queue.
+	/// Blocks of objects are gathered in parallel into their own queue, which are then concatenated in order
+	template <typename T, typename F>
+	void queue_visible(const std::vector<T>& objects, const VisibilitySet& visibility, F&& color) {
+		constexpr size_t block_size = 4096;
+
+		render_blocks.resize((objects.size() + block_size - 1) / block_size);
+		std::for_each(std::execution::par, render_blocks.begin(), render_blocks.end(), [&](std::vector<RenderManager::QueuedInstance>& block) {
+			const size_t first = (&block - render_blocks.data()) * block_size;
+			block.clear();
+			visibility.for_each_visible(first, first + block_size, [&](const size_t index) {
+				const T& object = objects[index];
+				block.push_back({ object.mesh.get(), &object.skeleton, color(object) });
+			});
+		});
+
+		for (const auto& block : render_blocks) {
+			render_queue.insert(render_queue.end(), block.begin(), block.end());
+		}
+	}
+
 	void resize(size_t width, size_t height) {
 		terrain.resize(width, height);
 		pathing_map.resize(width * 4, height * 4);
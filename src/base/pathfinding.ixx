@@ -0,0 +1,616 @@
+export module Pathfinding;
+
+import std;
+import types;
+import <glm/glm.hpp>;
+
+/// A path over pathing cells, from the start cell to the goal cell
+export struct GridPath {
+	std::vector<glm::ivec2> cells;
+	/// In cells, diagonal steps count as sqrt(2)
+	float length = 0.f;
+};
+
+/// The footprint in pathing cells of a unit with the given collision size, which is a radius in world units
+export int pathing_footprint(const float collision_size) {
+	return std::max(1, static_cast<int>(std::ceil(collision_size * 2.f / 32.f)));
+}
+
+/// Hierarchical pathfinding (HPA*) for ground units over the pathing map.
+/// The map is cut into clusters of cluster_size * cluster_size cells. Where two clusters touch, every run of cells that is open on both sides
+/// gets one or two transitions, and the in-cluster distances between the transitions of a cluster are cached.
+/// A query searches this abstract graph and refines the result cluster by cluster, so it visits a few thousand nodes instead of millions of cells.
+/// Units move in 8 directions without cutting corners, the footprint is the unit's size in cells which has to fit around every cell of the path.
+/// Paths are close to but not always the shortest, as the path is only optimal between transitions and the abstract search is slightly weighted
+export class HierarchicalPathfinder {
+  public:
+	static constexpr int cluster_size = 16;
+
+  private:
+	struct Node {
+		u32 cell;
+		u32 partner; // The cell on the other side of the cluster border
+		u32 partner_index = no_node; // Of the node at partner in its cluster, set by link_cluster()
+	};
+
+	struct Cluster {
+		std::vector<Node> nodes;
+		/// nodes.size() squared in-cluster distances, infinity when unreachable within the cluster
+		std::vector<float> distances;
+	};
+
+	/// A cell on each side of a border, the first one in the cluster with the lower index
+	struct Transition {
+		u32 cell;
+		u32 partner;
+	};
+
+	/// The distances and the way back to the source from a search that stays inside one cluster
+	struct ClusterSearch {
+		std::array<float, cluster_size * cluster_size> distance;
+		std::array<u16, cluster_size * cluster_size> parent;
+	};
+
+	static constexpr float infinity = std::numeric_limits<float>::infinity();
+	/// Weights the distance estimate of the abstract search. Paths get at most this much longer than the best over the transitions,
+	/// in exchange for expanding far fewer nodes on long queries
+	static constexpr float heuristic_weight = 1.05f;
+	static constexpr u16 no_parent = std::numeric_limits<u16>::max();
+	static constexpr u32 no_node = std::numeric_limits<u32>::max();
+
+	int width = 0;
+	int height = 0;
+	int footprint = 1;
+	u8 blocking;
+	int clusters_x = 0;
+	int clusters_y = 0;
+
+	/// Whether the footprint fits around a cell
+	std::vector<u8> open;
+	std::vector<Cluster> clusters;
+	/// Transitions to the cluster on the right and above, empty for the last column and row
+	std::vector<std::vector<Transition>> east_borders;
+	std::vector<std::vector<Transition>> north_borders;
+	/// The nodes of all clusters numbered one after the other, node i of cluster c is node_offsets[c] + i.
+	/// Partners are stored per cluster, so only a change in the node count of a cluster requires renumbering
+	std::vector<u32> node_offsets;
+	std::vector<u32> node_clusters;
+
+	int cluster_of(const int x, const int y) const {
+		return (y / cluster_size) * clusters_x + x / cluster_size;
+	}
+
+	glm::ivec2 position(const u32 cell) const {
+		return { static_cast<int>(cell % width), static_cast<int>(cell / width) };
+	}
+
+	int cluster_of(const u32 cell) const {
+		const glm::ivec2 p = position(cell);
+		return cluster_of(p.x, p.y);
+	}
+
+	/// Whether all cells the footprint covers when standing on (x, y) lack the blocking flags.
+	/// The footprint is centered on the cell for odd sizes and reaches one cell further up and right for even sizes
+	void update_open(const std::span<const u8> static_cells, const std::span<const u8> dynamic_cells, const int x_begin, const int y_begin, const int x_end, const int y_end) {
+		const int offset = (footprint - 1) / 2;
+		for (int y = y_begin; y < y_end; y++) {
+			for (int x = x_begin; x < x_end; x++) {
+				bool fits = true;
+				for (int j = y - offset; j < y - offset + footprint && fits; j++) {
+					for (int i = x - offset; i < x - offset + footprint; i++) {
+						if (i < 0 || i >= width || j < 0 || j >= height || (static_cells[j * width + i] | dynamic_cells[j * width + i]) & blocking) {
+							fits = false;
+							break;
+						}
+					}
+				}
+				open[y * width + x] = fits;
+			}
+		}
+	}
+
+	/// Finds the runs of cells open on both sides of a border and places a transition in the middle of short runs and at both ends of long ones.
+	/// first(i) and second(i) are the cells on either side at position i along the border
+	template <typename F, typename S>
+	void find_transitions(std::vector<Transition>& transitions, const int length, F&& first, S&& second) const {
+		transitions.clear();
+		int run_start = -1;
+		for (int i = 0; i <= length; i++) {
+			const bool crossing = i < length && open[first(i)] && open[second(i)];
+			if (crossing && run_start < 0) {
+				run_start = i;
+			} else if (!crossing && run_start >= 0) {
+				const int run_end = i - 1;
+				if (run_end - run_start < 5) {
+					const int middle = (run_start + run_end) / 2;
+					transitions.push_back({ first(middle), second(middle) });
+				} else {
+					transitions.push_back({ first(run_start), second(run_start) });
+					transitions.push_back({ first(run_end), second(run_end) });
+				}
+				run_start = -1;
+			}
+		}
+	}
+
+	void update_east_border(const int cx, const int cy) {
+		const int x = (cx + 1) * cluster_size - 1;
+		const int y_begin = cy * cluster_size;
+		const int length = std::min(cluster_size, height - y_begin);
+		find_transitions(east_borders[cy * clusters_x + cx], length, [&](const int i) { return static_cast<u32>((y_begin + i) * width + x); }, [&](const int i) {
+			return static_cast<u32>((y_begin + i) * width + x + 1);
+		});
+	}
+
+	void update_north_border(const int cx, const int cy) {
+		const int y = (cy + 1) * cluster_size - 1;
+		const int x_begin = cx * cluster_size;
+		const int length = std::min(cluster_size, width - x_begin);
+		find_transitions(north_borders[cy * clusters_x + cx], length, [&](const int i) { return static_cast<u32>(y * width + x_begin + i); }, [&](const int i) {
+			return static_cast<u32>((y + 1) * width + x_begin + i);
+		});
+	}
+
+	/// Dijkstra from a cell that does not leave its cluster, stopping early once the target is reached
+	void search_cluster(const int cluster, const u32 source, ClusterSearch& search, const u16 target = no_parent) const {
+		const int x_begin = (cluster % clusters_x) * cluster_size;
+		const int y_begin = (cluster / clusters_x) * cluster_size;
+		const int x_end = std::min(x_begin + cluster_size, width);
+		const int y_end = std::min(y_begin + cluster_size, height);
+
+		search.distance.fill(infinity);
+		search.parent.fill(no_parent);
+
+		const auto local = [&](const int x, const int y) {
+			return static_cast<u16>((y - y_begin) * cluster_size + x - x_begin);
+		};
+		const auto is_open = [&](const int x, const int y) {
+			return x >= x_begin && x < x_end && y >= y_begin && y < y_end && open[y * width + x];
+		};
+
+		using Entry = std::pair<float, u16>;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+		const u16 start = local(position(source).x, position(source).y);
+		search.distance[start] = 0.f;
+		queue.push({ 0.f, start });
+
+		while (!queue.empty()) {
+			const auto [distance, current] = queue.top();
+			queue.pop();
+			if (distance > search.distance[current]) {
+				continue;
+			}
+			if (current == target) {
+				break;
+			}
+
+			const int x = x_begin + current % cluster_size;
+			const int y = y_begin + current / cluster_size;
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					if ((dx == 0 && dy == 0) || !is_open(x + dx, y + dy)) {
+						continue;
+					}
+					// No cutting corners
+					if (dx != 0 && dy != 0 && (!is_open(x + dx, y) || !is_open(x, y + dy))) {
+						continue;
+					}
+
+					const u16 next = local(x + dx, y + dy);
+					const float next_distance = distance + ((dx != 0 && dy != 0) ? std::numbers::sqrt2_v<float> : 1.f);
+					if (next_distance < search.distance[next]) {
+						search.distance[next] = next_distance;
+						search.parent[next] = current;
+						queue.push({ next_distance, next });
+					}
+				}
+			}
+		}
+	}
+
+	u16 local_index(const int cluster, const u32 cell) const {
+		const int x = position(cell).x - (cluster % clusters_x) * cluster_size;
+		const int y = position(cell).y - (cluster / clusters_x) * cluster_size;
+		return static_cast<u16>(y * cluster_size + x);
+	}
+
+	u32 global_index(const int cluster, const u16 local) const {
+		const int x = (cluster % clusters_x) * cluster_size + local % cluster_size;
+		const int y = (cluster / clusters_x) * cluster_size + local / cluster_size;
+		return static_cast<u32>(y * width + x);
+	}
+
+	/// Appends the cells from the search source to target, excluding the source
+	void append_search_path(const int cluster, const ClusterSearch& search, const u32 target, std::vector<glm::ivec2>& cells) const {
+		const size_t first = cells.size();
+		for (u16 i = local_index(cluster, target); search.parent[i] != no_parent; i = search.parent[i]) {
+			const u32 cell = global_index(cluster, i);
+			cells.push_back(position(cell));
+		}
+		std::reverse(cells.begin() + first, cells.end());
+	}
+
+	void rebuild_cluster(const int cluster) {
+		const int cx = cluster % clusters_x;
+		const int cy = cluster / clusters_x;
+
+		Cluster& target = clusters[cluster];
+		target.nodes.clear();
+		if (cx + 1 < clusters_x) {
+			for (const auto& i : east_borders[cluster]) {
+				target.nodes.push_back({ i.cell, i.partner });
+			}
+		}
+		if (cy + 1 < clusters_y) {
+			for (const auto& i : north_borders[cluster]) {
+				target.nodes.push_back({ i.cell, i.partner });
+			}
+		}
+		if (cx > 0) {
+			for (const auto& i : east_borders[cluster - 1]) {
+				target.nodes.push_back({ i.partner, i.cell });
+			}
+		}
+		if (cy > 0) {
+			for (const auto& i : north_borders[cluster - clusters_x]) {
+				target.nodes.push_back({ i.partner, i.cell });
+			}
+		}
+
+		const size_t count = target.nodes.size();
+		target.distances.assign(count * count, infinity);
+		ClusterSearch search;
+		for (size_t i = 0; i < count; i++) {
+			search_cluster(cluster, target.nodes[i].cell, search);
+			for (size_t j = 0; j < count; j++) {
+				target.distances[i * count + j] = search.distance[local_index(cluster, target.nodes[j].cell)];
+			}
+		}
+	}
+
+	/// Looks up the index of the partner of every node of the cluster in the partner's cluster
+	void link_cluster(const int cluster) {
+		for (auto& node : clusters[cluster].nodes) {
+			node.partner_index = no_node;
+			const auto& partner_nodes = clusters[cluster_of(node.partner)].nodes;
+			for (size_t j = 0; j < partner_nodes.size(); j++) {
+				if (partner_nodes[j].cell == node.partner && partner_nodes[j].partner == node.cell) {
+					node.partner_index = static_cast<u32>(j);
+					break;
+				}
+			}
+		}
+	}
+
+	/// Numbers the nodes of all clusters one after the other
+	void number_nodes() {
+		node_offsets.resize(clusters.size() + 1);
+		node_offsets[0] = 0;
+		for (size_t i = 0; i < clusters.size(); i++) {
+			node_offsets[i + 1] = node_offsets[i] + static_cast<u32>(clusters[i].nodes.size());
+		}
+		node_clusters.resize(node_offsets.back());
+		for (size_t i = 0; i < clusters.size(); i++) {
+			std::fill(node_clusters.begin() + node_offsets[i], node_clusters.begin() + node_offsets[i + 1], static_cast<u32>(i));
+		}
+	}
+
+	static float octile_distance(const glm::ivec2 a, const glm::ivec2 b) {
+		const int dx = std::abs(a.x - b.x);
+		const int dy = std::abs(a.y - b.y);
+		return std::max(dx, dy) + (std::numbers::sqrt2_v<float> - 1.f) * std::min(dx, dy);
+	}
+
+  public:
+	/// footprint is the size of the unit in cells and blocking the pathing flags it can't stand on
+	HierarchicalPathfinder(const int footprint, const u8 blocking)
+		: footprint(std::max(footprint, 1)), blocking(blocking) {
+	}
+
+	int map_width() const {
+		return width;
+	}
+
+	int map_height() const {
+		return height;
+	}
+
+	/// The pathing cells like PathingMap::pathing_cells_static and pathing_cells_dynamic
+	void build(const std::span<const u8> static_cells, const std::span<const u8> dynamic_cells, const int width, const int height) {
+		this->width = width;
+		this->height = height;
+		clusters_x = (width + cluster_size - 1) / cluster_size;
+		clusters_y = (height + cluster_size - 1) / cluster_size;
+
+		open.assign(width * height, 0);
+		clusters.assign(clusters_x * clusters_y, {});
+		east_borders.assign(clusters.size(), {});
+		north_borders.assign(clusters.size(), {});
+		node_offsets.clear();
+		repair(static_cells, dynamic_cells, 0, 0, width, height);
+	}
+
+	/// Updates the abstract graph after the cells in [x_begin, x_end) * [y_begin, y_end) changed.
+	/// Only the clusters the change reaches and their direct neighbours are rebuilt, the work does not depend on the size of the map
+	/// unless the number of nodes of a rebuilt cluster changes, in which case the nodes are renumbered in one pass over the clusters
+	void repair(const std::span<const u8> static_cells, const std::span<const u8> dynamic_cells, int x_begin, int y_begin, int x_end, int y_end) {
+		// The footprint spreads a change of one cell over footprint cells in every direction
+		x_begin = std::max(x_begin - footprint, 0);
+		y_begin = std::max(y_begin - footprint, 0);
+		x_end = std::min(x_end + footprint, width);
+		y_end = std::min(y_end + footprint, height);
+		if (x_begin >= x_end || y_begin >= y_end) {
+			return;
+		}
+		update_open(static_cells, dynamic_cells, x_begin, y_begin, x_end, y_end);
+
+		const int cx_begin = x_begin / cluster_size;
+		const int cy_begin = y_begin / cluster_size;
+		const int cx_end = (x_end - 1) / cluster_size + 1;
+		const int cy_end = (y_end - 1) / cluster_size + 1;
+
+		// Every border of a changed cluster, so including the east and north borders of the clusters left of and below it
+		for (int cy = std::max(cy_begin - 1, 0); cy < cy_end; cy++) {
+			for (int cx = std::max(cx_begin - 1, 0); cx < cx_end; cx++) {
+				if (cx + 1 < clusters_x && cy >= cy_begin) {
+					update_east_border(cx, cy);
+				}
+				if (cy + 1 < clusters_y && cx >= cx_begin) {
+					update_north_border(cx, cy);
+				}
+			}
+		}
+
+		// The neighbours share the changed borders, so their transitions may have moved as well
+		std::vector<int> rebuild;
+		std::vector<size_t> node_counts;
+		for (int cy = std::max(cy_begin - 1, 0); cy < std::min(cy_end + 1, clusters_y); cy++) {
+			for (int cx = std::max(cx_begin - 1, 0); cx < std::min(cx_end + 1, clusters_x); cx++) {
+				rebuild.push_back(cy * clusters_x + cx);
+				node_counts.push_back(clusters[cy * clusters_x + cx].nodes.size());
+			}
+		}
+		std::for_each(std::execution::par, rebuild.begin(), rebuild.end(), [&](const int cluster) {
+			rebuild_cluster(cluster);
+		});
+
+		// The nodes of the clusters around the rebuilt ones may have moved within the rebuilt clusters, so their partners are looked up again as well
+		std::vector<int> relink;
+		for (int cy = std::max(cy_begin - 2, 0); cy < std::min(cy_end + 2, clusters_y); cy++) {
+			for (int cx = std::max(cx_begin - 2, 0); cx < std::min(cx_end + 2, clusters_x); cx++) {
+				relink.push_back(cy * clusters_x + cx);
+			}
+		}
+		std::for_each(std::execution::par, relink.begin(), relink.end(), [&](const int cluster) {
+			link_cluster(cluster);
+		});
+
+		bool renumber = node_offsets.size() != clusters.size() + 1;
+		for (size_t i = 0; i < rebuild.size(); i++) {
+			renumber |= clusters[rebuild[i]].nodes.size() != node_counts[i];
+		}
+		if (renumber) {
+			number_nodes();
+		}
+	}
+
+  private:
+	/// A* over the cells of a window of the map, optimal as long as the shortest path stays inside the window
+	std::optional<GridPath> find_window_path(const glm::ivec2 from, const glm::ivec2 to, const int x_begin, const int y_begin, const int x_end, const int y_end) const {
+		const int window_width = x_end - x_begin;
+		const auto local = [&](const int x, const int y) {
+			return (y - y_begin) * window_width + x - x_begin;
+		};
+		const auto is_open = [&](const int x, const int y) {
+			return x >= x_begin && x < x_end && y >= y_begin && y < y_end && open[y * width + x];
+		};
+
+		std::vector<float> distance(window_width * (y_end - y_begin), infinity);
+		std::vector<int> parent(distance.size(), -1);
+		using Entry = std::pair<float, int>;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+		distance[local(from.x, from.y)] = 0.f;
+		queue.push({ octile_distance(from, to), local(from.x, from.y) });
+
+		const int goal = local(to.x, to.y);
+		while (!queue.empty()) {
+			const auto [estimate, current] = queue.top();
+			queue.pop();
+			if (current == goal) {
+				break;
+			}
+
+			const int x = x_begin + current % window_width;
+			const int y = y_begin + current / window_width;
+			if (estimate > distance[current] + octile_distance({ x, y }, to) + 1e-4f) {
+				continue;
+			}
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					if ((dx == 0 && dy == 0) || !is_open(x + dx, y + dy)) {
+						continue;
+					}
+					if (dx != 0 && dy != 0 && (!is_open(x + dx, y) || !is_open(x, y + dy))) {
+						continue;
+					}
+
+					const int next = local(x + dx, y + dy);
+					const float next_distance = distance[current] + ((dx != 0 && dy != 0) ? std::numbers::sqrt2_v<float> : 1.f);
+					if (next_distance < distance[next]) {
+						distance[next] = next_distance;
+						parent[next] = current;
+						queue.push({ next_distance + octile_distance({ x + dx, y + dy }, to), next });
+					}
+				}
+			}
+		}
+
+		if (distance[goal] == infinity) {
+			return {};
+		}
+
+		GridPath path;
+		path.length = distance[goal];
+		for (int i = goal; i != -1; i = parent[i]) {
+			path.cells.push_back({ x_begin + i % window_width, y_begin + i / window_width });
+		}
+		std::reverse(path.cells.begin(), path.cells.end());
+		return path;
+	}
+
+	std::optional<GridPath> find_hierarchical_path(const glm::ivec2 from, const glm::ivec2 to) const {
+		const u32 from_cell = from.y * width + from.x;
+		const u32 to_cell = to.y * width + to.x;
+
+		const int start_cluster = cluster_of(from.x, from.y);
+		const int goal_cluster = cluster_of(to.x, to.y);
+		ClusterSearch start_search;
+		ClusterSearch goal_search;
+		search_cluster(start_cluster, from_cell, start_search);
+		search_cluster(goal_cluster, to_cell, goal_search);
+
+		constexpr u32 start_node = std::numeric_limits<u32>::max();
+		const size_t node_count = node_offsets.back();
+		std::vector<float> costs(node_count, infinity);
+		std::vector<u32> parents(node_count, start_node);
+		using Entry = std::pair<float, u32>;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+		const auto node_cell = [&](const u32 node) {
+			const int cluster = node_clusters[node];
+			return clusters[cluster].nodes[node - node_offsets[cluster]].cell;
+		};
+		const auto relax = [&](const u32 node, const float cost, const u32 parent) {
+			if (cost >= costs[node]) {
+				return;
+			}
+			costs[node] = cost;
+			parents[node] = parent;
+			queue.push({ cost + heuristic_weight * octile_distance(position(node_cell(node)), to), node });
+		};
+
+		float best = infinity;
+		u32 best_node = start_node;
+		if (start_cluster == goal_cluster) {
+			best = start_search.distance[local_index(start_cluster, to_cell)];
+		}
+
+		const Cluster& start = clusters[start_cluster];
+		for (size_t i = 0; i < start.nodes.size(); i++) {
+			const float cost = start_search.distance[local_index(start_cluster, start.nodes[i].cell)];
+			if (cost != infinity) {
+				relax(node_offsets[start_cluster] + static_cast<u32>(i), cost, start_node);
+			}
+		}
+
+		while (!queue.empty()) {
+			const auto [estimate, current] = queue.top();
+			queue.pop();
+			if (estimate >= best) {
+				break;
+			}
+
+			const int cluster_index = node_clusters[current];
+			const size_t node_index = current - node_offsets[cluster_index];
+			const Cluster& cluster = clusters[cluster_index];
+			const Node& node = cluster.nodes[node_index];
+			const float cost = costs[current];
+			// Stale entry
+			if (estimate > cost + heuristic_weight * octile_distance(position(node.cell), to) + 1e-4f) {
+				continue;
+			}
+
+			if (cluster_index == goal_cluster) {
+				const float total = cost + goal_search.distance[local_index(goal_cluster, node.cell)];
+				if (total < best) {
+					best = total;
+					best_node = current;
+				}
+			}
+
+			// A node reached from inside its cluster can't improve on the other nodes of the cluster, the distances are already the shortest within it
+			const bool entered = parents[current] != start_node && node_clusters[parents[current]] != static_cast<u32>(cluster_index);
+			const size_t count = cluster.nodes.size();
+			for (size_t i = 0; entered && i < count; i++) {
+				const float distance = cluster.distances[node_index * count + i];
+				if (i != node_index && distance != infinity) {
+					relax(node_offsets[cluster_index] + static_cast<u32>(i), cost + distance, current);
+				}
+			}
+			if (node.partner_index != no_node) {
+				relax(node_offsets[cluster_of(node.partner)] + node.partner_index, cost + 1.f, current);
+			}
+		}
+
+		if (best == infinity) {
+			return {};
+		}
+
+		// Walk the abstract path back and refine every part of it into cells
+		std::vector<u32> chain;
+		for (u32 i = best_node; i != start_node; i = parents[i]) {
+			chain.push_back(i);
+		}
+		std::reverse(chain.begin(), chain.end());
+
+		GridPath path;
+		path.length = best;
+		path.cells.push_back(from);
+		if (chain.empty()) {
+			append_search_path(start_cluster, start_search, to_cell, path.cells);
+			return path;
+		}
+
+		append_search_path(start_cluster, start_search, node_cell(chain.front()), path.cells);
+
+		ClusterSearch search;
+		for (size_t i = 1; i < chain.size(); i++) {
+			const u32 previous = node_cell(chain[i - 1]);
+			const u32 next = node_cell(chain[i]);
+			const int cluster = node_clusters[chain[i]];
+			if (node_clusters[chain[i - 1]] != node_clusters[chain[i]]) {
+				path.cells.push_back(position(next));
+			} else if (previous != next) {
+				search_cluster(cluster, previous, search, local_index(cluster, next));
+				append_search_path(cluster, search, next, path.cells);
+			}
+		}
+
+		// The goal search runs from the goal, so its parents lead from the last node to the goal
+		for (u16 i = local_index(goal_cluster, node_cell(chain.back())); goal_search.parent[i] != no_parent;) {
+			i = goal_search.parent[i];
+			const u32 cell = global_index(goal_cluster, i);
+			path.cells.push_back(position(cell));
+		}
+
+		return path;
+	}
+
+  public:
+	/// Returns nothing when the cells are outside of the map, the footprint does not fit on either of them or they are not connected.
+	/// Nearby cells are also searched cell by cell, as a detour over the transitions is most noticeable on short paths
+	std::optional<GridPath> find_path(const glm::ivec2 from, const glm::ivec2 to) const {
+		if (from.x < 0 || from.x >= width || from.y < 0 || from.y >= height || to.x < 0 || to.x >= width || to.y < 0 || to.y >= height) {
+			return {};
+		}
+		if (!open[from.y * width + from.x] || !open[to.y * width + to.x]) {
+			return {};
+		}
+
+		std::optional<GridPath> path = find_hierarchical_path(from, to);
+		if (std::abs(from.x - to.x) <= 2 * cluster_size && std::abs(from.y - to.y) <= 2 * cluster_size) {
+			std::optional<GridPath> window_path = find_window_path(
+				from,
+				to,
+				std::max(std::min(from.x, to.x) - cluster_size, 0),
+				std::max(std::min(from.y, to.y) - cluster_size, 0),
+				std::min(std::max(from.x, to.x) + cluster_size + 1, width),
+				std::min(std::max(from.y, to.y) + cluster_size + 1, height)
+			);
+			if (window_path && (!path || window_path->length < path->length)) {
+				path = std::move(window_path);
+			}
+		}
+		return path;
+	}
+};
\ No newline at end of file
@@ -10,12 +10,69 @@ import BinaryWriter;
 import PathingTexture;
 import OpenGLUtilities;
 import Hierarchy;
+import Profiler;
+import Walkability;
 import <glm/glm.hpp>;
 import <glad/glad.h>;
 
 export class PathingMap {
 	static constexpr int write_version = 0;
 
+	/// The cells of a stamp that fall inside the map, in stamp coordinates
+	struct StampClip {
+		int x_begin;
+		int x_end;
+		int y_begin;
+		int y_end;
+	};
+
+	StampClip clip_stamp(const PathingStamp& stamp, const glm::ivec2 origin) const {
+		StampClip clip = {
+			std::max(0, -origin.x),
+			std::min(stamp.width, width - origin.x),
+			std::max(0, -origin.y),
+			std::min(stamp.height, height - origin.y),
+		};
+		// Entirely outside of the map
+		if (clip.x_begin >= clip.x_end) {
+			clip.y_end = clip.y_begin;
+		}
+		return clip;
+	}
+
+	static uint64_t load_word(const uint8_t* cells) {
+		uint64_t word;
+		std::memcpy(&word, cells, sizeof(word));
+		return word;
+	}
+
+	static void store_word(uint8_t* cells, const uint64_t word) {
+		std::memcpy(cells, &word, sizeof(word));
+	}
+
+	/// Sets the high bit of every byte that is not zero
+	static uint64_t nonzero_bytes(const uint64_t word) {
+		constexpr uint64_t low_bits = 0x7F7F7F7F7F7F7F7Full;
+		return (((word & low_bits) + low_bits) | word) & ~low_bits;
+	}
+
+	/// Uploads only the cells in area, the unpack row length lets GL read the sub rectangle straight out of the full grid
+	void upload_area(const GLuint texture, const std::vector<uint8_t>& cells, QRect& area) {
+		area = area.intersected({ 0, 0, width, height });
+		if (area.isEmpty()) {
+			return;
+		}
+
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+		glTextureSubImage2D(texture, 0, area.x(), area.y(), area.width(), area.height(), GL_RED_INTEGER, GL_UNSIGNED_BYTE, cells.data() + area.y() * width + area.x());
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+		profiler.count("bytes uploaded", area.width() * area.height());
+		changed_cells |= area;
+		cells_version += 1;
+		area = QRect();
+	}
+
   public:
 	int width;
 	int height;
@@ -28,9 +85,19 @@ export class PathingMap {
 
 	GLuint texture_static;
 	GLuint texture_dynamic;
+	/// Component labels for the walkability overlay, 0 until upload_components() is called
+	GLuint texture_components = 0;
 	std::vector<uint8_t> pathing_cells_static;
 	std::vector<uint8_t> pathing_cells_dynamic;
 
+	/// The cells changed since the last upload of each texture, empty when the texture is up to date
+	QRect dirty_static;
+	QRect dirty_dynamic;
+	/// Every cell uploaded since the last take_changed_cells(), for the caches that are derived from the cells
+	QRect changed_cells;
+	/// Increased on every upload and resize, for derived data that only needs to know whether it is outdated
+	size_t cells_version = 0;
+
 	bool load(size_t terrain_width, size_t terrain_height) {
 		BinaryReader reader = hierarchy.map_file_read("war3map.wpm").value();
 		const std::string magic_number = reader.read_string(4);
@@ -89,6 +156,7 @@ export class PathingMap {
 	/// Clears an area with zeroes
 	void dynamic_clear_area(const QRect& area) {
 		const QRect t = QRect(area.left() * 4, area.top() * 4, area.width() * 4, area.height() * 4).intersected({ 0, 0, width, height });
+		dirty_dynamic |= t;
 
 		for (int j = t.top(); j < t.bottom(); j++) {
 			for (int i = t.left(); i < t.right(); i++) {
@@ -97,45 +165,46 @@ export class PathingMap {
 		}
 	}
 
-	/// Checks for every cell on the supplied pathing_texture where (pathing_texture & mask == true) whether (existing_pathing & mask == true) and if so returns false
+	/// Where the bottom left cell of the rotated pathing texture lands when it is centered around position (in whole grid tiles)
+	static glm::ivec2 stamp_origin(const glm::vec2 position, const int rotation, const PathingTexture& pathing_texture) {
+		// Width and height for centering change if rotation is not divisible by 180
+		const int div_w = (rotation % 180) ? pathing_texture.height : pathing_texture.width;
+		const int div_h = (rotation % 180) ? pathing_texture.width : pathing_texture.height;
+		return { static_cast<int>(std::floor(position.x * 4.f)) - div_w / 2, static_cast<int>(std::floor(position.y * 4.f)) - div_h / 2 };
+	}
+
+	/// Returns false if a cell where the rotated pathing texture has any of the flags in mask is already occupied on the dynamic pathing map.
 	/// Expects position in whole grid tiles
 	/// Rotation in multiples of 90
-	bool is_area_free(glm::vec2 position, int rotation, const std::shared_ptr<PathingTexture>& pathing_texture, uint8_t mask) {
-		const int div_w = (rotation % 180) ? pathing_texture->height : pathing_texture->width;
-		const int div_h = (rotation % 180) ? pathing_texture->width : pathing_texture->height;
-		for (int j = 0; j < pathing_texture->height; j++) {
-			for (int i = 0; i < pathing_texture->width; i++) {
-				int x = i;
-				int y = j;
-
-				switch (rotation) {
-					case 90:
-						x = pathing_texture->height - 1 - j;
-						y = i;
-						break;
-					case 180:
-						x = pathing_texture->width - 1 - i;
-						y = pathing_texture->height - 1 - j;
-						break;
-					case 270:
-						x = j;
-						y = pathing_texture->width - 1 - i;
-						break;
-				}
-
-				// Width and height for centering change if rotation is not divisible by 180
-				const int xx = position.x * 4 + x - div_w / 2;
-				const int yy = position.y * 4 + y - div_h / 2;
+	bool is_area_free(glm::vec2 position, int rotation, const std::shared_ptr<PathingTexture>& pathing_texture, uint8_t mask) const {
+		return is_stamp_free(pathing_texture->rotated(rotation), stamp_origin(position, rotation, *pathing_texture), mask);
+	}
 
-				if (xx < 0 || xx > width - 1 || yy < 0 || yy > height - 1) {
-					continue;
-				}
+	/// Blits a pathing texture to the specified location on the pathing map. Manually call update_dynamic() afterwards to upload the changes to the GPU
+	/// Expects position in whole grid tiles and draws the texture centered around this position
+	/// Rotation in multiples of 90
+	void blit_pathing_texture(glm::vec2 position, int rotation, const std::shared_ptr<PathingTexture>& pathing_texture) {
+		blit_stamp(pathing_texture->rotated(rotation), stamp_origin(position, rotation, *pathing_texture));
+	}
 
-				const unsigned int index = ((pathing_texture->height - 1 - j) * pathing_texture->width + i) * pathing_texture->channels;
+	/// Checks 8 cells at a time, the parts of the stamp outside of the map are ignored
+	bool is_stamp_free(const PathingStamp& stamp, const glm::ivec2 origin, const uint8_t mask) const {
+		const StampClip clip = clip_stamp(stamp, origin);
+		const uint64_t mask_word = 0x0101010101010101ull * mask;
 
-				uint8_t pathing_texture_mask = (pathing_texture->data[index] > 250) * Flags::unwalkable | (pathing_texture->data[index + 1] > 250) * Flags::unflyable | (pathing_texture->data[index + 2] > 250) * Flags::unbuildable;
+		for (int j = clip.y_begin; j < clip.y_end; j++) {
+			const uint8_t* source = stamp.cells.data() + j * stamp.width + clip.x_begin;
+			const uint8_t* target = pathing_cells_dynamic.data() + (origin.y + j) * width + origin.x + clip.x_begin;
+			const int count = clip.x_end - clip.x_begin;
 
-				if (pathing_texture_mask & mask && pathing_cells_dynamic[yy * width + xx] && mask) {
+			int i = 0;
+			for (; i + 8 <= count; i += 8) {
+				if (nonzero_bytes(load_word(source + i) & mask_word) & nonzero_bytes(load_word(target + i))) {
+					return false;
+				}
+			}
+			for (; i < count; i++) {
+				if ((source[i] & mask) && target[i]) {
 					return false;
 				}
 			}
@@ -143,61 +212,71 @@ export class PathingMap {
 		return true;
 	}
 
-	/// Blits a pathing texture to the specified location on the pathing map. Manually call update_dynamic() afterwards to upload the changes to the GPU
-	/// Expects position in whole grid tiles and draws the texture centered around this position
-	/// Rotation in multiples of 90
-	/// Blits the texture upside down as OpenGL uses the bottom-left as 0,0
-	void blit_pathing_texture(glm::vec2 position, int rotation, const std::shared_ptr<PathingTexture>& pathing_texture) {
-		const int div_w = (rotation % 180) ? pathing_texture->height : pathing_texture->width;
-		const int div_h = (rotation % 180) ? pathing_texture->width : pathing_texture->height;
-		for (int j = 0; j < pathing_texture->height; j++) {
-			for (int i = 0; i < pathing_texture->width; i++) {
-				int x = i;
-				int y = j;
-
-				switch (rotation) {
-					case 90:
-						x = pathing_texture->height - 1 - j;
-						y = i;
-						break;
-					case 180:
-						x = pathing_texture->width - 1 - i;
-						y = pathing_texture->height - 1 - j;
-						break;
-					case 270:
-						x = j;
-						y = pathing_texture->width - 1 - i;
-						break;
-				}
-
-				// Width and height for centering change if rotation is not divisible by 180
-				const int xx = position.x * 4 + x - div_w / 2;
-				const int yy = position.y * 4 + y - div_h / 2;
-
-				if (xx < 0 || xx > width - 1 || yy < 0 || yy > height - 1) {
-					continue;
-				}
-
-				const unsigned int index = ((pathing_texture->height - 1 - j) * pathing_texture->width + i) * pathing_texture->channels;
+	/// ORs the stamp onto the dynamic pathing 8 cells at a time, the parts outside of the map are skipped
+	void blit_stamp(const PathingStamp& stamp, const glm::ivec2 origin) {
+		const StampClip clip = clip_stamp(stamp, origin);
+		if (clip.y_begin < clip.y_end) {
+			dirty_dynamic |= QRect(origin.x + clip.x_begin, origin.y + clip.y_begin, clip.x_end - clip.x_begin, clip.y_end - clip.y_begin);
+		}
 
-				uint8_t bytes = (pathing_texture->data[index] > 250) * Flags::unwalkable | (pathing_texture->data[index + 1] > 250) * Flags::unflyable | (pathing_texture->data[index + 2] > 250) * Flags::unbuildable;
+		for (int j = clip.y_begin; j < clip.y_end; j++) {
+			const uint8_t* source = stamp.cells.data() + j * stamp.width + clip.x_begin;
+			uint8_t* target = pathing_cells_dynamic.data() + (origin.y + j) * width + origin.x + clip.x_begin;
+			const int count = clip.x_end - clip.x_begin;
 
-				pathing_cells_dynamic[yy * width + xx] |= bytes;
+			int i = 0;
+			for (; i + 8 <= count; i += 8) {
+				store_word(target + i, load_word(target + i) | load_word(source + i));
+			}
+			for (; i < count; i++) {
+				target[i] |= source[i];
 			}
 		}
 	}
 
+	/// Call after writing to pathing_cells_static directly, area is in pathing cells
+	void mark_static_dirty(const QRect& area) {
+		dirty_static |= area.intersected({ 0, 0, width, height });
+	}
+
+	/// Uploads the cells marked with mark_static_dirty() since the last upload
 	void upload_static_pathing() {
-		glTextureSubImage2D(texture_static, 0, 0, 0, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, pathing_cells_static.data());
+		upload_area(texture_static, pathing_cells_static, dirty_static);
 	}
 
+	/// Uploads the cells touched by dynamic_clear_area() and blit_pathing_texture() since the last upload
 	void upload_dynamic_pathing() {
-		glTextureSubImage2D(texture_dynamic, 0, 0, 0, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, pathing_cells_dynamic.data());
+		upload_area(texture_dynamic, pathing_cells_dynamic, dirty_dynamic);
+	}
+
+	/// Replaces the labels shown by the walkability overlay
+	void upload_components(const PathingComponents& components) {
+		if (texture_components == 0) {
+			glCreateTextures(GL_TEXTURE_2D, 1, &texture_components);
+			glTextureStorage2D(texture_components, 1, GL_R32UI, width, height);
+			glTextureParameteri(texture_components, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(texture_components, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTextureParameteri(texture_components, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(texture_components, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+		glTextureSubImage2D(texture_components, 0, 0, 0, width, height, GL_RED_INTEGER, GL_UNSIGNED_INT, components.labels.data());
+	}
+
+	QRect take_changed_cells() {
+		return std::exchange(changed_cells, QRect());
 	}
 
 	void resize(size_t new_width, size_t new_height) {
 		width = new_width;
 		height = new_height;
+		dirty_static = QRect();
+		dirty_dynamic = QRect();
+		changed_cells = QRect(0, 0, width, height);
+		cells_version += 1;
+
+		// Outdated, recreated at the new size by the next analysis
+		glDeleteTextures(1, &texture_components);
+		texture_components = 0;
 
 		pathing_cells_static.resize(width * height);
 		pathing_cells_dynamic.resize(width * height);
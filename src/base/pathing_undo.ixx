@@ -6,29 +6,42 @@ export module PathingUndo;
 
 import std;
 import WorldUndoManager;
+import UndoDelta;
 import PathingMap;
 
 export class PathingMapAction : public WorldCommand {
+	/// Sets the cells to how they were before or after the change
+	void apply(WorldEditContext& ctx, const bool after) const {
+		const auto cell = [&](const size_t i) -> uint8_t& {
+			return ctx.pathing_map.pathing_cells_static[(area.top() + i / area.width()) * ctx.pathing_map.width + area.left() + i % area.width()];
+		};
+		if (after) {
+			cells.redo<uint8_t>(cell);
+		} else {
+			cells.undo<uint8_t>(cell);
+		}
+		ctx.pathing_map.mark_static_dirty(area);
+		ctx.pathing_map.upload_static_pathing();
+	}
+
 public:
 	QRect area;
-	std::vector<uint8_t> old_pathing;
-	std::vector<uint8_t> new_pathing;
+	/// The static pathing cells of area in row major order
+	ByteDelta cells;
 
 	void undo(WorldEditContext& ctx) override {
-		for (int j = area.top(); j <= area.bottom(); j++) {
-			for (int i = area.left(); i <= area.right(); i++) {
-				ctx.pathing_map.pathing_cells_static[j * ctx.pathing_map.width + i] = old_pathing[(j - area.top()) * area.width() + i - area.left()];
-			}
-		}
-		ctx.pathing_map.upload_static_pathing();
+		apply(ctx, false);
 	}
 
 	void redo(WorldEditContext& ctx) override {
-		for (int j = area.top(); j <= area.bottom(); j++) {
-			for (int i = area.left(); i <= area.right(); i++) {
-				ctx.pathing_map.pathing_cells_static[j * ctx.pathing_map.width + i] = new_pathing[(j - area.top()) * area.width() + i - area.left()];
-			}
-		}
-		ctx.pathing_map.upload_static_pathing();
+		apply(ctx, true);
+	}
+
+	size_t memory_size() const override {
+		return sizeof(PathingMapAction) + cells.memory_size();
+	}
+
+	void compress() override {
+		cells.compress();
 	}
 };
\ No newline at end of file
@@ -0,0 +1,314 @@
+export module Picking;
+
+import std;
+import types;
+import <glm/glm.hpp>;
+
+/// Distance along the ray to where it enters the box, 0 if the origin is inside and infinity if the box is missed.
+/// Takes 1 / direction so the division is done once per ray
+export float ray_box_distance(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& inverse_direction) {
+	const glm::vec3 t1 = (min - origin) * inverse_direction;
+	const glm::vec3 t2 = (max - origin) * inverse_direction;
+	const glm::vec3 tmin = glm::min(t1, t2);
+	const glm::vec3 tmax = glm::max(t1, t2);
+
+	const float enter = std::max({ tmin.x, tmin.y, tmin.z, 0.f });
+	const float exit = std::min({ tmax.x, tmax.y, tmax.z });
+	return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+/// Möller-Trumbore, both sides of the triangle count as a hit
+export std::optional<float> ray_triangle_distance(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	const glm::vec3 edge1 = b - a;
+	const glm::vec3 edge2 = c - a;
+	const glm::vec3 p = glm::cross(direction, edge2);
+	const float determinant = glm::dot(edge1, p);
+	if (std::abs(determinant) < 1e-10f) {
+		return {};
+	}
+	const float inverse_determinant = 1.f / determinant;
+
+	const glm::vec3 s = origin - a;
+	const float u = glm::dot(s, p) * inverse_determinant;
+	if (u < 0.f || u > 1.f) {
+		return {};
+	}
+
+	const glm::vec3 q = glm::cross(s, edge1);
+	const float v = glm::dot(direction, q) * inverse_determinant;
+	if (v < 0.f || u + v > 1.f) {
+		return {};
+	}
+
+	const float t = glm::dot(edge2, q) * inverse_determinant;
+	if (t < 0.f) {
+		return {};
+	}
+	return t;
+}
+
+/// Bounding volume hierarchy over the triangles of a mesh.
+/// The topology is built once, posed vertices only need the node bounds to be refitted
+export class TriangleBVH {
+  public:
+	struct Node {
+		glm::vec3 min;
+		u32 first; // The left child (the right child follows it) or the first triangle of a leaf
+		glm::vec3 max;
+		u32 count; // Triangles in a leaf, 0 for inner nodes
+	};
+
+	static constexpr size_t max_leaf_size = 4;
+
+	std::vector<Node> nodes;
+	/// Vertex indices, reordered so that every leaf covers a contiguous range
+	std::vector<glm::uvec3> triangles;
+	/// The geoset of every triangle, parallel to triangles
+	std::vector<u32> triangle_geosets;
+
+	/// Splits the triangles at the median centroid along the longest axis until the leaves are small enough
+	void build(const std::span<const glm::vec3> positions) {
+		nodes.clear();
+		if (triangles.empty()) {
+			return;
+		}
+
+		std::vector<glm::vec3> centroids(triangles.size());
+		for (size_t i = 0; i < triangles.size(); i++) {
+			centroids[i] = (positions[triangles[i].x] + positions[triangles[i].y] + positions[triangles[i].z]) / 3.f;
+		}
+
+		std::vector<u32> order(triangles.size());
+		std::iota(order.begin(), order.end(), 0);
+
+		struct Task {
+			u32 node;
+			u32 first;
+			u32 count;
+		};
+		std::vector<Task> stack = { { 0, 0, static_cast<u32>(triangles.size()) } };
+		nodes.push_back({});
+
+		while (!stack.empty()) {
+			const Task task = stack.back();
+			stack.pop_back();
+
+			if (task.count <= max_leaf_size) {
+				nodes[task.node].first = task.first;
+				nodes[task.node].count = task.count;
+				continue;
+			}
+
+			glm::vec3 centroid_min(std::numeric_limits<float>::max());
+			glm::vec3 centroid_max(std::numeric_limits<float>::lowest());
+			for (u32 i = task.first; i < task.first + task.count; i++) {
+				centroid_min = glm::min(centroid_min, centroids[order[i]]);
+				centroid_max = glm::max(centroid_max, centroids[order[i]]);
+			}
+
+			const glm::vec3 size = centroid_max - centroid_min;
+			const int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+
+			const u32 half = task.count / 2;
+			std::nth_element(order.begin() + task.first, order.begin() + task.first + half, order.begin() + task.first + task.count, [&](const u32 a, const u32 b) {
+				return centroids[a][axis] < centroids[b][axis];
+			});
+
+			const u32 left = static_cast<u32>(nodes.size());
+			nodes[task.node].first = left;
+			nodes[task.node].count = 0;
+			nodes.push_back({});
+			nodes.push_back({});
+
+			stack.push_back({ left, task.first, half });
+			stack.push_back({ left + 1, task.first + half, task.count - half });
+		}
+
+		std::vector<glm::uvec3> sorted_triangles(triangles.size());
+		std::vector<u32> sorted_geosets(triangles.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			sorted_triangles[i] = triangles[order[i]];
+			sorted_geosets[i] = triangle_geosets[order[i]];
+		}
+		triangles = std::move(sorted_triangles);
+		triangle_geosets = std::move(sorted_geosets);
+
+		refit(positions, nodes);
+	}
+
+	/// Recomputes the bounds of target (a copy of nodes) for the given vertex positions.
+	/// Children always come after their parent so one backwards pass is enough
+	void refit(const std::span<const glm::vec3> positions, const std::span<Node> target) const {
+		for (size_t i = target.size(); i-- > 0;) {
+			Node& node = target[i];
+			if (node.count == 0) {
+				node.min = glm::min(target[node.first].min, target[node.first + 1].min);
+				node.max = glm::max(target[node.first].max, target[node.first + 1].max);
+				continue;
+			}
+
+			node.min = glm::vec3(std::numeric_limits<float>::max());
+			node.max = glm::vec3(std::numeric_limits<float>::lowest());
+			for (u32 j = node.first; j < node.first + node.count; j++) {
+				for (int k = 0; k < 3; k++) {
+					node.min = glm::min(node.min, positions[triangles[j][k]]);
+					node.max = glm::max(node.max, positions[triangles[j][k]]);
+				}
+			}
+		}
+	}
+
+	/// Distance along direction to the nearest triangle of a geoset for which visible(geoset) holds
+	template <typename F>
+	std::optional<float> intersect(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const std::span<const glm::vec3> positions,
+		const std::span<const Node> target,
+		F&& visible
+	) const {
+		if (target.empty()) {
+			return {};
+		}
+
+		const glm::vec3 inverse_direction = 1.f / direction;
+		float nearest = std::numeric_limits<float>::infinity();
+
+		// The median split keeps the depth at log2 of the triangle count
+		u32 stack[64];
+		size_t top = 0;
+		stack[top++] = 0;
+
+		while (top > 0) {
+			const Node& node = target[stack[--top]];
+			if (ray_box_distance(node.min, node.max, origin, inverse_direction) >= nearest) {
+				continue;
+			}
+
+			if (node.count == 0) {
+				stack[top++] = node.first;
+				stack[top++] = node.first + 1;
+				continue;
+			}
+
+			for (u32 i = node.first; i < node.first + node.count; i++) {
+				if (!visible(triangle_geosets[i])) {
+					continue;
+				}
+				const glm::uvec3& triangle = triangles[i];
+				const auto distance = ray_triangle_distance(origin, direction, positions[triangle.x], positions[triangle.y], positions[triangle.z]);
+				if (distance && *distance < nearest) {
+					nearest = *distance;
+				}
+			}
+		}
+
+		if (nearest == std::numeric_limits<float>::infinity()) {
+			return {};
+		}
+		return nearest;
+	}
+};
+
+/// The triangles and skin weights of a model, for picking instances in either their bind pose or their current pose.
+/// Does not touch GL so it can be tested without a context
+export class PickingMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::u8vec4> bone_indices;
+	std::vector<glm::u8vec4> bone_weights;
+	TriangleBVH bvh;
+
+	// Scratch space reused between posed queries, so a PickingMesh is not safe to query from multiple threads
+	mutable std::vector<glm::vec3> posed_positions;
+	mutable std::vector<TriangleBVH::Node> posed_nodes;
+
+  public:
+	/// skin has 8 bytes per vertex, 4 bone indices followed by 4 weights like mdx::Geoset::skin
+	void add_geoset(const std::span<const glm::vec3> vertices, const std::span<const u16> faces, const std::span<const u8> skin, const u32 geoset) {
+		const u32 base = static_cast<u32>(positions.size());
+		positions.insert(positions.end(), vertices.begin(), vertices.end());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			bone_indices.emplace_back(skin[i * 8], skin[i * 8 + 1], skin[i * 8 + 2], skin[i * 8 + 3]);
+			bone_weights.emplace_back(skin[i * 8 + 4], skin[i * 8 + 5], skin[i * 8 + 6], skin[i * 8 + 7]);
+		}
+
+		for (size_t i = 0; i + 2 < faces.size(); i += 3) {
+			bvh.triangles.emplace_back(base + faces[i], base + faces[i + 1], base + faces[i + 2]);
+			bvh.triangle_geosets.push_back(geoset);
+		}
+	}
+
+	/// Call once after all geosets have been added
+	void build() {
+		bvh.build(positions);
+	}
+
+	size_t triangle_count() const {
+		return bvh.triangles.size();
+	}
+
+	/// Tests the model space ray against the bind pose
+	template <typename F>
+	std::optional<float> intersect(const glm::vec3& origin, const glm::vec3& direction, F&& visible) const {
+		return bvh.intersect(origin, direction, positions, bvh.nodes, visible);
+	}
+
+	/// Tests the model space ray against the mesh skinned with bones, the model space matrices of the bones.
+	/// Skinning matches preskin_mesh.comp and the refit keeps the tree built from the bind pose
+	template <typename F>
+	std::optional<float> intersect_posed(const glm::vec3& origin, const glm::vec3& direction, const std::span<const glm::mat4> bones, F&& visible) const {
+		if (bones.empty()) {
+			return intersect(origin, direction, visible);
+		}
+
+		posed_positions.resize(positions.size());
+		for (size_t i = 0; i < positions.size(); i++) {
+			glm::mat4 skin(0.f);
+			for (int j = 0; j < 4; j++) {
+				if (bone_weights[i][j] != 0 && bone_indices[i][j] < bones.size()) {
+					skin += bones[bone_indices[i][j]] * (bone_weights[i][j] / 255.f);
+				}
+			}
+			posed_positions[i] = skin * glm::vec4(positions[i], 1.f);
+		}
+
+		posed_nodes.assign(bvh.nodes.begin(), bvh.nodes.end());
+		bvh.refit(posed_positions, posed_nodes);
+		return bvh.intersect(origin, direction, posed_positions, posed_nodes, visible);
+	}
+};
+
+/// Finds the nearest of count objects hit by a world space ray and returns its index with the distance along the ray.
+/// bounds(index, min, max) writes the world space bounds of an object and returns false for objects that can't be picked,
+/// hit(index) does the exact test. Objects are tested exactly in order of where the ray enters their bounds,
+/// so the exact tests stop as soon as the next box starts behind the nearest hit
+export template <typename B, typename H>
+std::optional<std::pair<size_t, float>> pick_nearest(const glm::vec3& origin, const glm::vec3& direction, const size_t count, B&& bounds, H&& hit) {
+	const glm::vec3 inverse_direction = 1.f / direction;
+
+	std::vector<std::pair<float, size_t>> candidates;
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 min;
+		glm::vec3 max;
+		if (!bounds(i, min, max)) {
+			continue;
+		}
+		const float distance = ray_box_distance(min, max, origin, inverse_direction);
+		if (distance != std::numeric_limits<float>::infinity()) {
+			candidates.emplace_back(distance, i);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	std::optional<std::pair<size_t, float>> nearest;
+	for (const auto& [enter, index] : candidates) {
+		if (nearest && enter > nearest->second) {
+			break;
+		}
+		const std::optional<float> distance = hit(index);
+		if (distance && (!nearest || *distance < nearest->second)) {
+			nearest = { index, *distance };
+		}
+	}
+	return nearest;
+}
\ No newline at end of file
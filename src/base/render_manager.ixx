@@ -5,6 +5,11 @@ export module RenderManager;
 import std;
 import types;
 import SkinnedMesh;
+import MeshArena;
+import DrawCommands;
+import FrameArena;
+import Profiler;
+import GPUBuffer;
 import Shader;
 import SkeletalModelInstance;
 import ResourceManager;
@@ -12,6 +17,7 @@ import Timer;
 import MDX;
 import Camera;
 import Utilities;
+import Picking;
 import Globals;
 import Units;
 import <glad/glad.h>;
@@ -28,25 +34,96 @@ export class RenderManager {
 		float distance;
 	};
 
+	/// An instance that already passed the visibility test
+	struct QueuedInstance {
+		SkinnedMesh* mesh;
+		const SkeletalModelInstance* skeleton;
+		glm::vec3 color;
+	};
+
 	std::shared_ptr<Shader> instance_skinned_mesh_shader_sd;
 	std::shared_ptr<Shader> instance_skinned_mesh_shader_hd;
 	std::shared_ptr<Shader> skinned_mesh_shader_sd;
 	std::shared_ptr<Shader> skinned_mesh_shader_hd;
 	std::shared_ptr<Shader> preskin_mesh_shader;
-	std::shared_ptr<Shader> colored_skinned_shader;
+	std::shared_ptr<Shader> instance_skinned_mesh_oit_shader_sd;
+	std::shared_ptr<Shader> instance_skinned_mesh_oit_shader_hd;
+	std::shared_ptr<Shader> oit_composite_shader;
 
-	std::vector<SkinnedMesh*> skinned_meshes;
-	std::vector<SkinnedInstance> skinned_transparent_instances;
+	// The render lists only live for one frame and are allocated from the frame arena
+	frame_vector<SkinnedMesh*> skinned_meshes;
+	frame_vector<SkinnedInstance> skinned_transparent_instances;
 
 	std::shared_ptr<SkinnedMesh> click_helper;
-	std::vector<SkeletalModelInstance> click_helper_instances;
+	// All click helpers share the same (static) pose, so only their matrices differ
+	SkeletalModelInstance click_helper_skeleton;
+	frame_vector<glm::mat4> click_helper_matrices;
+
+	// Per frame animation data (bone matrices, layer colors) and draw commands of all meshes
+	StreamBuffer<> stream_buffer;
+	size_t uploaded_bytes = 0;
+	size_t rendered_instances = 0;
+
+	// The per instance data of all meshes is concatenated so one draw command list can address all of it
+	// Instance matrices only change when objects are edited or the set of visible objects changes
+	RetainedBuffer<glm::mat4> instance_buffer;
+	frame_vector<glm::mat4> instance_matrices;
+	frame_vector<glm::vec4> layer_colors;
+	StreamBuffer<>::Range layer_colors_range;
+	GrowableBuffer<> preskinned_vertex_buffer;
+	GrowableBuffer<> preskinned_tangent_light_direction_buffer;
+
+	DrawCommandList opaque_draws;
+	size_t opaque_draw_calls = 0;
+	size_t transparent_draw_calls = 0;
+
+	// Weighted blended order independent transparency for the alpha blended layers, an alternative to sorting the instances
+	DrawCommandList blended_draws;
+	size_t blended_draw_calls = 0;
+	GLuint oit_framebuffer = 0;
+	GLuint oit_accumulation = 0;
+	GLuint oit_revealage = 0;
+	GLuint oit_depth = 0;
+
+	// Consecutive transparent instances of the same mesh at nearly the same distance, drawn instanced
+	struct TransparentRun {
+		SkinnedMesh* mesh;
+		uint32_t first;
+		uint32_t count;
+	};
+	RadixSort transparent_sort;
+	std::vector<u64> transparent_keys;
+	std::vector<uint32_t> transparent_order;
+	std::vector<uint32_t> transparent_instance_ids;
+	std::vector<TransparentRun> transparent_runs;
+
+	// The instances of one mesh in queue_visible() and where they go
+	struct VisibleRun {
+		SkinnedMesh* mesh;
+		size_t first;
+		size_t count;
+		size_t job_offset;
+		size_t transparent_offset;
+	};
+	frame_vector<VisibleRun> visible_runs;
+
+	void grow_run(VisibleRun& run) {
+		run.mesh->render_jobs.resize(run.job_offset + run.count);
+		run.mesh->render_colors.resize(run.job_offset + run.count);
+		run.mesh->skeletons.resize(run.job_offset + run.count);
+		if (run.mesh->has_mesh && run.mesh->has_transparent_layers) {
+			skinned_transparent_instances.resize(run.transparent_offset + run.count);
+		}
+	}
+
+	/// Picks against the bind pose of the models instead of skinning their current pose, faster but misses parts that animate far from their rest position
+	bool pick_in_bind_pose = false;
 
-	GLuint color_buffer;
-	GLuint depth_buffer;
-	GLuint color_picking_framebuffer;
+	// Which geosets of the mesh being picked are visible, kept so pick_mesh() doesn't allocate per candidate
+	mutable std::vector<bool> pick_visible_geosets;
 
-	int window_width;
-	int window_height;
+	int window_width = 800;
+	int window_height = 600;
 
 	RenderManager() {
 		instance_skinned_mesh_shader_sd = resource_manager.load<Shader>({ "data/shaders/skinned_mesh_instanced_sd.vert", "data/shaders/skinned_mesh_instanced_sd.frag" });
@@ -54,38 +131,37 @@ export class RenderManager {
 		skinned_mesh_shader_sd = resource_manager.load<Shader>({ "data/shaders/skinned_mesh_sd.vert", "data/shaders/skinned_mesh_sd.frag" });
 		skinned_mesh_shader_hd = resource_manager.load<Shader>({ "data/shaders/skinned_mesh_hd.vert", "data/shaders/skinned_mesh_hd.frag" });
 		preskin_mesh_shader = resource_manager.load<Shader>({ "data/shaders/preskin_mesh.comp" });
-		colored_skinned_shader = resource_manager.load<Shader>({ "data/shaders/skinned_mesh_instance_color_coded.vert", "data/shaders/skinned_mesh_instance_color_coded.frag" });
+		instance_skinned_mesh_oit_shader_sd = resource_manager.load<Shader>({ "data/shaders/skinned_mesh_instanced_sd.vert", "data/shaders/skinned_mesh_instanced_oit_sd.frag" });
+		instance_skinned_mesh_oit_shader_hd = resource_manager.load<Shader>({ "data/shaders/skinned_mesh_instanced_hd.vert", "data/shaders/skinned_mesh_instanced_oit_hd.frag" });
+		oit_composite_shader = resource_manager.load<Shader>({ "data/shaders/oit_composite.vert", "data/shaders/oit_composite.frag" });
 		
 		click_helper = resource_manager.load<SkinnedMesh>("Objects/InvalidObject/InvalidObject.mdx", "", std::nullopt);
+		click_helper_skeleton = SkeletalModelInstance(click_helper->model, click_helper->topology);
+		click_helper_skeleton.update(0.016f);
 
-		glCreateFramebuffers(1, &color_picking_framebuffer);
-
-		glCreateRenderbuffers(1, &color_buffer);
-		glNamedRenderbufferStorage(color_buffer, GL_RGBA8, 800, 600);
-		glNamedFramebufferRenderbuffer(color_picking_framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer);
-
-		glCreateRenderbuffers(1, &depth_buffer);
-		glNamedRenderbufferStorage(depth_buffer, GL_DEPTH24_STENCIL8, 800, 600);
-		glNamedFramebufferRenderbuffer(color_picking_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
-
-		if (glCheckNamedFramebufferStatus(color_picking_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-			std::println("ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n");
-		}
+		glCreateFramebuffers(1, &oit_framebuffer);
+		create_oit_targets(800, 600);
 	}
 
 	~RenderManager() {
-		glDeleteRenderbuffers(1, &color_buffer);
-		glDeleteRenderbuffers(1, &depth_buffer);
-		glDeleteFramebuffers(1, &color_picking_framebuffer);
+		glDeleteTextures(1, &oit_accumulation);
+		glDeleteTextures(1, &oit_revealage);
+		glDeleteRenderbuffers(1, &oit_depth);
+		glDeleteFramebuffers(1, &oit_framebuffer);
 	}
 
 	void queue_render(SkinnedMesh& skinned_mesh, const SkeletalModelInstance& skeleton, glm::vec3 color) {
+		queue_render(skinned_mesh, skeleton, skeleton.matrix, color);
+	}
+
+	/// Queues the skeleton for rendering with a different instance matrix, used to render several instances sharing the same pose
+	void queue_render(SkinnedMesh& skinned_mesh, const SkeletalModelInstance& skeleton, const glm::mat4& matrix, glm::vec3 color) {
 		mdx::Extent& extent = skinned_mesh.model->sequences[skeleton.sequence_index].extent;
-		if (!camera.inside_frustrum(skeleton.matrix * glm::vec4(extent.minimum, 1.f), skeleton.matrix * glm::vec4(extent.maximum, 1.f))) {
+		if (!camera.inside_frustrum(matrix * glm::vec4(extent.minimum, 1.f), matrix * glm::vec4(extent.maximum, 1.f))) {
 			return;
 		}
 
-		skinned_mesh.render_jobs.push_back(skeleton.matrix);
+		skinned_mesh.render_jobs.push_back(matrix);
 		skinned_mesh.render_colors.push_back(color);
 		skinned_mesh.skeletons.push_back(&skeleton);
 
@@ -104,57 +180,167 @@ export class RenderManager {
 			skinned_transparent_instances.push_back(RenderManager::SkinnedInstance{
 				.mesh = &skinned_mesh,
 				.instance_id = static_cast<uint32_t>(skinned_mesh.render_jobs.size() - 1),
-				.distance = glm::distance(camera.position - camera.direction * camera.distance, glm::vec3(skeleton.matrix[3])),
+				.distance = glm::distance(camera.position - camera.direction * camera.distance, glm::vec3(matrix[3])),
 			});
 		}
 	}
 
-	// Renders a click helper (little purple checkered box), kinda inefficient but couldn't be bothered writing a whole new rendering path
-	void queue_click_helper(glm::mat4 model) {
-		auto a = SkeletalModelInstance(click_helper->model);
-		a.matrix = model;
-		a.update(0.016f);
-		click_helper_instances.push_back(a);
+	/// Groups the instances per mesh. Instances of the same mesh are ordered by skeleton address to keep the order stable without the scratch buffer of std::stable_sort.
+	/// Sorted sequentially, the parallel sort allocates its temporary buffers on every call
+	static void group_by_mesh(const std::span<QueuedInstance> instances) {
+		std::sort(instances.begin(), instances.end(), [](const QueuedInstance& left, const QueuedInstance& right) {
+			if (left.mesh != right.mesh) {
+				return std::less<SkinnedMesh*>()(left.mesh, right.mesh);
+			}
+			return std::less<const SkeletalModelInstance*>()(left.skeleton, right.skeleton);
+		});
+	}
+
+	/// Queues instances that were already found to be visible, skipping the frustum test of queue_render().
+	/// The instances are grouped per mesh after which every mesh appends its instances in parallel
+	void queue_visible(frame_vector<QueuedInstance>& instances) {
+		group_by_mesh(instances);
+
+		// Reserve the space of every mesh up front so the meshes can be filled independently
+		visible_runs.clear();
+		for (size_t i = 0; i < instances.size(); i++) {
+			SkinnedMesh* mesh = instances[i].mesh;
+			if (!visible_runs.empty() && visible_runs.back().mesh == mesh) {
+				visible_runs.back().count += 1;
+				continue;
+			}
+
+			if (!visible_runs.empty()) {
+				grow_run(visible_runs.back());
+			}
+			if (mesh->render_jobs.empty()) {
+				skinned_meshes.push_back(mesh);
+			}
+			visible_runs.push_back({ mesh, i, 1, mesh->render_jobs.size(), skinned_transparent_instances.size() });
+		}
+		if (!visible_runs.empty()) {
+			grow_run(visible_runs.back());
+		}
+
+		const glm::vec3 eye = camera.position - camera.direction * camera.distance;
+		std::for_each(std::execution::par, visible_runs.begin(), visible_runs.end(), [&](const VisibleRun& run) {
+			SkinnedMesh& mesh = *run.mesh;
+			const bool transparent = mesh.has_mesh && mesh.has_transparent_layers;
+			for (size_t i = 0; i < run.count; i++) {
+				const QueuedInstance& instance = instances[run.first + i];
+				mesh.render_jobs[run.job_offset + i] = instance.skeleton->matrix;
+				mesh.render_colors[run.job_offset + i] = instance.color;
+				mesh.skeletons[run.job_offset + i] = instance.skeleton;
+
+				if (transparent) {
+					skinned_transparent_instances[run.transparent_offset + i] = {
+						.mesh = &mesh,
+						.instance_id = static_cast<uint32_t>(run.job_offset + i),
+						.distance = glm::distance(eye, glm::vec3(instance.skeleton->matrix[3])),
+					};
+				}
+			}
+		});
+	}
+
+	// Renders a click helper (little purple checkered box)
+	void queue_click_helper(const glm::mat4& model) {
+		click_helper_matrices.push_back(model);
 	}
 
-	void render(bool render_lighting, glm::vec3 light_direction) {
+	/// With weighted_transparency the alpha blended layers are drawn order independent, the sorted path then only draws the other transparent layers
+	void render(bool render_lighting, glm::vec3 light_direction, bool weighted_transparency) {
 		GLint old_vao;
 		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &old_vao);
 
-		for (const auto& i : click_helper_instances) {
-			queue_render(*click_helper, i, glm::vec3(1.f));
+		for (const auto& i : click_helper_matrices) {
+			queue_render(*click_helper, click_helper_skeleton, i, glm::vec3(1.f));
 		}
 
-		uint64_t size = 0;
+		ProfileScope upload_scope("upload_render_data");
+
+		stream_buffer.begin_frame();
+		uploaded_bytes = 0;
+		instance_matrices.clear();
+		layer_colors.clear();
+
+		// Sized up front, growing would leave the smaller copies behind in the frame arena
+		size_t instance_count = 0;
+		size_t layer_color_count = 0;
+		for (const auto& i : skinned_meshes) {
+			instance_count += i->render_jobs.size();
+			layer_color_count += i->has_mesh ? i->render_jobs.size() * i->skip_count : 0;
+		}
+		instance_matrices.reserve(instance_count);
+		layer_colors.reserve(layer_color_count);
+		rendered_instances = instance_count;
+
+		size_t preskinned_vertices = 0;
 		for (const auto& i : skinned_meshes) {
-			i->upload_render_data(size);
+			uploaded_bytes += i->upload_render_data(stream_buffer);
+
+			i->instance_offset = instance_matrices.size();
+			instance_matrices.insert(instance_matrices.end(), i->render_jobs.begin(), i->render_jobs.end());
+			i->layer_color_offset = layer_colors.size();
+			layer_colors.insert(layer_colors.end(), i->layer_colors.begin(), i->layer_colors.end());
+			i->preskinned_offset = preskinned_vertices;
+			preskinned_vertices += i->instance_vertex_count * i->render_jobs.size();
 		}
 
+		uploaded_bytes += instance_buffer.upload(instance_matrices);
+		layer_colors_range = stream_buffer.write(layer_colors.data(), layer_colors.size() * sizeof(glm::vec4));
+		uploaded_bytes += layer_colors.size() * sizeof(glm::vec4);
+		preskinned_vertex_buffer.reserve(preskinned_vertices * sizeof(glm::uvec2));
+		preskinned_tangent_light_direction_buffer.reserve(preskinned_vertices * sizeof(uint32_t));
+		upload_scope.end();
+
+		ProfileScope preskin_scope("preskin", true);
 		preskin_mesh_shader->use();
 		glUniform3fv(6, 1, &light_direction.x);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instance_buffer.buffer());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, skinned_mesh_arena.vertex_snorm_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, skinned_mesh_arena.normal_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, skinned_mesh_arena.tangent_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, skinned_mesh_arena.weight_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, preskinned_vertex_buffer.buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, preskinned_tangent_light_direction_buffer.buffer);
 		for (const auto& i : skinned_meshes) {
 			i->preskin_geometry();
 		}
-		// Render opaque meshes
-		// These don't have to be sorted and can thus be drawn instanced (one draw call per type of mesh)
-		instance_skinned_mesh_shader_sd->use();
-		glUniformMatrix4fv(0, 1, false, &camera.projection_view[0][0]);
-		glUniform3fv(3, 1, &light_direction.x);
-		glBlendFunc(GL_ONE, GL_ZERO);
+		// The meshes write to disjoint parts of the output buffers, so one barrier for all of them is enough
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		preskin_scope.end();
+
+		// Shared by the opaque and transparent shaders
+		glBindVertexArray(skinned_mesh_arena.vao);
+		SkinnedMesh::bind_range(0, layer_colors_range);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, skinned_mesh_arena.uv_snorm_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, preskinned_vertex_buffer.buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, preskinned_tangent_light_direction_buffer.buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, skinned_mesh_arena.normal_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, instance_buffer.buffer());
 
+		// Render opaque meshes
+		// These don't have to be sorted, so the layers of all meshes are gathered in a command list and drawn per pipeline state
+		ProfileScope opaque_scope("opaque", true);
+		opaque_draws.clear();
 		for (const auto& i : skinned_meshes) {
-			i->render_opaque(false, render_lighting);
+			i->queue_opaque_draws(opaque_draws, render_lighting);
 		}
+		opaque_draws.sort();
+		opaque_draw_calls = submit_draws(opaque_draws, light_direction, *instance_skinned_mesh_shader_sd, *instance_skinned_mesh_shader_hd, false);
+		opaque_scope.end();
 
-		instance_skinned_mesh_shader_hd->use();
-		glUniformMatrix4fv(0, 1, false, &camera.projection_view[0][0]);
+		ProfileScope transparent_scope("transparent", true);
 
-		for (const auto& i : skinned_meshes) {
-			i->render_opaque(true, render_lighting);
+		blended_draw_calls = 0;
+		if (weighted_transparency) {
+			render_weighted_transparency(render_lighting, light_direction);
 		}
 
 		// Render transparent meshes
-		std::sort(skinned_transparent_instances.begin(), skinned_transparent_instances.end(), [](auto& left, auto& right) { return left.distance > right.distance; });
+		// Sorted back to front, instances of the same mesh at nearly the same distance are drawn together
+		sort_transparent_instances();
 		glEnable(GL_BLEND);
 		glDepthMask(false);
 
@@ -162,155 +348,341 @@ export class RenderManager {
 		glUniformMatrix4fv(0, 1, false, &camera.projection_view[0][0]);
 		glUniform3fv(8, 1, &light_direction.x);
 
-		for (const auto& i : skinned_transparent_instances) {
-			i.mesh->render_transparent(i.instance_id, false, render_lighting);
+		transparent_draw_calls = 0;
+		for (const auto& i : transparent_runs) {
+			transparent_draw_calls += i.mesh->render_transparent(i.first, std::span(transparent_instance_ids).subspan(i.first, i.count), false, render_lighting, weighted_transparency);
 		}
 
 		skinned_mesh_shader_hd->use();
 		glUniformMatrix4fv(0, 1, false, &camera.projection_view[0][0]);
 
-		for (const auto& i : skinned_transparent_instances) {
-			i.mesh->render_transparent(i.instance_id, true, render_lighting);
+		for (const auto& i : transparent_runs) {
+			transparent_draw_calls += i.mesh->render_transparent(i.first, std::span(transparent_instance_ids).subspan(i.first, i.count), true, render_lighting, weighted_transparency);
 		}
+		transparent_scope.end();
 
 		glBindVertexArray(old_vao);
+		stream_buffer.end_frame();
+
+		glDepthMask(true);
+
+		release_frame_lists();
+	}
 
+	/// Gives the memory of the per frame lists back so the frame arena can be reset.
+	/// Clearing is not enough as they would keep pointing into the arena
+	void release_frame_lists() {
 		for (const auto& i : skinned_meshes) {
-			i->render_jobs.clear();
-			i->render_colors.clear();
-			i->skeletons.clear();
-			i->instance_bone_matrices.clear();
+			release(i->render_jobs);
+			release(i->render_colors);
+			release(i->skeletons);
+			release(i->instance_bone_matrices);
+			release(i->layer_colors);
 		}
 
-		click_helper_instances.clear();
+		release(skinned_meshes);
+		release(skinned_transparent_instances);
+		release(click_helper_matrices);
+		release(instance_matrices);
+		release(layer_colors);
+		release(visible_runs);
+	}
 
-		glDepthMask(true);
+	/// Radix sorts the transparent instances and splits them in runs of the same mesh and (quantized) distance.
+	/// The instance indices of the runs are uploaded as one list and bound at 7
+	void sort_transparent_instances() {
+		transparent_keys.clear();
+		transparent_order.clear();
+		for (size_t i = 0; i < skinned_transparent_instances.size(); i++) {
+			const SkinnedInstance& instance = skinned_transparent_instances[i];
+			// The instance offset is unique for every mesh that is drawn this frame
+			transparent_keys.push_back(transparent_sort_key(instance.distance, instance.mesh->instance_offset));
+			transparent_order.push_back(static_cast<uint32_t>(i));
+		}
+		transparent_sort.sort(transparent_keys, transparent_order);
+
+		transparent_runs.clear();
+		transparent_instance_ids.clear();
+		for (size_t i = 0; i < transparent_order.size(); i++) {
+			const SkinnedInstance& instance = skinned_transparent_instances[transparent_order[i]];
+			if (i == 0 || transparent_keys[i] != transparent_keys[i - 1]) {
+				transparent_runs.push_back({ instance.mesh, static_cast<uint32_t>(transparent_instance_ids.size()), 0 });
+			}
+			transparent_instance_ids.push_back(instance.instance_id);
+			transparent_runs.back().count += 1;
+		}
 
-		skinned_meshes.clear();
-		skinned_transparent_instances.clear();
+		const auto range = stream_buffer.write(transparent_instance_ids.data(), transparent_instance_ids.size() * sizeof(uint32_t));
+		uploaded_bytes += transparent_instance_ids.size() * sizeof(uint32_t);
+		SkinnedMesh::bind_range(7, range);
 	}
 
-	void resize_framebuffers(int width, int height) {
-		glNamedRenderbufferStorage(color_buffer, GL_RGBA8, width, height);
-		glNamedRenderbufferStorage(depth_buffer, GL_DEPTH24_STENCIL8, width, height);
-		window_width = width;
-		window_height = height;
+	static void set_blend_mode(const uint32_t blend_mode) {
+		switch (blend_mode) {
+			case 0:
+			case 1:
+				glBlendFunc(GL_ONE, GL_ZERO);
+				break;
+			case 2:
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				break;
+			case 3:
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+				break;
+			case 4:
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+				break;
+			case 5:
+				glBlendFunc(GL_ZERO, GL_SRC_COLOR);
+				break;
+			case 6:
+				glBlendFunc(GL_DST_COLOR, GL_SRC_COLOR);
+				break;
+		}
 	}
 
-	/// Requires the OpenGL context to be active/current
-	/// Returns the unit ID of the unit that is currently under the mouse coordinates
-	/// Renders the meshes currently inside the view frustrum coded by unit ID and then reads the pixel under the mouse coordinates
-	std::optional<size_t> pick_unit_id_under_mouse(Units& units, glm::vec2 mouse_position) {
-		GLint old_fbo;
-		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &old_fbo);
-		GLint old_vao;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &old_vao);
+	/// Uploads a sorted command list and issues one glMultiDrawElementsIndirect per pipeline state. Returns the amount of draw calls.
+	/// Weighted blended draws keep the blend and depth write state set up by render_weighted_transparency()
+	size_t submit_draws(const DrawCommandList& list, const glm::vec3& light_direction, const Shader& shader_sd, const Shader& shader_hd, const bool weighted_blended) {
+		if (list.commands.empty()) {
+			return 0;
+		}
+
+		const auto commands = stream_buffer.write(list.commands.data(), list.commands.size() * sizeof(DrawElementsIndirectCommand));
+		const auto draw_data = stream_buffer.write(list.draw_data.data(), list.draw_data.size() * sizeof(DrawData));
+		uploaded_bytes += commands.size + draw_data.size;
+
+		SkinnedMesh::bind_range(6, draw_data);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.buffer);
+
+		const Shader* current_shader = nullptr;
+		for (const auto& group : list.groups) {
+			const Shader* shader = group.state.hd ? &shader_hd : &shader_sd;
+			if (shader != current_shader) {
+				shader->use();
+				glUniformMatrix4fv(0, 1, false, &camera.projection_view[0][0]);
+				if (!group.state.hd) {
+					glUniform3fv(3, 1, &light_direction.x);
+				}
+				current_shader = shader;
+			}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, color_picking_framebuffer);
+			// gl_DrawID restarts at 0 for every call
+			glUniform1ui(1, group.first);
+			if (!weighted_blended) {
+				set_blend_mode(group.state.blend_mode);
+			}
 
-		glClearColor(0, 0, 0, 1);
-		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-		glViewport(0, 0, window_width, window_height);
+			if (group.state.two_sided) {
+				glDisable(GL_CULL_FACE);
+			} else {
+				glEnable(GL_CULL_FACE);
+			}
 
-		glDepthMask(true);
-		glDisable(GL_BLEND);
+			if (group.state.depth_test) {
+				glEnable(GL_DEPTH_TEST);
+			} else {
+				glDisable(GL_DEPTH_TEST);
+			}
 
-		colored_skinned_shader->use();
-		for (size_t i = 0; i < units.units.size(); i++) {
-			const Unit& unit = units.units[i];
-			if (unit.id == "sloc") {
-				continue;
-			} // ToDo handle starting locations
+			if (!weighted_blended) {
+				glDepthMask(group.state.depth_write);
+			}
+
+			const size_t offset = commands.offset + group.first * sizeof(DrawElementsIndirectCommand);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, reinterpret_cast<void*>(offset), group.count, 0);
+		}
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		return list.groups.size();
+	}
 
-			mdx::Extent& extent = unit.mesh->model->sequences[unit.skeleton.sequence_index].extent;
-			if (camera.inside_frustrum(unit.skeleton.matrix * glm::vec4(extent.minimum, 1.f), unit.skeleton.matrix * glm::vec4(extent.maximum, 1.f))) {
-				unit.mesh->render_color_coded(unit.skeleton, i + 1);
+	/// Draws the alpha blended layers of all transparent meshes in any order into the accumulation and revealage targets,
+	/// then composites them over the scene in a single full screen pass
+	void render_weighted_transparency(bool render_lighting, const glm::vec3& light_direction) {
+		blended_draws.clear();
+		for (const auto& i : skinned_meshes) {
+			if (i->has_transparent_layers) {
+				i->queue_blended_draws(blended_draws, render_lighting);
 			}
 		}
+		blended_draws.sort();
+		if (blended_draws.commands.empty()) {
+			return;
+		}
 
-		glm::u8vec4 color;
-		glReadPixels(mouse_position.x, window_height - mouse_position.y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &color);
+		GLint scene_framebuffer;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &scene_framebuffer);
+
+		// The blended layers are depth tested against the opaque scene. Blitting needs matching formats, both are GL_DEPTH24_STENCIL8
+		glBlitNamedFramebuffer(scene_framebuffer, oit_framebuffer, 0, 0, window_width, window_height, 0, 0, window_width, window_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+		constexpr float clear_accumulation[] = { 0.f, 0.f, 0.f, 0.f };
+		constexpr float clear_revealage[] = { 1.f, 1.f, 1.f, 1.f };
+		glClearNamedFramebufferfv(oit_framebuffer, GL_COLOR, 0, clear_accumulation);
+		glClearNamedFramebufferfv(oit_framebuffer, GL_COLOR, 1, clear_revealage);
+		glBindFramebuffer(GL_FRAMEBUFFER, oit_framebuffer);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, old_fbo);
-		glBindVertexArray(old_vao);
 		glEnable(GL_BLEND);
+		glBlendFunci(0, GL_ONE, GL_ONE);
+		glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+		glDepthMask(false);
+		blended_draw_calls = submit_draws(blended_draws, light_direction, *instance_skinned_mesh_oit_shader_sd, *instance_skinned_mesh_oit_shader_hd, true);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, scene_framebuffer);
+		glDisable(GL_DEPTH_TEST);
+		glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+		oit_composite_shader->use();
+		glBindTextureUnit(0, oit_accumulation);
+		glBindTextureUnit(1, oit_revealage);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	/// The textures use immutable storage so they are recreated on every resize
+	void create_oit_targets(const int width, const int height) {
+		glDeleteTextures(1, &oit_accumulation);
+		glDeleteTextures(1, &oit_revealage);
+		glDeleteRenderbuffers(1, &oit_depth);
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &oit_accumulation);
+		glTextureStorage2D(oit_accumulation, 1, GL_RGBA16F, width, height);
+		glNamedFramebufferTexture(oit_framebuffer, GL_COLOR_ATTACHMENT0, oit_accumulation, 0);
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &oit_revealage);
+		glTextureStorage2D(oit_revealage, 1, GL_R8, width, height);
+		glNamedFramebufferTexture(oit_framebuffer, GL_COLOR_ATTACHMENT1, oit_revealage, 0);
 
-		const int index = color.r + (color.g << 8) + (color.b << 16);
-		if (index != 0) {
-			return { index - 1 };
-		} else {
+		glCreateRenderbuffers(1, &oit_depth);
+		glNamedRenderbufferStorage(oit_depth, GL_DEPTH24_STENCIL8, width, height);
+		glNamedFramebufferRenderbuffer(oit_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, oit_depth);
+
+		constexpr GLenum draw_buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glNamedFramebufferDrawBuffers(oit_framebuffer, 2, draw_buffers);
+
+		if (glCheckNamedFramebufferStatus(oit_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::println("ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n");
+		}
+	}
+
+	void resize_framebuffers(int width, int height) {
+		create_oit_targets(width, height);
+		window_width = width;
+		window_height = height;
+	}
+
+	/// The world space ray through a point on the screen
+	void mouse_ray(const glm::vec2 mouse_position, glm::vec3& origin, glm::vec3& direction) const {
+		const glm::vec3 window = { mouse_position.x, window_height - mouse_position.y, 1.f };
+		const glm::vec3 position = glm::unProject(window, camera.view, camera.projection, glm::vec4(0, 0, window_width, window_height));
+		origin = camera.position - camera.direction * camera.distance;
+		direction = glm::normalize(position - origin);
+	}
+
+	/// Distance along the world space ray to the mesh placed with matrix and posed by skeleton.
+	/// The ray is moved into model space instead of the vertices to world space, an affine transform keeps the distances along the ray the same
+	std::optional<float> pick_mesh(SkinnedMesh& mesh, const SkeletalModelInstance& skeleton, const glm::mat4& matrix, const glm::vec3& origin, const glm::vec3& direction) const {
+		const PickingMesh& picking = mesh.picking_mesh();
+		if (picking.triangle_count() == 0) {
 			return {};
 		}
+
+		const glm::mat4 inverse = glm::inverse(matrix);
+		const glm::vec3 local_origin = inverse * glm::vec4(origin, 1.f);
+		const glm::vec3 local_direction = inverse * glm::vec4(direction, 0.f);
+
+		pick_visible_geosets.assign(mesh.geosets.size(), false);
+		for (size_t i = 0; i < mesh.geosets.size(); i++) {
+			pick_visible_geosets[i] = mesh.geoset_visible(skeleton, i);
+		}
+		const auto visible = [&](const u32 geoset) {
+			return pick_visible_geosets[geoset];
+		};
+
+		const size_t bone_count = mesh.model->bones.size();
+		if (pick_in_bind_pose || skeleton.world_matrices.size() < bone_count) {
+			return picking.intersect(local_origin, local_direction, visible);
+		}
+		return picking.intersect_posed(local_origin, local_direction, std::span(skeleton.world_matrices.data(), bone_count), visible);
 	}
 
-	/// Requires the OpenGL context to be active/current
-	/// Returns the doodad ID of the doodad that is currently under the mouse coordinates
-	/// Renders the meshes currently inside the view frustrum coded by unit ID and then reads the pixel under the mouse coordinates
-	std::optional<size_t> pick_doodad_id_under_mouse(Doodads& doodads, glm::vec2 mouse_position) {
-		GLint old_fbo;
-		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &old_fbo);
-		GLint old_vao;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &old_vao);
+	/// Returns the unit ID of the unit that is currently under the mouse coordinates.
+	/// Picked on the CPU against the triangles of the models, so it does not need the OpenGL context
+	std::optional<size_t> pick_unit_id_under_mouse(Units& units, glm::vec2 mouse_position) {
+		glm::vec3 ray_origin;
+		glm::vec3 ray_direction;
+		mouse_ray(mouse_position, ray_origin, ray_direction);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, color_picking_framebuffer);
+		const auto bounds = [&](const size_t i, glm::vec3& min, glm::vec3& max) {
+			const Unit& unit = units.units[i];
+			if (unit.id == "sloc") {
+				return false;
+			} // ToDo handle starting locations
 
-		glClearColor(0, 0, 0, 1);
-		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-		glViewport(0, 0, window_width, window_height);
+			const mdx::Extent& extent = unit.mesh->model->sequences[unit.skeleton.sequence_index].extent;
+			transform_aabb_non_uniform(extent.minimum, extent.maximum, min, max, unit.skeleton.matrix);
+			return true;
+		};
 
-		glDepthMask(true);
-		glDisable(GL_BLEND);
+		const auto hit = [&](const size_t i) {
+			const Unit& unit = units.units[i];
+			return pick_mesh(*unit.mesh, unit.skeleton, unit.skeleton.matrix, ray_origin, ray_direction);
+		};
+
+		const auto nearest = pick_nearest(ray_origin, ray_direction, units.units.size(), bounds, hit);
+		if (!nearest) {
+			return {};
+		}
+		return nearest->first;
+	}
 
-		glm::vec3 window = { input_handler.mouse.x, window_height - input_handler.mouse.y, 1.f };
-		glm::vec3 pos = glm::unProject(window, camera.view, camera.projection, glm::vec4(0, 0, window_width, window_height));
-		glm::vec3 ray_origin = camera.position - camera.direction * camera.distance;
-		glm::vec3 ray_direction = glm::normalize(pos - ray_origin);
+	/// Returns the doodad ID of the doodad that is currently under the mouse coordinates.
+	/// Picked on the CPU against the triangles of the models, so it does not need the OpenGL context
+	std::optional<size_t> pick_doodad_id_under_mouse(Doodads& doodads, glm::vec2 mouse_position) {
+		glm::vec3 ray_origin;
+		glm::vec3 ray_direction;
+		mouse_ray(mouse_position, ray_origin, ray_direction);
 
-		colored_skinned_shader->use();
-		for (size_t i = 0; i < doodads.doodads.size(); i++) {
+		const auto uses_click_helper = [&](const Doodad& doodad) {
+			const bool is_doodad = doodads_slk.row_headers.contains(doodad.id);
+			const slk::SLK& slk = is_doodad ? doodads_slk : destructibles_slk;
+			return slk.data<bool>("useclickhelper", doodad.id);
+		};
+
+		const auto bounds = [&](const size_t i, glm::vec3& min, glm::vec3& max) {
 			const Doodad& doodad = doodads.doodads[i];
 
 			const mdx::Extent& extent = doodad.mesh->model->sequences[doodad.skeleton.sequence_index].extent;
 			glm::vec3 local_min = extent.minimum;
 			glm::vec3 local_max = extent.maximum;
 
-			bool is_doodad = doodads_slk.row_headers.contains(doodad.id);
-			slk::SLK& slk = is_doodad ? doodads_slk : destructibles_slk;
-			bool use_click_helper = slk.data<bool>("useclickhelper", doodad.id);
-			if (use_click_helper) {
+			if (uses_click_helper(doodad)) {
 				local_min = glm::min(local_min, click_helper->model->extent.minimum);
 				local_max = glm::max(local_max, click_helper->model->extent.maximum);
 			}
 
-			glm::vec3 min;
-			glm::vec3 max;
 			// From local space to world space
 			transform_aabb_non_uniform(local_min, local_max, min, max, doodad.skeleton.matrix);
+			return true;
+		};
 
-			if (intersect_aabb(min, max, ray_origin, ray_direction)) {
-				doodad.mesh->render_color_coded(doodad.skeleton, i + 1);
+		const auto hit = [&](const size_t i) {
+			const Doodad& doodad = doodads.doodads[i];
+			std::optional<float> distance = pick_mesh(*doodad.mesh, doodad.skeleton, doodad.skeleton.matrix, ray_origin, ray_direction);
 
-				if (use_click_helper) {
-					auto a = SkeletalModelInstance(click_helper->model);
-					a.matrix = doodad.skeleton.matrix;
-					a.update(0.016f);
-					click_helper->render_color_coded(a, i + 1);
+			if (uses_click_helper(doodad)) {
+				const auto helper_distance = pick_mesh(*click_helper, click_helper_skeleton, doodad.skeleton.matrix, ray_origin, ray_direction);
+				if (helper_distance && (!distance || *helper_distance < *distance)) {
+					distance = helper_distance;
 				}
 			}
-		}
-
-		glm::u8vec4 color;
-		glReadPixels(mouse_position.x, window_height - mouse_position.y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &color);
-
-		glBindFramebuffer(GL_FRAMEBUFFER, old_fbo);
-		glBindVertexArray(old_vao);
-		glEnable(GL_BLEND);
+			return distance;
+		};
 
-		const int index = color.r + (color.g << 8) + (color.b << 16);
-		if (index != 0) {
-			return { index - 1 };
-		} else {
+		const auto nearest = pick_nearest(ray_origin, ray_direction, doodads.doodads.size(), bounds, hit);
+		if (!nearest) {
 			return {};
 		}
+		return nearest->first;
 	}
 };
\ No newline at end of file
@@ -2,6 +2,7 @@ module;
 
 #include <QObject>
 #include <QRect>
+#include <QTimer>
 
 #include <brush.h>
 
@@ -21,6 +22,8 @@ import Hierarchy;
 import ResourceManager;
 import Globals;
 import Camera;
+import GPUBuffer;
+import TerrainChunks;
 import "glad/glad.h";
 import "ankerl/unordered_dense.h";
 import "glm/glm.hpp";
@@ -90,8 +93,35 @@ export class Terrain : public QObject {
 	std::vector<float> water_heights;
 	std::vector<uint32_t> water_exists_data;
 
+	// Chunks that passed frustum culling this frame, the ground pass culls for both ground and water
+	mutable std::vector<glm::ivec2> visible_ground_chunks;
+	mutable std::vector<glm::ivec2> visible_water_chunks;
+	mutable GrowableBuffer<> visible_ground_chunks_buffer;
+	mutable GrowableBuffer<> visible_water_chunks_buffer;
+
+	// The cliff instances of a terrain chunk, sorted per mesh. Only rebuilt when the cliffs in the chunk change
+	struct CliffChunk {
+		struct Range {
+			int mesh;
+			size_t first;
+			size_t count;
+		};
+
+		GLuint instance_buffer = 0;
+		std::vector<Range> ranges;
+	};
+	std::vector<CliffChunk> cliff_chunks;
+
 	btHeightfieldTerrainShape* collision_shape;
 	btRigidBody* collision_body;
+
+	// The pixels of the minimap changed since minimap_changed was last emitted, in image coordinates
+	QRect minimap_dirty;
+	// Coalesces the minimap updates of a brush stroke so the minimap widget is refreshed at most a few times per second
+	QTimer minimap_timer;
+	static constexpr int minimap_interval_ms = 250;
+	// Updates that recolor more pixels than this are split over all threads
+	static constexpr int minimap_parallel_pixels = 128 * 128;
 public:
 	char tileset;
 	std::vector<std::string> tileset_ids;
@@ -116,6 +146,8 @@ public:
 	GLuint ground_exists_buffer;
 	GLuint water_exists_buffer;
 
+	TerrainChunks chunks;
+
 	std::vector<std::vector<Corner>> corners;
 	// For undo/redo operations
 	std::vector<std::vector<Corner>> old_corners;
@@ -159,6 +191,17 @@ public:
 	float current_texture = 1.f;
 	GLuint water_texture_array;
 
+	/// Tile, cliff, and water colors with one pixel per corner. Kept up to date by update_minimap()
+	Texture minimap;
+
+	Terrain() {
+        minimap_timer.setSingleShot(true);
+        minimap_timer.setInterval(minimap_interval_ms);
+        connect(&minimap_timer, &QTimer::timeout, this, [this]() {
+            emit minimap_changed(minimap, std::exchange(minimap_dirty, QRect()));
+        });
+    }
+
 	~Terrain() {
         glDeleteTextures(1, &cliff_texture_array);
         glDeleteTextures(1, &water_texture_array);
@@ -170,6 +213,10 @@ public:
         glDeleteBuffers(1, &ground_exists_buffer);
         glDeleteBuffers(1, &water_exists_buffer);
 
+        for (const auto& i : cliff_chunks) {
+            glDeleteBuffers(1, &i.instance_buffer);
+        }
+
         //map->physics.dynamicsWorld->removeRigidBody(collision_body);
         //delete collision_body;
         //delete collision_shape;
@@ -396,12 +443,15 @@ public:
         collision_body->setCollisionFlags(collision_body->getCollisionFlags() | btCollisionObject::CF_STATIC_OBJECT);
         physics.dynamicsWorld->addRigidBody(collision_body, 32, 32);
 
+        chunks.resize(width - 1, height - 1);
+        cliff_chunks.resize(chunks.chunks.size());
+
         update_ground_textures({ 0, 0, width - 1, height - 1 });
         update_ground_heights({ 0, 0, width - 1, height - 1 });
         update_cliff_meshes({ 0, 0, width - 1, height - 1 });
         update_water({ 0, 0, width - 1, height - 1 });
 
-        emit minimap_changed(minimap_image());
+        rebuild_minimap();
     }
 
     void save() const {
@@ -449,7 +499,7 @@ public:
         hierarchy.map_file_write("war3map.w3e", writer.buffer);
     }
 
-    void render_ground(bool render_pathing, bool render_lighting, glm::vec3 light_direction, Brush* brush, PathingMap& pathing_map) const {
+    void render_ground(bool render_pathing, bool render_walkability, bool render_lighting, glm::vec3 light_direction, Brush* brush, PathingMap& pathing_map) const {
         // Render tiles
         ground_shader->use();
 
@@ -469,6 +519,11 @@ public:
         glBindTextureUnit(17, pathing_map.texture_static);
         glBindTextureUnit(18, pathing_map.texture_dynamic);
 
+        glUniform1i(8, render_walkability && pathing_map.texture_components != 0);
+        if (render_walkability) {
+            glBindTextureUnit(20, pathing_map.texture_components);
+        }
+
         glUniform1i(6, brush && brush->get_mode() != Brush::Mode::selection);
         if (brush) {
             glBindTextureUnit(19, brush->brush_texture);
@@ -480,28 +535,21 @@ public:
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, ground_exists_buffer);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, ground_texture_handle_buffer);
 
-        // Use gl_VertexID in the shader to determine square position
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (width - 1) * (height - 1));
+        chunks.cull([](const glm::vec3& min, const glm::vec3& max) {
+            return camera.inside_frustrum(min, max);
+        }, visible_ground_chunks, visible_water_chunks);
 
-        glEnable(GL_BLEND);
+        if (!visible_ground_chunks.empty()) {
+            upload_visible_chunks(visible_ground_chunks_buffer, visible_ground_chunks);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, visible_ground_chunks_buffer.buffer);
 
-        // Render cliffs
-        for (const auto& i : cliffs) {
-            const Corner& bottom_left = corners[i.x][i.y];
-            const Corner& bottom_right = corners[i.x + 1][i.y];
-            const Corner& top_left = corners[i.x][i.y + 1];
-            const Corner& top_right = corners[i.x + 1][i.y + 1];
-
-            if (bottom_left.special_doodad) {
-                continue;
-            }
-
-            const float min = std::min({ bottom_left.layer_height,	bottom_right.layer_height,
-                                        top_left.layer_height,		top_right.layer_height });
-
-            cliff_meshes[i.z]->render_queue({ i.x, i.y, min - 2, bottom_left.cliff_texture });
+            // Use gl_VertexID in the shader to determine square position and gl_InstanceID for the chunk and tile
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, visible_ground_chunks.size() * TerrainChunks::chunk_size * TerrainChunks::chunk_size);
         }
 
+        glEnable(GL_BLEND);
+
+        // Render cliffs
         cliff_shader->use();
 
         glUniformMatrix4fv(0, 1, GL_FALSE, &camera.projection_view[0][0]);
@@ -523,9 +571,28 @@ public:
         if (brush) {
             glBindTextureUnit(3, brush->brush_texture);
         }
-        for (const auto& i : cliff_meshes) {
-            i->render();
+
+        GLint old_vao;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &old_vao);
+
+        for (size_t i = 0; i < cliff_chunks.size(); i++) {
+            const CliffChunk& cliff_chunk = cliff_chunks[i];
+            if (cliff_chunk.ranges.empty()) {
+                continue;
+            }
+
+            // Cliff meshes span the layers of their tile, which the ground bounds already cover. Grown a bit as the meshes stick out of their tile
+            const TerrainChunk& chunk = chunks.chunks[i];
+            if (!camera.inside_frustrum(chunk.ground_min - 1.f, chunk.ground_max + 1.f)) {
+                continue;
+            }
+
+            for (const auto& range : cliff_chunk.ranges) {
+                cliff_meshes[range.mesh]->render(cliff_chunk.instance_buffer, range.first, range.count);
+            }
         }
+
+        glBindVertexArray(old_vao);
     }
 
     void render_water() const {
@@ -550,12 +617,22 @@ public:
 
         glBindTextureUnit(0, water_texture_array);
 
-        // Use gl_VertexID in the shader to determine square position
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (width - 1) * (height - 1));
+        if (!visible_water_chunks.empty()) {
+            upload_visible_chunks(visible_water_chunks_buffer, visible_water_chunks);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, visible_water_chunks_buffer.buffer);
+
+            // Use gl_VertexID in the shader to determine square position and gl_InstanceID for the chunk and tile
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, visible_water_chunks.size() * TerrainChunks::chunk_size * TerrainChunks::chunk_size);
+        }
 
         glDepthMask(true);
     }
 
+    static void upload_visible_chunks(GrowableBuffer<>& buffer, const std::vector<glm::ivec2>& visible) {
+        buffer.reserve(visible.size() * sizeof(glm::ivec2));
+        glNamedBufferSubData(buffer.buffer, 0, visible.size() * sizeof(glm::ivec2), visible.data());
+    }
+
     void change_tileset(const std::vector<std::string>& new_tileset_ids, std::vector<int> new_to_old) {
         tileset_ids = new_tileset_ids;
 
@@ -736,45 +813,63 @@ public:
         return bottom_left.ramp && top_left.ramp && bottom_right.ramp && top_right.ramp && !(bottom_left.layer_height == top_right.layer_height && top_left.layer_height == bottom_right.layer_height);
     }
 
-    /// Constructs a minimap image with tile, cliff, and water colors. Other objects such as doodads will not be added here
-    Texture minimap_image() {
-        Texture new_minimap_image;
+    glm::vec4 minimap_color(const int i, const int j) const {
+        glm::vec4 color;
 
-        new_minimap_image.width = width;
-        new_minimap_image.height = height;
-        new_minimap_image.channels = 4;
-        new_minimap_image.data.resize(width * height * 4);
-
-        for (int j = 0; j < height; j++) {
-            for (int i = 0; i < width; i++) {
-                glm::vec4 color;
+        if (corners[i][j].cliff || (i > 0 && corners[i - 1][j].cliff) || (j > 0 && corners[i][j - 1].cliff) || (i > 0 && j > 0 && corners[i - 1][j - 1].cliff)) {
+            color = glm::vec4(128.f, 128.f, 128.f, 255.f);
+        } else {
+            color = ground_textures[real_tile_texture(i, j)]->minimap_color;
+        }
 
-                if (corners[i][j].cliff || (i > 0 && corners[i - 1][j].cliff) || (j > 0 && corners[i][j - 1].cliff) || (i > 0 && j > 0 && corners[i - 1][j - 1].cliff)) {
-                    color = glm::vec4(128.f, 128.f, 128.f, 255.f);
-                } else {
-                    color = ground_textures[real_tile_texture(i, j)]->minimap_color;
-                }
+        if (corners[i][j].water && corners[i][j].final_water_height(water_offset) > corners[i][j].final_ground_height()) {
+            if (corners[i][j].final_water_height(water_offset) - corners[i][j].final_ground_height() > 0.5f) {
+                color *= 0.5625f;
+                color += glm::vec4(0, 0, 80, 112);
+            } else {
+                color *= 0.75f;
+                color += glm::vec4(0, 0, 48, 64);
+            }
+        }
 
-                if (corners[i][j].water && corners[i][j].final_water_height(water_offset) > corners[i][j].final_ground_height()) {
-                    if (corners[i][j].final_water_height(water_offset) - corners[i][j].final_ground_height() > 0.5f) {
-                        color *= 0.5625f;
-                        color += glm::vec4(0, 0, 80, 112);
-                    } else {
-                        color *= 0.75f;
-                        color += glm::vec4(0, 0, 48, 64);
-                    }
-                }
+        return color;
+    }
 
-                int index = (height - 1 - j) * (width * 4) + i * 4;
-                new_minimap_image.data[index + 0] = color.r;
-                new_minimap_image.data[index + 1] = color.g;
-                new_minimap_image.data[index + 2] = color.b;
-                new_minimap_image.data[index + 3] = color.a;
+    /// Recolors the minimap pixels of the corners in area. The rows of large areas are colored in parallel
+    void paint_minimap(const QRect& area) {
+        const auto paint_row = [&](const int j) {
+            for (int i = area.left(); i <= area.right(); i++) {
+                const glm::vec4 color = minimap_color(i, j);
+                const int index = (height - 1 - j) * (width * 4) + i * 4;
+                minimap.data[index + 0] = color.r;
+                minimap.data[index + 1] = color.g;
+                minimap.data[index + 2] = color.b;
+                minimap.data[index + 3] = color.a;
+            }
+        };
 
+        if (area.width() * area.height() < minimap_parallel_pixels) {
+            for (int j = area.top(); j <= area.bottom(); j++) {
+                paint_row(j);
             }
+        } else {
+            std::vector<int> rows(area.height());
+            std::iota(rows.begin(), rows.end(), area.top());
+            std::for_each(std::execution::par, rows.begin(), rows.end(), paint_row);
         }
+    }
 
-        return new_minimap_image;
+    /// Recolors the whole minimap and emits minimap_changed right away
+    void rebuild_minimap() {
+        minimap.width = width;
+        minimap.height = height;
+        minimap.channels = 4;
+        minimap.data.resize(width * height * 4);
+        paint_minimap(QRect(0, 0, width, height));
+
+        minimap_timer.stop();
+        minimap_dirty = QRect();
+        emit minimap_changed(minimap, QRect(0, 0, width, height));
     }
 
     void upload_ground_heights() const {
@@ -836,6 +931,9 @@ public:
 
         upload_ground_heights();
         upload_corner_heights();
+
+        // Tiles to the bottom left of the changed corners are affected too
+        chunks.update({ area.x() - 1, area.y() - 1 }, { area.right(), area.bottom() }, final_ground_heights, water_heights, water_exists_data, water_offset);
     }
 
     /// Updates the ground texture variation information and uploads it to the GPU
@@ -861,6 +959,77 @@ public:
         }
 
         upload_ground_exists();
+
+        // Cliffs are hidden under special doodads, which is tracked together with the ground existence
+        update_cliff_chunks(update_area);
+    }
+
+    /// Rebuilds the cliff instance buffers of the chunks overlapping area
+    void update_cliff_chunks(const QRect& area) {
+        const QRect tile_area = area.intersected({ 0, 0, width - 1, height - 1 });
+        if (cliff_chunks.empty() || tile_area.isEmpty()) {
+            return;
+        }
+
+        const int first_x = tile_area.left() / TerrainChunks::chunk_size;
+        const int first_y = tile_area.top() / TerrainChunks::chunk_size;
+        const int last_x = tile_area.right() / TerrainChunks::chunk_size;
+        const int last_y = tile_area.bottom() / TerrainChunks::chunk_size;
+        const int dirty_width = last_x - first_x + 1;
+
+        // Mesh index and instance data of the cliffs in each dirty chunk
+        std::vector<std::vector<std::pair<int, glm::vec4>>> gathered(dirty_width * (last_y - first_y + 1));
+        for (const auto& i : cliffs) {
+            const int chunk_x = i.x / TerrainChunks::chunk_size;
+            const int chunk_y = i.y / TerrainChunks::chunk_size;
+            if (chunk_x < first_x || chunk_x > last_x || chunk_y < first_y || chunk_y > last_y) {
+                continue;
+            }
+
+            const Corner& bottom_left = corners[i.x][i.y];
+            const Corner& bottom_right = corners[i.x + 1][i.y];
+            const Corner& top_left = corners[i.x][i.y + 1];
+            const Corner& top_right = corners[i.x + 1][i.y + 1];
+
+            if (bottom_left.special_doodad) {
+                continue;
+            }
+
+            const float min = std::min({ bottom_left.layer_height,	bottom_right.layer_height,
+                                        top_left.layer_height,		top_right.layer_height });
+
+            gathered[(chunk_y - first_y) * dirty_width + chunk_x - first_x].emplace_back(i.z, glm::vec4(i.x, i.y, min - 2, bottom_left.cliff_texture));
+        }
+
+        std::vector<glm::vec4> instances;
+        for (int chunk_y = first_y; chunk_y <= last_y; chunk_y++) {
+            for (int chunk_x = first_x; chunk_x <= last_x; chunk_x++) {
+                auto& chunk_cliffs = gathered[(chunk_y - first_y) * dirty_width + chunk_x - first_x];
+                std::stable_sort(chunk_cliffs.begin(), chunk_cliffs.end(), [](const auto& left, const auto& right) {
+                    return left.first < right.first;
+                });
+
+                CliffChunk& chunk = cliff_chunks[chunk_y * chunks.chunks_x + chunk_x];
+                chunk.ranges.clear();
+                instances.clear();
+                for (const auto& [mesh, instance] : chunk_cliffs) {
+                    if (chunk.ranges.empty() || chunk.ranges.back().mesh != mesh) {
+                        chunk.ranges.push_back({ mesh, instances.size(), 0 });
+                    }
+                    chunk.ranges.back().count += 1;
+                    instances.push_back(instance);
+                }
+
+                if (instances.empty()) {
+                    continue;
+                }
+
+                if (!chunk.instance_buffer) {
+                    glCreateBuffers(1, &chunk.instance_buffer);
+                }
+                glNamedBufferData(chunk.instance_buffer, instances.size() * sizeof(glm::vec4), instances.data(), GL_STATIC_DRAW);
+            }
+        }
     }
 
     /// Updates and uploads the water data for the GPU
@@ -873,6 +1042,8 @@ public:
         }
         upload_water_exists();
         upload_water_heights();
+
+        chunks.update({ area.x() - 1, area.y() - 1 }, { area.right(), area.bottom() }, final_ground_heights, water_heights, water_exists_data, water_offset);
     }
 
     /// ToDo clean
@@ -1102,12 +1273,30 @@ public:
         //map->physics.dynamicsWorld->addRigidBody(collision_body, 32, 32);
     }
 
-    void update_minimap() {
-        emit minimap_changed(minimap_image());
+    /// Recolors the minimap pixels affected by the corners in area. The changes are collected and emitted together at most every minimap_interval_ms
+    void update_minimap(const QRect& area) {
+        if (minimap.width != width || minimap.height != height) {
+            rebuild_minimap();
+            return;
+        }
+
+        // A pixel also takes the cliff and tile texture of the corners to its bottom left
+        const QRect changed = area.adjusted(0, 0, 1, 1).intersected(QRect(0, 0, width, height));
+        if (changed.isEmpty()) {
+            return;
+        }
+        paint_minimap(changed);
+
+        // Rows are flipped in the image
+        minimap_dirty |= QRect(changed.left(), height - 1 - changed.bottom(), changed.width(), changed.height());
+        if (!minimap_timer.isActive()) {
+            minimap_timer.start();
+        }
     }
 
 signals:
-	void minimap_changed(Texture minimap);
+	/// area is the part of the minimap that changed, in image coordinates
+	void minimap_changed(const Texture& minimap, QRect area);
 };
 
 #include "terrain.moc"
\ No newline at end of file
@@ -0,0 +1,113 @@
+export module TerrainChunks;
+
+import std;
+import <glm/glm.hpp>;
+
+/// Bounds of a block of chunk_size x chunk_size tiles, used to skip the parts of the terrain that are off screen
+export struct TerrainChunk {
+	glm::ivec2 origin; // Bottom left tile
+	glm::vec3 ground_min;
+	glm::vec3 ground_max;
+	bool has_water = false;
+	glm::vec3 water_min;
+	glm::vec3 water_max;
+};
+
+/// Splits the terrain in fixed size chunks and keeps their bounding boxes up to date.
+/// Does not touch GL or the camera so the culling can be tested on the CPU
+export class TerrainChunks {
+  public:
+	// Should match chunk_size in terrain.vert and water.vert
+	static constexpr int chunk_size = 32;
+
+	int tiles_x = 0;
+	int tiles_y = 0;
+	int chunks_x = 0;
+	int chunks_y = 0;
+	std::vector<TerrainChunk> chunks;
+
+	void resize(const int tiles_x, const int tiles_y) {
+		this->tiles_x = tiles_x;
+		this->tiles_y = tiles_y;
+		chunks_x = (tiles_x + chunk_size - 1) / chunk_size;
+		chunks_y = (tiles_y + chunk_size - 1) / chunk_size;
+
+		chunks.clear();
+		chunks.resize(chunks_x * chunks_y);
+		for (int j = 0; j < chunks_y; j++) {
+			for (int i = 0; i < chunks_x; i++) {
+				chunks[j * chunks_x + i].origin = { i * chunk_size, j * chunk_size };
+			}
+		}
+	}
+
+	/// Recomputes the bounds of the chunks containing the tiles from first_tile to last_tile (inclusive).
+	/// The height and water arrays are per corner, (tiles_x + 1) * (tiles_y + 1) values in row major order
+	void update(
+		const glm::ivec2 first_tile,
+		const glm::ivec2 last_tile,
+		const std::span<const float> ground_heights,
+		const std::span<const float> water_heights,
+		const std::span<const uint32_t> water_exists,
+		const float water_offset
+	) {
+		const int corners_x = tiles_x + 1;
+
+		const int first_x = std::clamp(first_tile.x, 0, tiles_x - 1) / chunk_size;
+		const int first_y = std::clamp(first_tile.y, 0, tiles_y - 1) / chunk_size;
+		const int last_x = std::clamp(last_tile.x, 0, tiles_x - 1) / chunk_size;
+		const int last_y = std::clamp(last_tile.y, 0, tiles_y - 1) / chunk_size;
+
+		for (int chunk_y = first_y; chunk_y <= last_y; chunk_y++) {
+			for (int chunk_x = first_x; chunk_x <= last_x; chunk_x++) {
+				TerrainChunk& chunk = chunks[chunk_y * chunks_x + chunk_x];
+
+				// The corners of the tiles in the chunk, so one more than the tile count on each axis
+				const int end_x = std::min(chunk.origin.x + chunk_size, tiles_x);
+				const int end_y = std::min(chunk.origin.y + chunk_size, tiles_y);
+
+				float ground_min = std::numeric_limits<float>::max();
+				float ground_max = std::numeric_limits<float>::lowest();
+				float water_min = std::numeric_limits<float>::max();
+				float water_max = std::numeric_limits<float>::lowest();
+				chunk.has_water = false;
+
+				for (int j = chunk.origin.y; j <= end_y; j++) {
+					for (int i = chunk.origin.x; i <= end_x; i++) {
+						const size_t index = j * corners_x + i;
+						ground_min = std::min(ground_min, ground_heights[index]);
+						ground_max = std::max(ground_max, ground_heights[index]);
+
+						if (water_exists[index]) {
+							chunk.has_water = true;
+							water_min = std::min(water_min, water_heights[index] + water_offset);
+							water_max = std::max(water_max, water_heights[index] + water_offset);
+						}
+					}
+				}
+
+				chunk.ground_min = glm::vec3(chunk.origin, ground_min);
+				chunk.ground_max = glm::vec3(end_x, end_y, ground_max);
+				if (chunk.has_water) {
+					chunk.water_min = glm::vec3(chunk.origin, water_min);
+					chunk.water_max = glm::vec3(end_x, end_y, water_max);
+				}
+			}
+		}
+	}
+
+	/// Collects the origins of the chunks for which inside(min, max) holds. Chunks without water are left out of the water list
+	template <typename F>
+	void cull(F&& inside, std::vector<glm::ivec2>& ground, std::vector<glm::ivec2>& water) const {
+		ground.clear();
+		water.clear();
+		for (const auto& chunk : chunks) {
+			if (inside(chunk.ground_min, chunk.ground_max)) {
+				ground.push_back(chunk.origin);
+			}
+			if (chunk.has_water && inside(chunk.water_min, chunk.water_max)) {
+				water.push_back(chunk.origin);
+			}
+		}
+	}
+};
\ No newline at end of file
@@ -8,6 +8,7 @@ import std;
 import Terrain;
 import Units;
 import WorldUndoManager;
+import UndoDelta;
 
 export enum class TerrainUndoType {
 	texture,
@@ -17,17 +18,15 @@ export enum class TerrainUndoType {
 };
 
 export class TerrainGenericAction final : public WorldCommand {
-public:
-	QRect area;
-	std::vector<Corner> old_corners;
-	std::vector<Corner> new_corners;
-	TerrainUndoType undo_type;
-
-	void undo(WorldEditContext& ctx) override {
-		for (int j = area.top(); j <= area.bottom(); j++) {
-			for (int i = area.left(); i <= area.right(); i++) {
-				ctx.terrain.corners[i][j] = old_corners[(j - area.top()) * area.width() + i - area.left()];
-			}
+	/// Sets the corners to how they were before or after the change
+	void apply(WorldEditContext& ctx, const bool after) const {
+		const auto corner = [&](const size_t i) -> Corner& {
+			return ctx.terrain.corners[area.left() + i % area.width()][area.top() + i / area.width()];
+		};
+		if (after) {
+			corners.redo<Corner>(corner);
+		} else {
+			corners.undo<Corner>(corner);
 		}
 
 		if (undo_type == TerrainUndoType::height) {
@@ -45,33 +44,29 @@ public:
 			ctx.terrain.update_water(area);
 		}
 
-		ctx.terrain.update_minimap();
+		ctx.terrain.update_minimap(area);
 		ctx.units.update_area(area, ctx.terrain);
 	}
 
-	void redo(WorldEditContext& ctx) override {
-		for (int j = area.top(); j <= area.bottom(); j++) {
-			for (int i = area.left(); i <= area.right(); i++) {
-				ctx.terrain.corners[i][j] = new_corners[(j - area.top()) * area.width() + i - area.left()];
-			}
-		}
+public:
+	QRect area;
+	/// The corners of area in row major order
+	ByteDelta corners;
+	TerrainUndoType undo_type;
 
-		if (undo_type == TerrainUndoType::height) {
-			ctx.terrain.update_ground_heights(area);
-		}
+	void undo(WorldEditContext& ctx) override {
+		apply(ctx, false);
+	}
 
-		if (undo_type == TerrainUndoType::texture) {
-			ctx.terrain.update_ground_textures(area);
-		}
+	void redo(WorldEditContext& ctx) override {
+		apply(ctx, true);
+	}
 
-		if (undo_type == TerrainUndoType::cliff) {
-			ctx.terrain.update_ground_heights(area);
-			ctx.terrain.update_cliff_meshes(area);
-			ctx.terrain.update_ground_textures(area);
-			ctx.terrain.update_water(area);
-		}
+	size_t memory_size() const override {
+		return sizeof(TerrainGenericAction) + corners.memory_size();
+	}
 
-		ctx.terrain.update_minimap();
-		ctx.units.update_area(area, ctx.terrain);
+	void compress() override {
+		corners.compress();
 	}
 };
\ No newline at end of file
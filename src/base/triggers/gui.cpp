@@ -17,15 +17,18 @@ std::string Triggers::get_type(const std::string_view function_name, const size_
 	return type;
 }
 
+/// Restarted for every trigger, so the script of a trigger does not depend on the triggers converted before it or on which thread converts it
+thread_local size_t function_counter = 0;
+
 std::string generate_function_name(const std::string& trigger_name) {
-	static size_t counter = 0;
-	return "Trig_" + trigger_name + "_HiveWE" + std::to_string(counter++);
+	return "Trig_" + trigger_name + "_HiveWE" + std::to_string(function_counter++);
 }
 
 std::string Triggers::resolve_parameter(
 	const TriggerParameter& parameter,
 	const std::string& trigger_name,
 	MapScriptWriter& pre_actions,
+	ScriptReferences& references,
 	const std::string& type,
 	ScriptMode mode,
 	bool add_call = false
@@ -55,19 +58,21 @@ std::string Triggers::resolve_parameter(
 		}
 		case TriggerParameter::Type::function:
 			if (parameter.has_sub_parameter) {
-				return convert_eca_to_script(parameter.sub_parameter, pre_actions, trigger_name, mode, add_call);
+				return convert_eca_to_script(parameter.sub_parameter, pre_actions, references, trigger_name, mode, add_call);
 			} else {
 				return parameter.value + "()";
 			}
 		case TriggerParameter::Type::variable: {
 			std::string output = parameter.value;
 
-			if (!output.starts_with("gg_")) {
+			if (output.starts_with("gg_")) {
+				references.add(output);
+			} else {
 				output = "udg_" + output;
 			}
 
 			if (parameter.is_array) {
-				output += "[" + resolve_parameter(parameter.parameters[0], trigger_name, pre_actions, "integer", mode) + "]";
+				output += "[" + resolve_parameter(parameter.parameters[0], trigger_name, pre_actions, references, "integer", mode) + "]";
 			}
 			return output;
 		}
@@ -91,6 +96,7 @@ std::string Triggers::resolve_parameter(
 std::string Triggers::convert_eca_to_script(
 	const ECA& eca,
 	MapScriptWriter& pre_actions,
+	ScriptReferences& references,
 	const std::string& trigger_name,
 	ScriptMode mode,
 	bool add_call
@@ -107,7 +113,7 @@ std::string Triggers::convert_eca_to_script(
 			[&] {
 				pre_actions.write_ln(
 					"return ",
-					resolve_parameter(eca.parameters[0], trigger_name, pre_actions, get_type(eca.name, 0), mode)
+					resolve_parameter(eca.parameters[0], trigger_name, pre_actions, references, get_type(eca.name, 0), mode)
 				);
 			},
 			"takes nothing returns boolean"
@@ -118,10 +124,10 @@ std::string Triggers::convert_eca_to_script(
 		writer.if_else_statement(
 			function_name + "()",
 			[&] {
-				writer.write_ln(resolve_parameter(eca.parameters[1], trigger_name, pre_actions, get_type(eca.name, 1), mode, true));
+				writer.write_ln(resolve_parameter(eca.parameters[1], trigger_name, pre_actions, references, get_type(eca.name, 1), mode, true));
 			},
 			[&] {
-				writer.write_ln(resolve_parameter(eca.parameters[2], trigger_name, pre_actions, get_type(eca.name, 2), mode, true));
+				writer.write_ln(resolve_parameter(eca.parameters[2], trigger_name, pre_actions, references, get_type(eca.name, 2), mode, true));
 			}
 		);
 
@@ -136,7 +142,7 @@ std::string Triggers::convert_eca_to_script(
 			if (i.type != ECA::Type::condition) {
 				continue;
 			}
-			conditions.push_back(convert_eca_to_script(i, pre_actions, trigger_name, mode, false));
+			conditions.push_back(convert_eca_to_script(i, pre_actions, references, trigger_name, mode, false));
 		}
 
 		pre_actions.function(
@@ -164,7 +170,7 @@ std::string Triggers::convert_eca_to_script(
 					}
 
 					if (i.group == 1) {
-						writer.write_ln(convert_eca_to_script(i, pre_actions, trigger_name, mode, true));
+						writer.write_ln(convert_eca_to_script(i, pre_actions, references, trigger_name, mode, true));
 					}
 				}
 			},
@@ -176,7 +182,7 @@ std::string Triggers::convert_eca_to_script(
 
 					// TODO, I suspect group 0 is the if, group 1 is the then and group 2 is the else
 					if (i.group != 1) {
-						writer.write_ln(convert_eca_to_script(i, pre_actions, trigger_name, mode, true));
+						writer.write_ln(convert_eca_to_script(i, pre_actions, references, trigger_name, mode, true));
 					}
 				}
 			}
@@ -189,8 +195,8 @@ std::string Triggers::convert_eca_to_script(
 		const std::string loop_index = eca.name.starts_with("ForLoopA") ? "bj_forLoopAIndex" : "bj_forLoopBIndex";
 		const std::string loop_index_end = eca.name.starts_with("ForLoopA") ? "bj_forLoopAIndexEnd" : "bj_forLoopBIndexEnd";
 
-		const auto start_at = resolve_parameter(eca.parameters[0], trigger_name, pre_actions, get_type(eca.name, 0), mode);
-		const auto exit_when = resolve_parameter(eca.parameters[1], trigger_name, pre_actions, get_type(eca.name, 1), mode);
+		const auto start_at = resolve_parameter(eca.parameters[0], trigger_name, pre_actions, references, get_type(eca.name, 0), mode);
+		const auto exit_when = resolve_parameter(eca.parameters[1], trigger_name, pre_actions, references, get_type(eca.name, 1), mode);
 
 		MapScriptWriter writer(mode);
 
@@ -201,10 +207,10 @@ std::string Triggers::convert_eca_to_script(
 		writer.while_statement(std::format("{} <= {}", loop_index, loop_index_end), [&] {
 			if (eca.name.ends_with("Multiple")) {
 				for (const auto& i : eca.ecas) {
-					writer.write_ln(convert_eca_to_script(i, pre_actions, trigger_name, mode, true));
+					writer.write_ln(convert_eca_to_script(i, pre_actions, references, trigger_name, mode, true));
 				}
 			} else {
-				writer.write_ln(resolve_parameter(eca.parameters[2], trigger_name, pre_actions, get_type(eca.name, 2), mode, true));
+				writer.write_ln(resolve_parameter(eca.parameters[2], trigger_name, pre_actions, references, get_type(eca.name, 2), mode, true));
 			}
 
 			writer.set_variable(loop_index, loop_index + " + 1");
@@ -214,19 +220,19 @@ std::string Triggers::convert_eca_to_script(
 	}
 
 	if (eca.name == "ForLoopVarMultiple" || eca.name == "ForLoopVar") {
-		const auto variable = resolve_parameter(eca.parameters[0], trigger_name, pre_actions, "integer", mode);
-		const auto start_at = resolve_parameter(eca.parameters[1], trigger_name, pre_actions, get_type(eca.name, 1), mode);
-		const auto exit_when = resolve_parameter(eca.parameters[2], trigger_name, pre_actions, get_type(eca.name, 2), mode);
+		const auto variable = resolve_parameter(eca.parameters[0], trigger_name, pre_actions, references, "integer", mode);
+		const auto start_at = resolve_parameter(eca.parameters[1], trigger_name, pre_actions, references, get_type(eca.name, 1), mode);
+		const auto exit_when = resolve_parameter(eca.parameters[2], trigger_name, pre_actions, references, get_type(eca.name, 2), mode);
 
 		MapScriptWriter writer(mode);
 		writer.set_variable(variable, start_at);
 		writer.while_statement(std::format("{} <= {}", variable, exit_when), [&] {
 			if (eca.name == "ForLoopVarMultiple") {
 				for (const auto& i : eca.ecas) {
-					writer.write_ln(convert_eca_to_script(i, pre_actions, trigger_name, mode, true));
+					writer.write_ln(convert_eca_to_script(i, pre_actions, references, trigger_name, mode, true));
 				}
 			} else {
-				writer.write_ln(resolve_parameter(eca.parameters[3], trigger_name, pre_actions, get_type(eca.name, 3), mode, true));
+				writer.write_ln(resolve_parameter(eca.parameters[3], trigger_name, pre_actions, references, get_type(eca.name, 3), mode, true));
 			}
 
 			writer.set_variable(variable, variable + " + 1");
@@ -240,7 +246,7 @@ std::string Triggers::convert_eca_to_script(
 
 		std::vector<std::string> conditions;
 		for (const auto& i : eca.ecas) {
-			conditions.push_back(convert_eca_to_script(i, pre_actions, trigger_name, mode, false));
+			conditions.push_back(convert_eca_to_script(i, pre_actions, references, trigger_name, mode, false));
 		}
 
 		pre_actions.function(
@@ -274,8 +280,8 @@ std::string Triggers::convert_eca_to_script(
 		const std::string& type = std::ranges::find_if(variables, [&](const TriggerVariable& var) {
 									  return var.name == eca.parameters[0].value;
 								  })->type;
-		const std::string first = resolve_parameter(eca.parameters[0], trigger_name, pre_actions, "", mode);
-		const std::string second = resolve_parameter(eca.parameters[1], trigger_name, pre_actions, type, mode);
+		const std::string first = resolve_parameter(eca.parameters[0], trigger_name, pre_actions, references, "", mode);
+		const std::string second = resolve_parameter(eca.parameters[1], trigger_name, pre_actions, references, type, mode);
 
 		MapScriptWriter writer(mode);
 		writer.set_variable(first, second);
@@ -284,19 +290,21 @@ std::string Triggers::convert_eca_to_script(
 
 	if (eca.name == "CommentString") {
 		if (mode == ScriptMode::jass) {
-			return "//" + resolve_parameter(eca.parameters[0], trigger_name, pre_actions, "", mode);
+			return "//" + resolve_parameter(eca.parameters[0], trigger_name, pre_actions, references, "", mode);
 		} else {
-			return "--" + resolve_parameter(eca.parameters[0], trigger_name, pre_actions, "", mode);
+			return "--" + resolve_parameter(eca.parameters[0], trigger_name, pre_actions, references, "", mode);
 		}
 	}
 
 	if (eca.name == "CustomScriptCode") {
-		return resolve_parameter(eca.parameters[0], trigger_name, pre_actions, "", mode);
+		const std::string code = resolve_parameter(eca.parameters[0], trigger_name, pre_actions, references, "", mode);
+		references.scan(code);
+		return code;
 	}
 
 	std::vector<std::string> resolved_parameters;
 	for (size_t i = 0; i < eca.parameters.size(); ++i) {
-		resolved_parameters.push_back(resolve_parameter(eca.parameters[i], trigger_name, pre_actions, get_type(eca.name, i), mode));
+		resolved_parameters.push_back(resolve_parameter(eca.parameters[i], trigger_name, pre_actions, references, get_type(eca.name, i), mode));
 	}
 
 	// Handle remaining multiples
@@ -307,7 +315,7 @@ std::string Triggers::convert_eca_to_script(
 
 		std::vector<std::string> ecas;
 		for (const auto& i : eca.ecas) {
-			ecas.push_back(convert_eca_to_script(i, pre_actions, trigger_name, mode, true));
+			ecas.push_back(convert_eca_to_script(i, pre_actions, references, trigger_name, mode, true));
 		}
 
 		pre_actions.function(function_name, [&] {
@@ -390,7 +398,7 @@ std::string Triggers::convert_eca_to_script(
 		} else if (type == "code") {
 			const std::string function_name = generate_function_name(trigger_name);
 
-			const auto code = resolve_parameter(eca.parameters[k], trigger_name, pre_actions, get_type(eca.name, k), mode, true);
+			const auto code = resolve_parameter(eca.parameters[k], trigger_name, pre_actions, references, get_type(eca.name, k), mode, true);
 			pre_actions.function(function_name, [&] {
 				pre_actions.write_ln(code);
 			});
@@ -412,11 +420,18 @@ std::string Triggers::convert_eca_to_script(
 	return (add_call && mode == ScriptMode::jass ? "call " : "") + (script_name.empty() ? eca.name : script_name) + "(" + output + ")";
 }
 
-std::string Triggers::convert_gui_to_jass(const Trigger& trigger, std::vector<std::string>& map_initializations, ScriptMode mode) const {
+std::string Triggers::convert_gui_to_jass(
+	const Trigger& trigger,
+	std::vector<std::string>& map_initializations,
+	ScriptReferences& references,
+	ScriptMode mode
+) const {
 	std::string trigger_name = trigger.name;
 	trim(trigger_name);
 	std::ranges::replace(trigger_name, ' ', '_');
 
+	function_counter = 0;
+
 	const std::string trigger_variable_name = "gg_trg_" + trigger_name;
 	const std::string trigger_action_name = "Trig_" + trigger_name + "_Actions";
 	const std::string trigger_conditions_name = "Trig_" + trigger_name + "_Conditions";
@@ -445,9 +460,9 @@ std::string Triggers::convert_gui_to_jass(const Trigger& trigger, std::vector<st
 					const auto& p = i.parameters[k];
 
 					if (get_type(i.name, k) == "VarAsString_Real") {
-						arguments += "\"" + resolve_parameter(p, trigger_name, pre_actions, get_type(i.name, k), mode) + "\"";
+						arguments += "\"" + resolve_parameter(p, trigger_name, pre_actions, references, get_type(i.name, k), mode) + "\"";
 					} else {
-						arguments += resolve_parameter(p, trigger_name, pre_actions, get_type(i.name, k), mode);
+						arguments += resolve_parameter(p, trigger_name, pre_actions, references, get_type(i.name, k), mode);
 					}
 
 					if (k < i.parameters.size() - 1) {
@@ -460,12 +475,12 @@ std::string Triggers::convert_gui_to_jass(const Trigger& trigger, std::vector<st
 				break;
 			}
 			case ECA::Type::condition:
-				conditions.if_statement(std::format("not ({})", convert_eca_to_script(i, pre_actions, trigger_name, mode, false)), [&] {
+				conditions.if_statement(std::format("not ({})", convert_eca_to_script(i, pre_actions, references, trigger_name, mode, false)), [&] {
 					conditions.write_ln("return false");
 				});
 				break;
 			case ECA::Type::action:
-				actions.write_ln(convert_eca_to_script(i, pre_actions, trigger_name, mode, true));
+				actions.write_ln(convert_eca_to_script(i, pre_actions, references, trigger_name, mode, true));
 				break;
 		}
 	}
@@ -0,0 +1,961 @@
+export module JassChecker;
+
+import std;
+import types;
+
+using namespace std::string_view_literals;
+
+export struct JassError {
+	std::string file;
+	int line;
+	std::string message;
+};
+
+export struct JassCheckResult {
+	std::vector<JassError> errors;
+	/// The script uses vJass (libraries, scopes, structs, function interfaces, //! directives, block comments, globals after functions), which only JassHelper can turn into JASS.
+	/// Checking stops at the first vJass construct
+	bool uses_vjass = false;
+};
+
+enum class TokenKind : u8 {
+	identifier,
+	integer,
+	real,
+	string,
+	symbol,
+	newline,
+	end
+};
+
+struct Token {
+	TokenKind kind = TokenKind::end;
+	std::string_view text;
+	int line = 1;
+};
+
+/// Produces the tokens of a script one at a time. Newlines are tokens as JASS statements end at the end of a line
+class Lexer {
+	std::string_view source;
+	size_t position = 0;
+	int line = 1;
+
+	static bool is_identifier_start(const char c) {
+		return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+	}
+
+	static bool is_identifier(const char c) {
+		return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+	}
+
+	char at(const size_t i) const {
+		return i < source.size() ? source[i] : '\0';
+	}
+
+	Token make(const TokenKind kind, const size_t begin, const int token_line) const {
+		return { kind, source.substr(begin, position - begin), token_line };
+	}
+
+  public:
+	std::vector<JassError>& errors;
+	const std::string& file;
+	bool uses_vjass = false;
+
+	Lexer(const std::string_view source, std::vector<JassError>& errors, const std::string& file) : source(source), errors(errors), file(file) {}
+
+	Token next() {
+		while (position < source.size()) {
+			const char c = source[position];
+			if (c == ' ' || c == '\t' || c == '\r') {
+				position += 1;
+			} else if (c == '/' && at(position + 1) == '/') {
+				if (at(position + 2) == '!') {
+					uses_vjass = true;
+				}
+				while (position < source.size() && source[position] != '\n') {
+					position += 1;
+				}
+			} else if (c == '/' && at(position + 1) == '*') {
+				// Block comments are vJass, skipped so that the rest of the line still lexes
+				uses_vjass = true;
+				position += 2;
+				while (position < source.size() && !(source[position] == '*' && at(position + 1) == '/')) {
+					if (source[position] == '\n') {
+						line += 1;
+					}
+					position += 1;
+				}
+				position = std::min(position + 2, source.size());
+			} else {
+				break;
+			}
+		}
+
+		if (position >= source.size()) {
+			return { TokenKind::end, {}, line };
+		}
+
+		const size_t begin = position;
+		const char c = source[position];
+
+		if (c == '\n') {
+			// Empty lines and comment lines collapse into a single newline
+			const int token_line = line;
+			while (position < source.size()) {
+				const char d = source[position];
+				if (d == '\n') {
+					line += 1;
+				} else if (d == '/' && at(position + 1) == '/') {
+					if (at(position + 2) == '!') {
+						uses_vjass = true;
+					}
+					while (position < source.size() && source[position] != '\n') {
+						position += 1;
+					}
+					continue;
+				} else if (d != ' ' && d != '\t' && d != '\r') {
+					break;
+				}
+				position += 1;
+			}
+			return { TokenKind::newline, source.substr(begin, 1), token_line };
+		}
+
+		if (is_identifier_start(c)) {
+			while (position < source.size() && is_identifier(source[position])) {
+				position += 1;
+			}
+			return make(TokenKind::identifier, begin, line);
+		}
+
+		if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && std::isdigit(static_cast<unsigned char>(at(position + 1))))) {
+			if (c == '0' && (at(position + 1) == 'x' || at(position + 1) == 'X')) {
+				position += 2;
+				while (std::isxdigit(static_cast<unsigned char>(at(position)))) {
+					position += 1;
+				}
+				return make(TokenKind::integer, begin, line);
+			}
+			while (std::isdigit(static_cast<unsigned char>(at(position)))) {
+				position += 1;
+			}
+			if (at(position) != '.') {
+				return make(TokenKind::integer, begin, line);
+			}
+			position += 1;
+			while (std::isdigit(static_cast<unsigned char>(at(position)))) {
+				position += 1;
+			}
+			return make(TokenKind::real, begin, line);
+		}
+
+		if (c == '$') {
+			position += 1;
+			while (std::isxdigit(static_cast<unsigned char>(at(position)))) {
+				position += 1;
+			}
+			if (position == begin + 1) {
+				errors.push_back({ file, line, "Expected hexadecimal digits after $" });
+			}
+			return make(TokenKind::integer, begin, line);
+		}
+
+		if (c == '"' || c == '\'') {
+			const int token_line = line;
+			position += 1;
+			size_t characters = 0;
+			while (position < source.size() && source[position] != c) {
+				if (source[position] == '\\') {
+					position += 1;
+				}
+				if (at(position) == '\n') {
+					line += 1;
+				}
+				position += 1;
+				characters += 1;
+			}
+			if (position >= source.size()) {
+				errors.push_back({ file, token_line, c == '"' ? "Unterminated string" : "Unterminated rawcode" });
+				return make(TokenKind::end, begin, token_line);
+			}
+			position += 1;
+			if (c == '\'') {
+				if (characters != 1 && characters != 4) {
+					errors.push_back({ file, token_line, std::format("Rawcode {} must be 1 or 4 characters long", source.substr(begin, position - begin)) });
+				}
+				return make(TokenKind::integer, begin, token_line);
+			}
+			return make(TokenKind::string, begin, token_line);
+		}
+
+		if ((c == '=' || c == '!' || c == '<' || c == '>') && at(position + 1) == '=') {
+			position += 2;
+			return make(TokenKind::symbol, begin, line);
+		}
+
+		if (std::string_view("+-*/=<>()[],").contains(c)) {
+			position += 1;
+			return make(TokenKind::symbol, begin, line);
+		}
+
+		position += 1;
+		errors.push_back({ file, line, std::format("Unexpected character '{}'", c) });
+		return next();
+	}
+};
+
+struct JassType {
+	std::string_view name;
+	/// -1 for the primitive types
+	int parent;
+};
+
+struct Variable {
+	int type;
+	bool is_array;
+	bool is_constant;
+};
+
+struct Function {
+	int return_type;
+	std::vector<int> parameters;
+};
+
+/// The types, globals and functions declared by a script. A script sees its own declarations and those of common.j and blizzard.j
+struct Declarations {
+	std::vector<JassType> types;
+	std::unordered_map<std::string_view, int> type_ids;
+	std::unordered_map<std::string_view, Variable> globals;
+	std::unordered_map<std::string_view, Function> functions;
+};
+
+constexpr int error_type = -1;
+constexpr int nothing_type = 0;
+constexpr int integer_type = 1;
+constexpr int real_type = 2;
+constexpr int boolean_type = 3;
+constexpr int string_type = 4;
+constexpr int code_type = 5;
+constexpr int handle_type = 6;
+constexpr int null_type = 7;
+
+/// Words that only appear in vJass, at the start of a declaration
+constexpr std::array vjass_keywords = {
+	"library"sv, "library_once"sv, "endlibrary"sv, "scope"sv, "endscope"sv, "struct"sv, "endstruct"sv, "interface"sv, "endinterface"sv,
+	"module"sv, "endmodule"sv, "private"sv, "public"sv, "static"sv, "method"sv, "endmethod"sv, "keyword"sv, "delegate"sv, "hook"sv,
+	"implement"sv, "requires"sv, "needs"sv, "uses"sv, "initializer"sv, "readonly"sv, "stub"sv, "operator"sv
+};
+
+/// Parses and type checks a script in one pass, which works because JASS only allows using what was declared above
+class Parser {
+	Lexer lexer;
+	Token current;
+	Token lookahead;
+
+	Declarations& declarations;
+	const Declarations* base;
+
+	std::unordered_map<std::string_view, Variable> locals;
+	int return_type = nothing_type;
+	int loop_depth = 0;
+	bool seen_function = false;
+	bool seen_globals = false;
+
+	void advance() {
+		current = lookahead;
+		lookahead = lexer.next();
+	}
+
+	bool is(const std::string_view text) const {
+		return (current.kind == TokenKind::identifier || current.kind == TokenKind::symbol) && current.text == text;
+	}
+
+	bool accept(const std::string_view text) {
+		if (is(text)) {
+			advance();
+			return true;
+		}
+		return false;
+	}
+
+	void error(const int line, std::string message) {
+		lexer.errors.push_back({ lexer.file, line, std::move(message) });
+	}
+
+	std::string describe(const Token& token) const {
+		switch (token.kind) {
+			case TokenKind::newline:
+				return "end of line";
+			case TokenKind::end:
+				return "end of file";
+			default:
+				return std::string(token.text);
+		}
+	}
+
+	/// Reports an error unless the current token is text, in which case it is consumed
+	bool expect(const std::string_view text) {
+		if (accept(text)) {
+			return true;
+		}
+		error(current.line, std::format("Expected {} but found {}", text, describe(current)));
+		return false;
+	}
+
+	std::string_view expect_name() {
+		if (current.kind != TokenKind::identifier) {
+			error(current.line, std::format("Expected a name but found {}", describe(current)));
+			return {};
+		}
+		const std::string_view name = current.text;
+		advance();
+		return name;
+	}
+
+	/// Skips the rest of a line after an error, so the next statement can be checked
+	void recover() {
+		while (current.kind != TokenKind::newline && current.kind != TokenKind::end) {
+			advance();
+		}
+	}
+
+	void end_of_line() {
+		if (current.kind == TokenKind::end) {
+			return;
+		}
+		if (current.kind != TokenKind::newline) {
+			// Whatever went wrong earlier on the line was already reported
+			if (lexer.errors.empty() || lexer.errors.back().line != current.line) {
+				error(current.line, std::format("Expected end of line but found {}", describe(current)));
+			}
+			recover();
+		}
+		advance();
+	}
+
+	// Lookups go through the declarations of the script first
+
+	int find_type(const std::string_view name) const {
+		const auto found = declarations.type_ids.find(name);
+		return found == declarations.type_ids.end() ? error_type : found->second;
+	}
+
+	const Variable* find_global(const std::string_view name) const {
+		if (const auto found = declarations.globals.find(name); found != declarations.globals.end()) {
+			return &found->second;
+		}
+		if (base) {
+			if (const auto found = base->globals.find(name); found != base->globals.end()) {
+				return &found->second;
+			}
+		}
+		return nullptr;
+	}
+
+	const Variable* find_variable(const std::string_view name) const {
+		if (const auto found = locals.find(name); found != locals.end()) {
+			return &found->second;
+		}
+		return find_global(name);
+	}
+
+	const Function* find_function(const std::string_view name) const {
+		if (const auto found = declarations.functions.find(name); found != declarations.functions.end()) {
+			return &found->second;
+		}
+		if (base) {
+			if (const auto found = base->functions.find(name); found != base->functions.end()) {
+				return &found->second;
+			}
+		}
+		return nullptr;
+	}
+
+	std::string_view type_name(const int type) const {
+		return type == error_type ? "unknown" : declarations.types[type].name;
+	}
+
+	bool extends(int type, const int ancestor) const {
+		while (type >= 0) {
+			if (type == ancestor) {
+				return true;
+			}
+			type = declarations.types[type].parent;
+		}
+		return false;
+	}
+
+	bool is_handle(const int type) const {
+		return extends(type, handle_type);
+	}
+
+	static bool is_numeric(const int type) {
+		return type == integer_type || type == real_type;
+	}
+
+	/// Whether a value of type from can be stored in a variable or parameter of type to
+	bool assignable(const int from, const int to) const {
+		if (from == error_type || to == error_type || from == to) {
+			return true;
+		}
+		if (to == real_type && from == integer_type) {
+			return true;
+		}
+		if (from == null_type) {
+			return is_handle(to) || to == string_type || to == code_type;
+		}
+		return is_handle(from) && extends(from, to);
+	}
+
+	void check_assignable(const int from, const int to, const int line, const std::string_view context) {
+		if (!assignable(from, to)) {
+			error(line, std::format("Cannot use {} as {} in {}", type_name(from), type_name(to), context));
+		}
+	}
+
+	int parse_type_name() {
+		const int line = current.line;
+		const std::string_view name = expect_name();
+		if (name.empty()) {
+			return error_type;
+		}
+		const int type = find_type(name);
+		if (type == error_type || type == null_type) {
+			error(line, std::format("Undeclared type {}", name));
+			return error_type;
+		}
+		return type;
+	}
+
+	/// takes nothing returns nothing, or takes integer a, real b returns boolean
+	Function parse_signature(std::vector<std::string_view>* parameter_names) {
+		Function function;
+		expect("takes");
+		if (!accept("nothing")) {
+			do {
+				function.parameters.push_back(parse_type_name());
+				const std::string_view name = expect_name();
+				if (parameter_names) {
+					parameter_names->push_back(name);
+				}
+			} while (accept(","));
+		}
+		expect("returns");
+		function.return_type = accept("nothing") ? nothing_type : parse_type_name();
+		return function;
+	}
+
+	void declare_function(const std::string_view name, const int line, Function function) {
+		if (name.empty()) {
+			return;
+		}
+		if (find_function(name)) {
+			error(line, std::format("Function {} is already declared", name));
+			return;
+		}
+		declarations.functions.emplace(name, std::move(function));
+	}
+
+	void parse_type_declaration() {
+		advance();
+		const int line = current.line;
+		const std::string_view name = expect_name();
+		expect("extends");
+		const int parent = parse_type_name();
+		if (!name.empty()) {
+			if (find_type(name) != error_type) {
+				error(line, std::format("Type {} is already declared", name));
+			} else {
+				declarations.type_ids.emplace(name, static_cast<int>(declarations.types.size()));
+				declarations.types.push_back({ name, parent });
+			}
+		}
+		end_of_line();
+	}
+
+	/// The variable part of a global or local declaration: type [array] name [= value]
+	void parse_variable(std::unordered_map<std::string_view, Variable>& scope, const bool is_constant, const std::string_view kind) {
+		const int type = parse_type_name();
+		const bool is_array = accept("array");
+		const int line = current.line;
+		const std::string_view name = expect_name();
+
+		if (accept("=")) {
+			const int value = parse_expression();
+			if (is_array) {
+				error(line, std::format("Array {} cannot be initialized", name));
+			} else {
+				check_assignable(value, type, line, std::format("the initialization of {}", name));
+			}
+		} else if (is_constant) {
+			error(line, std::format("Constant {} must be initialized", name));
+		}
+
+		if (!name.empty()) {
+			if (&scope == &declarations.globals ? find_global(name) != nullptr : scope.contains(name)) {
+				error(line, std::format("{} {} is already declared", kind, name));
+			} else {
+				scope.emplace(name, Variable { type, is_array, is_constant });
+			}
+		}
+	}
+
+	void parse_globals() {
+		const int line = current.line;
+		advance();
+		end_of_line();
+		while (!is("endglobals")) {
+			if (current.kind == TokenKind::end) {
+				error(line, "Missing endglobals");
+				return;
+			}
+			if (is("private") || is("public")) {
+				lexer.uses_vjass = true;
+				return;
+			}
+			const bool is_constant = accept("constant");
+			parse_variable(declarations.globals, is_constant, "Global");
+			end_of_line();
+		}
+		advance();
+		end_of_line();
+	}
+
+	void parse_native() {
+		advance();
+		const int line = current.line;
+		const std::string_view name = expect_name();
+		Function function = parse_signature(nullptr);
+		declare_function(name, line, std::move(function));
+		end_of_line();
+	}
+
+	void parse_function() {
+		const int function_line = current.line;
+		advance();
+		const int line = current.line;
+		const std::string_view name = expect_name();
+
+		std::vector<std::string_view> parameter_names;
+		Function function = parse_signature(&parameter_names);
+		end_of_line();
+
+		locals.clear();
+		for (size_t i = 0; i < parameter_names.size(); i++) {
+			if (!parameter_names[i].empty() && !locals.emplace(parameter_names[i], Variable { function.parameters[i], false, false }).second) {
+				error(line, std::format("Parameter {} is declared twice", parameter_names[i]));
+			}
+		}
+		return_type = function.return_type;
+		loop_depth = 0;
+		// Declared before the body so that it can call itself
+		declare_function(name, line, std::move(function));
+
+		while (is("local")) {
+			advance();
+			parse_variable(locals, false, "Local");
+			end_of_line();
+		}
+
+		parse_block({ "endfunction" });
+		if (expect("endfunction")) {
+			end_of_line();
+		} else if (!is("function")) {
+			error(function_line, std::format("Missing endfunction of {}", name));
+		}
+	}
+
+	/// Whether the current token ends a block. A function keyword also ends it, so a missing endfunction does not swallow the next function
+	bool at_block_end(const std::initializer_list<std::string_view> terminators) const {
+		return current.kind == TokenKind::end || is("endfunction") || is("function")
+			|| std::ranges::any_of(terminators, [&](const std::string_view terminator) { return is(terminator); });
+	}
+
+	/// Statements until one of the terminators, which is left as the current token for the caller to check
+	void parse_block(const std::initializer_list<std::string_view> terminators) {
+		while (!at_block_end(terminators)) {
+			parse_statement();
+			if (current.kind != TokenKind::newline && !at_block_end(terminators)) {
+				recover();
+			}
+			if (current.kind == TokenKind::newline) {
+				advance();
+			}
+		}
+	}
+
+	void parse_statement() {
+		const int line = current.line;
+		const size_t errors = lexer.errors.size();
+		accept("debug");
+
+		if (accept("set")) {
+			const std::string_view name = expect_name();
+			if (name.empty()) {
+				return;
+			}
+			const Variable* variable = find_variable(name);
+			int type = error_type;
+			if (!variable) {
+				error(line, std::format("Undeclared variable {}", name));
+			} else {
+				type = variable->type;
+				if (variable->is_constant) {
+					error(line, std::format("Cannot assign to constant {}", name));
+				}
+			}
+
+			if (accept("[")) {
+				check_assignable(parse_expression(), integer_type, line, "an array index");
+				expect("]");
+				if (variable && !variable->is_array) {
+					error(line, std::format("{} is not an array", name));
+				}
+			} else if (variable && variable->is_array) {
+				error(line, std::format("Array {} is assigned without an index", name));
+			}
+
+			expect("=");
+			check_assignable(parse_expression(), type, line, std::format("the assignment to {}", name));
+		} else if (accept("call")) {
+			const int call_line = current.line;
+			const std::string_view name = expect_name();
+			if (!name.empty()) {
+				parse_call(name, call_line);
+			}
+		} else if (accept("if")) {
+			check_assignable(parse_expression(), boolean_type, line, "an if condition");
+			expect("then");
+			end_of_line();
+			parse_block({ "endif", "elseif", "else" });
+			while (is("elseif")) {
+				const int elseif_line = current.line;
+				advance();
+				check_assignable(parse_expression(), boolean_type, elseif_line, "an elseif condition");
+				expect("then");
+				end_of_line();
+				parse_block({ "endif", "elseif", "else" });
+			}
+			if (accept("else")) {
+				end_of_line();
+				parse_block({ "endif" });
+			}
+			if (!accept("endif")) {
+				error(line, "Missing endif");
+				return;
+			}
+		} else if (accept("loop")) {
+			end_of_line();
+			loop_depth += 1;
+			parse_block({ "endloop" });
+			loop_depth -= 1;
+			if (!accept("endloop")) {
+				error(line, "Missing endloop");
+				return;
+			}
+		} else if (accept("exitwhen")) {
+			if (loop_depth == 0) {
+				error(line, "exitwhen outside of a loop");
+			}
+			check_assignable(parse_expression(), boolean_type, line, "an exitwhen condition");
+		} else if (accept("return")) {
+			if (current.kind == TokenKind::newline || current.kind == TokenKind::end) {
+				if (return_type != nothing_type) {
+					error(line, std::format("Missing return value of type {}", type_name(return_type)));
+				}
+			} else {
+				const int type = parse_expression();
+				if (return_type == nothing_type) {
+					error(line, "Returning a value from a function that returns nothing");
+				} else {
+					check_assignable(type, return_type, line, "a return");
+				}
+			}
+		} else if (is("local")) {
+			error(line, "Local variables must be declared at the start of a function");
+			advance();
+			parse_variable(locals, false, "Local");
+		} else {
+			error(line, std::format("Expected a statement but found {}", describe(current)));
+			return;
+		}
+
+		if (lexer.errors.size() == errors && current.kind != TokenKind::newline && current.kind != TokenKind::end) {
+			error(current.line, std::format("Expected end of line but found {}", describe(current)));
+		}
+	}
+
+	/// With the function name already consumed, parses the arguments and returns the return type
+	int parse_call(const std::string_view name, const int line) {
+		const Function* function = find_function(name);
+		if (!function) {
+			error(line, std::format("Undeclared function {}", name));
+		}
+
+		std::vector<int> arguments;
+		if (expect("(") && !accept(")")) {
+			do {
+				arguments.push_back(parse_expression());
+			} while (accept(","));
+			expect(")");
+		}
+
+		if (!function) {
+			return error_type;
+		}
+		if (arguments.size() != function->parameters.size()) {
+			error(line, std::format("{} takes {} arguments but is called with {}", name, function->parameters.size(), arguments.size()));
+		} else {
+			for (size_t i = 0; i < arguments.size(); i++) {
+				check_assignable(arguments[i], function->parameters[i], line, std::format("argument {} of {}", i + 1, name));
+			}
+		}
+		return function->return_type;
+	}
+
+	// The precedence follows pjass: and/or, then comparisons, then not, then + and -, then * and /
+
+	int parse_expression() {
+		int left = parse_comparison();
+		while (is("and") || is("or")) {
+			const Token operation = current;
+			advance();
+			const int right = parse_comparison();
+			check_assignable(left, boolean_type, operation.line, std::format("the left side of {}", operation.text));
+			check_assignable(right, boolean_type, operation.line, std::format("the right side of {}", operation.text));
+			left = boolean_type;
+		}
+		return left;
+	}
+
+	int parse_comparison() {
+		int left = parse_not();
+		while (current.kind == TokenKind::symbol && (is("==") || is("!=") || is("<") || is(">") || is("<=") || is(">="))) {
+			const Token operation = current;
+			advance();
+			const int right = parse_not();
+			if (left != error_type && right != error_type) {
+				if (operation.text == "==" || operation.text == "!=") {
+					const bool comparable = (is_numeric(left) && is_numeric(right)) || assignable(left, right) || assignable(right, left);
+					if (!comparable) {
+						error(operation.line, std::format("Cannot compare {} with {}", type_name(left), type_name(right)));
+					}
+				} else if (!is_numeric(left) || !is_numeric(right)) {
+					error(operation.line, std::format("Cannot compare {} with {} using {}", type_name(left), type_name(right), operation.text));
+				}
+			}
+			left = boolean_type;
+		}
+		return left;
+	}
+
+	int parse_not() {
+		if (is("not")) {
+			const int line = current.line;
+			advance();
+			check_assignable(parse_not(), boolean_type, line, "not");
+			return boolean_type;
+		}
+		return parse_additive();
+	}
+
+	int arithmetic(const int left, const int right, const Token& operation) {
+		if (left == error_type || right == error_type) {
+			return error_type;
+		}
+		if (operation.text == "+" && left == string_type && (right == string_type || right == null_type)) {
+			return string_type;
+		}
+		if (!is_numeric(left) || !is_numeric(right)) {
+			error(operation.line, std::format("Cannot use {} on {} and {}", operation.text, type_name(left), type_name(right)));
+			return error_type;
+		}
+		return left == real_type || right == real_type ? real_type : integer_type;
+	}
+
+	int parse_additive() {
+		int left = parse_multiplicative();
+		while (current.kind == TokenKind::symbol && (is("+") || is("-"))) {
+			const Token operation = current;
+			advance();
+			left = arithmetic(left, parse_multiplicative(), operation);
+		}
+		return left;
+	}
+
+	int parse_multiplicative() {
+		int left = parse_unary();
+		while (current.kind == TokenKind::symbol && (is("*") || is("/"))) {
+			const Token operation = current;
+			advance();
+			left = arithmetic(left, parse_unary(), operation);
+		}
+		return left;
+	}
+
+	int parse_unary() {
+		if (current.kind == TokenKind::symbol && (is("-") || is("+"))) {
+			const Token operation = current;
+			advance();
+			const int type = parse_unary();
+			if (type != error_type && !is_numeric(type)) {
+				error(operation.line, std::format("Cannot use {} on {}", operation.text, type_name(type)));
+				return error_type;
+			}
+			return type;
+		}
+		return parse_primary();
+	}
+
+	int parse_primary() {
+		const Token token = current;
+		switch (token.kind) {
+			case TokenKind::integer:
+				advance();
+				return integer_type;
+			case TokenKind::real:
+				advance();
+				return real_type;
+			case TokenKind::string:
+				advance();
+				return string_type;
+			case TokenKind::symbol:
+				if (accept("(")) {
+					const int type = parse_expression();
+					expect(")");
+					return type;
+				}
+				break;
+			case TokenKind::identifier: {
+				advance();
+				if (token.text == "true" || token.text == "false") {
+					return boolean_type;
+				}
+				if (token.text == "null") {
+					return null_type;
+				}
+				if (token.text == "function") {
+					const int line = current.line;
+					const std::string_view name = expect_name();
+					const Function* function = find_function(name);
+					if (!name.empty() && !function) {
+						error(line, std::format("Undeclared function {}", name));
+					} else if (function && !function->parameters.empty()) {
+						error(line, std::format("Function {} takes arguments and cannot be used as code", name));
+					}
+					return code_type;
+				}
+				if (is("(")) {
+					const int type = parse_call(token.text, token.line);
+					if (type == nothing_type) {
+						error(token.line, std::format("{} returns nothing and cannot be used as a value", token.text));
+						return error_type;
+					}
+					return type;
+				}
+
+				const Variable* variable = find_variable(token.text);
+				if (!variable) {
+					error(token.line, std::format("Undeclared variable {}", token.text));
+				}
+				if (accept("[")) {
+					check_assignable(parse_expression(), integer_type, token.line, "an array index");
+					expect("]");
+					if (variable && !variable->is_array) {
+						error(token.line, std::format("{} is not an array", token.text));
+					}
+				} else if (variable && variable->is_array) {
+					error(token.line, std::format("Array {} is used without an index", token.text));
+				}
+				return variable ? variable->type : error_type;
+			}
+			default:
+				break;
+		}
+
+		error(token.line, std::format("Expected a value but found {}", describe(token)));
+		return error_type;
+	}
+
+  public:
+	Parser(const std::string_view source, std::vector<JassError>& errors, const std::string& file, Declarations& declarations, const Declarations* base)
+		: lexer(source, errors, file), declarations(declarations), base(base) {
+		lookahead = lexer.next();
+		advance();
+	}
+
+	/// Returns whether the script uses vJass, in which case parsing stopped there
+	bool parse() {
+		while (current.kind != TokenKind::end && !lexer.uses_vjass) {
+			if (current.kind == TokenKind::newline) {
+				advance();
+				continue;
+			}
+
+			if (is("type")) {
+				parse_type_declaration();
+			} else if (is("globals")) {
+				// vJass allows any number of globals blocks anywhere, JassHelper moves them to the top
+				if (seen_globals || seen_function) {
+					lexer.uses_vjass = true;
+					break;
+				}
+				seen_globals = true;
+				parse_globals();
+			} else if (is("native") || (is("constant") && lookahead.text == "native")) {
+				accept("constant");
+				parse_native();
+			} else if (is("function") && lookahead.text == "interface") {
+				lexer.uses_vjass = true;
+				break;
+			} else if (is("function") || (is("constant") && lookahead.text == "function")) {
+				accept("constant");
+				seen_function = true;
+				parse_function();
+			} else if (current.kind == TokenKind::identifier && std::ranges::find(vjass_keywords, current.text) != vjass_keywords.end()) {
+				lexer.uses_vjass = true;
+				break;
+			} else {
+				error(current.line, std::format("Expected a declaration but found {}", describe(current)));
+				recover();
+			}
+		}
+		return lexer.uses_vjass;
+	}
+};
+
+/// Checks JASS map scripts against the declarations of common.j and blizzard.j, which are parsed once and shared by every check
+export class JassChecker {
+	Declarations base;
+	/// The declarations refer to the text of the scripts they were parsed from
+	std::deque<std::string> sources;
+	std::deque<std::string> files;
+
+  public:
+	JassChecker() {
+		for (const auto name : { "nothing"sv, "integer"sv, "real"sv, "boolean"sv, "string"sv, "code"sv, "handle"sv, "null"sv }) {
+			base.type_ids.emplace(name, static_cast<int>(base.types.size()));
+			base.types.push_back({ name, -1 });
+		}
+	}
+
+	/// Adds the declarations of a script like common.j or blizzard.j, in order. Returns the errors in it
+	std::vector<JassError> add_base_script(std::string source, std::string file) {
+		const std::string& text = sources.emplace_back(std::move(source));
+		const std::string& name = files.emplace_back(std::move(file));
+
+		std::vector<JassError> errors;
+		Parser(text, errors, name, base, nullptr).parse();
+		return errors;
+	}
+
+	JassCheckResult check(const std::string_view script, const std::string& file = "war3map.j") const {
+		JassCheckResult result;
+		Declarations declarations;
+		declarations.types = base.types;
+		declarations.type_ids = base.type_ids;
+		result.uses_vjass = Parser(script, result.errors, file, declarations, &base).parse();
+		std::ranges::stable_sort(result.errors, {}, &JassError::line);
+		return result;
+	}
+};
\ No newline at end of file
@@ -7,12 +7,13 @@ module Triggers;
 
 import std;
 import INI;
+import JassChecker;
+import Timer;
 namespace fs = std::filesystem;
 
 void generate_global_variables(
 	MapScriptWriter& script,
-	std::unordered_map<std::string, std::string>& unit_variables,
-	std::unordered_map<std::string, std::string>& destructable_variables,
+	const ScriptReferences& references,
 	const std::vector<Trigger>& triggers,
 	const std::vector<TriggerVariable>& variables,
 	const ini::INI& trigger_data,
@@ -88,12 +89,16 @@ void generate_global_variables(
 		script.global("trigger", "gg_trg_" + trigger_name, script.null());
 	}
 
-	for (const auto& [creation_number, type] : unit_variables) {
-		script.global("unit", "gg_unit_" + type + "_" + creation_number, script.null());
+	for (const auto& [creation_number, names] : references.units) {
+		for (const auto& name : names) {
+			script.global("unit", name, script.null());
+		}
 	}
 
-	for (const auto& [creation_number, type] : destructable_variables) {
-		script.global("destructable", "gg_dest_" + type + "_" + creation_number, script.null());
+	for (const auto& [creation_number, names] : references.destructables) {
+		for (const auto& name : names) {
+			script.global("destructable", name, script.null());
+		}
 	}
 
 	if (script.mode == ScriptMode::jass) {
@@ -146,26 +151,180 @@ void generate_init_global_variables(MapScriptWriter& script, const std::vector<T
 	});
 }
 
-void generate_units(
+/// Rows of packed objects per creation function. Each function runs in its own thread in JASS, which keeps it far from the op limit
+constexpr size_t packed_chunk_size = 1000;
+
+/// The shortest fixed point form, JASS has no exponents and integer literals convert to real
+std::string compact_real(const float value) {
+	std::string output = std::format("{:.4f}", value);
+	output.erase(output.find_last_not_of('0') + 1);
+	if (output.back() == '.') {
+		output.pop_back();
+	}
+	return output == "-0" ? "0" : output;
+}
+
+/// Lua gets the value FourCC() would return so the tables do not call it for every object
+std::string packed_id(const MapScriptWriter& script, const std::string_view id) {
+	if (script.mode == ScriptMode::jass) {
+		return std::format("'{}'", id);
+	}
+	uint32_t value = 0;
+	for (const char c : id) {
+		value = (value << 8) | static_cast<uint8_t>(c);
+	}
+	return std::to_string(value);
+}
+
+/// Writes rows of comma separated values into functions of packed_chunk_size rows and returns the names of those functions.
+/// JASS has no array literals and filling arrays would take a set per value, so every JASS row becomes a call to helper.
+/// In Lua the rows of a function form one table that is looped over, with create reading the values of a row from data[i]
+std::vector<std::string> generate_packed_chunks(
 	MapScriptWriter& script,
-	const std::unordered_map<std::string, std::string>& unit_variables,
-	const Terrain& terrain,
-	const Units& units
+	const std::string_view name,
+	const std::vector<std::string>& rows,
+	const std::string_view helper,
+	const size_t fields,
+	const std::string_view create
 ) {
+	std::vector<std::string> names;
+	for (size_t first = 0; first < rows.size(); first += packed_chunk_size) {
+		const auto chunk = std::span(rows).subspan(first, std::min(packed_chunk_size, rows.size() - first));
+		const std::string& chunk_name = names.emplace_back(std::format("{}_{}", name, names.size()));
+
+		script.function(chunk_name, [&]() {
+			if (script.mode == ScriptMode::jass) {
+				for (const auto& row : chunk) {
+					script.write_ln("call ", helper, "(", row, ")");
+				}
+				return;
+			}
+
+			script.write_ln("local data = {");
+			for (const auto& row : chunk) {
+				script.write_ln("\t", row, ",");
+			}
+			script.write_ln("}");
+			script.write_ln("for i = 1, #data, ", fields, " do");
+			script.write_ln("\t", create);
+			script.write_ln("end");
+		});
+	}
+	return names;
+}
+
+void call_packed_chunks(MapScriptWriter& script, const std::vector<std::string>& names) {
+	for (const auto& i : names) {
+		if (script.mode == ScriptMode::jass) {
+			script.call("ExecuteFunc", "\"" + i + "\"");
+		} else {
+			script.call(i);
+		}
+	}
+}
+
+/// Units that only need to be created, everything generate_units() would set on them afterwards has its default value
+bool is_plain_unit(const Unit& unit, const ScriptReferences& references) {
+	return unit.health == -1 && unit.mana == -1 && unit.level == 1 && unit.strength == 0 && unit.agility == 0 && unit.intelligence == 0
+		&& unit.target_acquisition == -1.f && unit.abilities.empty() && unit.items.empty() && unit.item_sets.empty()
+		&& !references.units.contains(unit.creation_number);
+}
+
+/// Runs of fewer plain units between special ones are created explicitly, a function of their own would cost more than it saves
+constexpr size_t min_packed_run = 16;
+
+/// Returns how many units were packed. Consecutive plain units are packed together and created where the run starts,
+/// so the units are created in the same order as without packing
+size_t generate_units(
+	MapScriptWriter& script,
+	const ScriptReferences& references,
+	const glm::vec2 terrain_offset,
+	const Units& units,
+	const bool pack
+) {
+	std::vector<bool> packed(units.units.size(), false);
+	// The index of the first unit of every run and the functions that create the run
+	std::vector<std::pair<size_t, std::vector<std::string>>> packed_runs;
+	size_t packed_count = 0;
+
+	std::vector<size_t> run;
+	const auto end_run = [&]() {
+		if (run.size() >= min_packed_run) {
+			if (packed_runs.empty() && script.mode == ScriptMode::jass) {
+				script.function(
+					"HiveWE_CreateUnit",
+					[&]() {
+						script.call("BlzCreateUnitWithSkin", "Player(owner)", "id", "x", "y", "facing", "skin");
+					},
+					"takes integer owner, integer id, real x, real y, real facing, integer skin returns nothing"
+				);
+			}
+
+			std::vector<std::string> rows;
+			for (const size_t index : run) {
+				const Unit& i = units.units[index];
+				packed[index] = true;
+				rows.push_back(std::format(
+					"{}, {}, {}, {}, {}, {}",
+					i.player,
+					packed_id(script, i.id),
+					compact_real(i.position.x * 128.f + terrain_offset.x),
+					compact_real(i.position.y * 128.f + terrain_offset.y),
+					compact_real(glm::degrees(i.angle)),
+					packed_id(script, i.skin_id)
+				));
+			}
+			packed_runs.emplace_back(run.front(), generate_packed_chunks(
+				script,
+				std::format("CreateUnits_{}", packed_runs.size()),
+				rows,
+				"HiveWE_CreateUnit",
+				6,
+				"BlzCreateUnitWithSkin(Player(data[i]), data[i + 1], data[i + 2], data[i + 3], data[i + 4], data[i + 5])"
+			));
+			packed_count += run.size();
+		}
+		run.clear();
+	};
+
+	if (pack) {
+		for (size_t index = 0; index < units.units.size(); index++) {
+			const Unit& unit = units.units[index];
+			// Start locations are not created, so they don't interrupt a run
+			if (unit.id == "sloc") {
+				continue;
+			}
+			if (is_plain_unit(unit, references)) {
+				run.push_back(index);
+			} else {
+				end_run();
+			}
+		}
+		end_run();
+	}
+
 	script.function("CreateAllUnits", [&]() {
 		script.local("unit", "u", script.null());
 		script.local("integer", "unitID", "0");
 		script.local("trigger", "t", script.null());
 		script.local("real", "life", "0");
 
-		for (const auto& i : units.units) {
-			if (i.id == "sloc") {
+		auto next_run = packed_runs.begin();
+		for (size_t index = 0; index < units.units.size(); index++) {
+			const Unit& i = units.units[index];
+			if (next_run != packed_runs.end() && next_run->first == index) {
+				call_packed_chunks(script, next_run->second);
+				++next_run;
+			}
+
+			if (i.id == "sloc" || packed[index]) {
 				continue;
 			}
 
 			std::string unit_reference = "u";
-			if (unit_variables.contains(std::format("{:0>4}", i.creation_number))) {
-				unit_reference = std::format("gg_unit_{}_{:0>4}", i.id, i.creation_number);
+			const auto names = references.units.find(i.creation_number);
+			if (names != references.units.end()) {
+				unit_reference = *names->second.begin();
 			}
 
 			script.set_variable(
@@ -174,13 +333,20 @@ void generate_units(
 					"BlzCreateUnitWithSkin(Player({}), {}, {:.4f}, {:.4f}, {:.4f}, {})",
 					i.player,
 					script.four_cc(i.id),
-					i.position.x * 128.f + terrain.offset.x,
-					i.position.y * 128.f + terrain.offset.y,
+					i.position.x * 128.f + terrain_offset.x,
+					i.position.y * 128.f + terrain_offset.y,
 					glm::degrees(i.angle),
 					script.four_cc(i.skin_id)
 				)
 			);
 
+			// The other spellings of the same unit
+			if (names != references.units.end()) {
+				for (const auto& name : names->second | std::views::drop(1)) {
+					script.set_variable(name, unit_reference);
+				}
+			}
+
 			if (i.health != -1) {
 				script.set_variable("life", std::format("GetUnitState({}, {})", unit_reference, "UNIT_STATE_LIFE"));
 				script.call("SetUnitState", unit_reference, "UNIT_STATE_LIFE", std::to_string(i.health / 100.f) + " * life");
@@ -252,25 +418,71 @@ void generate_units(
 			}
 		}
 	});
+
+	return packed_count;
 }
 
-void generate_items(MapScriptWriter& script, const Terrain& terrain, const Units& units) {
+/// Returns how many items were packed, which is all of them when pack is set as items have nothing beyond their position
+size_t generate_items(MapScriptWriter& script, const glm::vec2 terrain_offset, const Units& units, const bool pack) {
+	if (!pack || units.items.empty()) {
+		script.function("CreateAllItems", [&]() {
+			for (const auto& i : units.items) {
+				script.call(
+					"BlzCreateItemWithSkin",
+					script.four_cc(i.id),
+					i.position.x * 128.f + terrain_offset.x,
+					i.position.y * 128.f + terrain_offset.y,
+					script.four_cc(i.id)
+				);
+			}
+		});
+		return 0;
+	}
+
+	std::vector<std::string> packed_rows;
+	for (const auto& i : units.items) {
+		packed_rows.push_back(std::format(
+			"{}, {}, {}",
+			packed_id(script, i.id),
+			compact_real(i.position.x * 128.f + terrain_offset.x),
+			compact_real(i.position.y * 128.f + terrain_offset.y)
+		));
+	}
+
+	if (script.mode == ScriptMode::jass) {
+		script.function(
+			"HiveWE_CreateItem",
+			[&]() {
+				script.call("BlzCreateItemWithSkin", "id", "x", "y", "id");
+			},
+			"takes integer id, real x, real y returns nothing"
+		);
+	}
+	const std::vector<std::string> chunks = generate_packed_chunks(
+		script,
+		"CreateItems",
+		packed_rows,
+		"HiveWE_CreateItem",
+		3,
+		"BlzCreateItemWithSkin(data[i], data[i + 1], data[i + 2], data[i])"
+	);
+
 	script.function("CreateAllItems", [&]() {
-		for (const auto& i : units.items) {
-			script.call(
-				"BlzCreateItemWithSkin",
-				script.four_cc(i.id),
-				i.position.x * 128.f + terrain.offset.x,
-				i.position.y * 128.f + terrain.offset.y,
-				script.four_cc(i.id)
-			);
-		}
+		call_packed_chunks(script, chunks);
 	});
+	return packed_rows.size();
+}
+
+std::pair<std::string, size_t> generate_preplaced_object_script(const Units& units, const glm::vec2 terrain_offset, const ScriptMode mode, const bool pack) {
+	MapScriptWriter script(mode);
+	const size_t packed_items = generate_items(script, terrain_offset, units, pack);
+	const size_t packed_units = generate_units(script, {}, terrain_offset, units, pack);
+	return { std::move(script.script), packed_items + packed_units };
 }
 
 void generate_destructables(
 	MapScriptWriter& script,
-	const std::unordered_map<std::string, std::string>& destructable_variables,
+	const ScriptReferences& references,
 	const Terrain& terrain,
 	const Doodads& doodads
 ) {
@@ -282,8 +494,9 @@ void generate_destructables(
 		for (const auto& i : doodads.doodads) {
 			std::string id = "d";
 
-			if (destructable_variables.contains(std::to_string(i.creation_number))) {
-				id = "gg_dest_" + i.id + "_" + std::to_string(i.creation_number);
+			const auto names = references.destructables.find(i.creation_number);
+			if (names != references.destructables.end()) {
+				id = *names->second.begin();
 			}
 
 			if (id == "d" && i.item_sets.empty() && i.item_table_pointer == -1) {
@@ -305,6 +518,13 @@ void generate_destructables(
 				)
 			);
 
+			// The other spellings of the same destructable
+			if (names != references.destructables.end()) {
+				for (const auto& name : names->second | std::views::drop(1)) {
+					script.set_variable(name, id);
+				}
+			}
+
 			if (i.life != 100) {
 				script.set_variable("life", "GetDestructableLife(" + id + ")");
 				script.call("SetDestructableLife", id, std::to_string(i.life / 100.f) + " * life");
@@ -764,6 +984,184 @@ void generate_map_configuration(MapScriptWriter& script, const Terrain& terrain,
 	});
 }
 
+void append_cache_key(std::string& key, const size_t value) {
+	key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void append_cache_key(std::string& key, const std::string_view value) {
+	append_cache_key(key, value.size());
+	key += value;
+}
+
+void append_cache_key(std::string& key, const ECA& eca, const std::unordered_map<std::string_view, std::string_view>& variable_types);
+
+void append_cache_key(std::string& key, const TriggerParameter& parameter, const std::unordered_map<std::string_view, std::string_view>& variable_types) {
+	key += static_cast<char>(parameter.type);
+	append_cache_key(key, parameter.value);
+	if (parameter.type == TriggerParameter::Type::variable) {
+		// SetVariable converts its value depending on the type of the variable
+		const auto type = variable_types.find(parameter.value);
+		append_cache_key(key, type == variable_types.end() ? "" : type->second);
+	}
+
+	key += static_cast<char>(parameter.has_sub_parameter);
+	if (parameter.has_sub_parameter) {
+		append_cache_key(key, parameter.sub_parameter, variable_types);
+	}
+
+	key += static_cast<char>(parameter.is_array);
+	if (parameter.is_array) {
+		append_cache_key(key, parameter.parameters.size());
+		for (const auto& i : parameter.parameters) {
+			append_cache_key(key, i, variable_types);
+		}
+	}
+}
+
+void append_cache_key(std::string& key, const ECA& eca, const std::unordered_map<std::string_view, std::string_view>& variable_types) {
+	key += static_cast<char>(eca.type);
+	key += static_cast<char>(eca.enabled);
+	append_cache_key(key, static_cast<size_t>(eca.group));
+	append_cache_key(key, eca.name);
+
+	append_cache_key(key, eca.parameters.size());
+	for (const auto& i : eca.parameters) {
+		append_cache_key(key, i, variable_types);
+	}
+
+	append_cache_key(key, eca.ecas.size());
+	for (const auto& i : eca.ecas) {
+		append_cache_key(key, i, variable_types);
+	}
+}
+
+/// Everything the script of a GUI trigger is generated from. The strings are length prefixed so that two different triggers never give the same key
+std::string trigger_cache_key(const Trigger& trigger, const ScriptMode mode, const std::unordered_map<std::string_view, std::string_view>& variable_types) {
+	std::string key;
+	key += static_cast<char>(mode);
+	key += static_cast<char>(trigger.initially_on);
+	append_cache_key(key, trigger.name);
+
+	append_cache_key(key, trigger.ecas.size());
+	for (const auto& i : trigger.ecas) {
+		append_cache_key(key, i, variable_types);
+	}
+	return key;
+}
+
+TriggerScripts Triggers::convert_triggers(const ScriptMode mode, const bool parallel) {
+	std::unordered_map<std::string_view, std::string_view> variable_types;
+	for (const auto& i : variables) {
+		variable_types.emplace(i.name, i.type);
+	}
+
+	// Pointers stay valid while entries are added, so every trigger can point at its entry
+	std::unordered_map<std::string, ConvertedTrigger> cache;
+	std::vector<ConvertedTrigger*> converted(triggers.size(), nullptr);
+	std::vector<size_t> pending;
+
+	for (size_t i = 0; i < triggers.size(); i++) {
+		const Trigger& trigger = triggers[i];
+		if (trigger.is_comment || !trigger.is_enabled || !trigger.custom_text.empty()) {
+			continue;
+		}
+
+		std::string key = trigger_cache_key(trigger, mode, variable_types);
+		auto entry = cache.find(key);
+		if (entry == cache.end()) {
+			auto cached = parallel ? converted_triggers.extract(key) : decltype(converted_triggers)::node_type();
+			if (cached) {
+				entry = cache.insert(std::move(cached)).position;
+			} else {
+				entry = cache.emplace(std::move(key), ConvertedTrigger()).first;
+				pending.push_back(i);
+			}
+		}
+		converted[i] = &entry->second;
+	}
+
+	const auto convert = [&](const size_t i) {
+		converted[i]->script = convert_gui_to_jass(triggers[i], converted[i]->map_initializations, converted[i]->references, mode);
+	};
+	if (parallel) {
+		std::for_each(std::execution::par, pending.begin(), pending.end(), convert);
+	} else {
+		std::ranges::for_each(pending, convert);
+	}
+
+	TriggerScripts output;
+	for (size_t i = 0; i < triggers.size(); i++) {
+		const Trigger& trigger = triggers[i];
+		if (trigger.is_comment || !trigger.is_enabled) {
+			continue;
+		}
+
+		if (!trigger.custom_text.empty()) {
+			// Custom script is only text, GUI triggers record their references while they are converted
+			output.references.scan(trigger.custom_text);
+			output.script += trigger.custom_text + "\n";
+			continue;
+		}
+
+		output.script += converted[i]->script;
+		output.references.merge(converted[i]->references);
+		output.map_initializations.insert(output.map_initializations.end(), converted[i]->map_initializations.begin(), converted[i]->map_initializations.end());
+	}
+
+	if (parallel) {
+		converted_triggers = std::move(cache);
+	}
+	return output;
+}
+
+/// common.j and blizzard.j are written to data/tools on startup. They are parsed on the first save and reused by every save after.
+/// Null when they could not be parsed, in which case JassHelper checks the script
+const JassChecker* jass_checker() {
+	static const std::optional<JassChecker> checker = []() -> std::optional<JassChecker> {
+		JassChecker checker;
+		for (const auto file : { "common.j", "blizzard.j" }) {
+			const std::string source = read_text_file(fs::path("data/tools") / file);
+			if (source.empty()) {
+				return std::nullopt;
+			}
+			const std::vector<JassError> errors = checker.add_base_script(source, file);
+			if (!errors.empty()) {
+				std::print("Unable to parse {}:{}: {}\n", file, errors.front().line, errors.front().message);
+				return std::nullopt;
+			}
+		}
+		return checker;
+	}();
+	return checker ? &*checker : nullptr;
+}
+
+/// The errors with the line they are on, the first few only as one mistake tends to cause more
+std::string format_jass_errors(const std::vector<JassError>& errors, const std::string_view script) {
+	constexpr size_t max_errors = 20;
+
+	std::vector<std::string_view> lines;
+	for (const auto line : std::views::split(script, '\n')) {
+		lines.emplace_back(line.begin(), line.end());
+	}
+
+	std::string output;
+	for (const auto& error : errors | std::views::take(max_errors)) {
+		output += std::format("{}:{}: {}\n", error.file, error.line, error.message);
+		if (error.line >= 1 && error.line <= static_cast<int>(lines.size())) {
+			const std::string_view line = lines[error.line - 1];
+			const size_t begin = line.find_first_not_of(" \t");
+			const size_t end = line.find_last_not_of(" \t\r");
+			if (begin != std::string_view::npos) {
+				output += std::format("    {}\n", line.substr(begin, end - begin + 1));
+			}
+		}
+	}
+	if (errors.size() > max_errors) {
+		output += std::format("and {} more errors\n", errors.size() - max_errors);
+	}
+	return output;
+}
+
 /// Returns compile output which could contain errors or general information
 std::expected<void, std::string> Triggers::generate_map_script(
 	const Terrain& terrain,
@@ -773,47 +1171,17 @@ std::expected<void, std::string> Triggers::generate_map_script(
 	const Sounds& sounds,
 	const Regions& regions,
 	const GameCameras& cameras,
-	ScriptMode mode
+	ScriptMode mode,
+	bool pack_preplaced_objects
 ) {
-	std::unordered_map<std::string, std::string> unit_variables; // creation_number, unit_id
-	std::unordered_map<std::string, std::string> destructable_variables; // creation_number, destructable_id
-	std::vector<std::string> initialization_triggers;
-
-	std::string trigger_script;
-	for (const auto& i : triggers) {
-		if (i.is_comment || !i.is_enabled) {
-			continue;
-		}
-		if (!i.custom_text.empty()) {
-			trigger_script += i.custom_text + "\n";
-		} else {
-			trigger_script += convert_gui_to_jass(i, initialization_triggers, mode);
-		}
-	}
-
-	// Search the trigger script for global unit/destructible definitions
-	size_t pos = trigger_script.find("gg_unit", 0);
-	while (pos != std::string::npos) {
-		std::string type = trigger_script.substr(pos + 8, 4);
-		std::string creation_number = trigger_script.substr(pos + 13, 4);
-		unit_variables[creation_number] = type;
-		pos = trigger_script.find("gg_unit", pos + 17);
-	}
-
-	pos = trigger_script.find("gg_dest", 0);
-	while (pos != std::string::npos) {
-		std::string type = trigger_script.substr(pos + 8, 4);
-		std::string creation_number = trigger_script.substr(pos + 13, trigger_script.find_first_not_of("0123456789", pos + 13) - pos - 13);
-		destructable_variables[creation_number] = type;
-		pos = trigger_script.find("gg_dest", pos + 17);
-	}
+	Timer timer;
+	TriggerScripts trigger_scripts = convert_triggers(mode);
 
 	MapScriptWriter script_writer(mode);
 
 	generate_global_variables(
 		script_writer,
-		unit_variables,
-		destructable_variables,
+		trigger_scripts.references,
 		triggers,
 		variables,
 		trigger_data,
@@ -827,29 +1195,49 @@ std::expected<void, std::string> Triggers::generate_map_script(
 	generate_item_tables(script_writer, "DoodadItemDrops_", doodads.doodads);
 	generate_sounds(script_writer, sounds);
 
-	generate_destructables(script_writer, destructable_variables, terrain, doodads);
-	generate_items(script_writer, terrain, units);
-	generate_units(script_writer, unit_variables, terrain, units);
+	generate_destructables(script_writer, trigger_scripts.references, terrain, doodads);
+	const size_t packed_items = generate_items(script_writer, terrain.offset, units, pack_preplaced_objects);
+	const size_t packed_units = generate_units(script_writer, trigger_scripts.references, terrain.offset, units, pack_preplaced_objects);
 	generate_regions(script_writer, regions);
 	generate_cameras(script_writer, cameras);
 
 	script_writer.write_ln(global_jass);
 
-	script_writer.write(trigger_script);
+	script_writer.write(trigger_scripts.script);
 
-	generate_trigger_initialization(script_writer, initialization_triggers, triggers);
+	generate_trigger_initialization(script_writer, trigger_scripts.map_initializations, triggers);
 	generate_players(script_writer, map_info);
 	generate_custom_teams(script_writer, map_info);
 	generate_ally_priorities(script_writer, map_info);
 	generate_main(script_writer, terrain, map_info);
 	generate_map_configuration(script_writer, terrain, units, map_info);
 
+	std::println(
+		"Map script: {} KiB in {:.1f}ms, {} of {} preplaced units and items packed",
+		script_writer.script.size() / 1024,
+		timer.elapsed_ms(),
+		packed_items + packed_units,
+		units.units.size() + units.items.size()
+	);
+
 	fs::path path = QDir::tempPath().toStdString() + "/input.lua";
 	std::ofstream output(path, std::ios::binary);
 	output.write((char*)script_writer.script.data(), script_writer.script.size());
 	output.close();
 
 	if (mode == ScriptMode::jass) {
+		// Plain JASS is checked in process, only vJass needs JassHelper to compile it
+		if (const JassChecker* checker = jass_checker()) {
+			const JassCheckResult check = checker->check(script_writer.script);
+			if (!check.uses_vjass) {
+				if (!check.errors.empty()) {
+					return std::unexpected(format_jass_errors(check.errors, script_writer.script));
+				}
+				hierarchy.map_file_add(path, "war3map.j");
+				return {};
+			}
+		}
+
 		QProcess* proc = new QProcess();
 		proc->setWorkingDirectory("data/tools");
 		proc->start(
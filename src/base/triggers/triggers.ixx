@@ -327,7 +327,7 @@ struct TriggerCategory {
 
 struct TriggerParameter;
 
-struct ECA {
+export struct ECA {
 	enum class Type {
 		event,
 		condition,
@@ -343,7 +343,7 @@ struct ECA {
 	std::vector<ECA> ecas;
 };
 
-struct TriggerParameter {
+export struct TriggerParameter {
 	enum class Type {
 		invalid = -1,
 		preset,
@@ -382,7 +382,7 @@ export struct Trigger {
 	static inline int next_id = 0;
 };
 
-struct TriggerVariable {
+export struct TriggerVariable {
 	std::string name;
 	std::string type;
 	uint32_t unknown;
@@ -394,6 +394,85 @@ struct TriggerVariable {
 	int parent_id;
 };
 
+/// The preplaced units and destructables that triggers refer to and that therefore need a global variable.
+/// Keyed by creation number, the value is the type id that is part of the variable name
+struct ScriptReferences {
+	/// Creation number -> the variable names as the triggers spell them, the creation number may or may not be padded with zeros
+	std::unordered_map<int, std::set<std::string>> units;
+	std::unordered_map<int, std::set<std::string>> destructables;
+
+	/// Records name if it is a gg_unit_<type>_<creation number> or gg_dest_<type>_<creation number> variable
+	void add(const std::string_view name) {
+		std::unordered_map<int, std::set<std::string>>* references;
+		if (name.starts_with("gg_unit_")) {
+			references = &units;
+		} else if (name.starts_with("gg_dest_")) {
+			references = &destructables;
+		} else {
+			return;
+		}
+
+		// The prefix, a four character type id, an underscore and at least one digit
+		if (name.size() < 14 || name[12] != '_') {
+			return;
+		}
+
+		int creation_number;
+		const auto [end, error] = std::from_chars(name.data() + 13, name.data() + name.size(), creation_number);
+		if (error != std::errc() || end != name.data() + name.size()) {
+			return;
+		}
+		(*references)[creation_number].emplace(name);
+	}
+
+	/// Records the variables used in script that was written by hand, like custom script triggers, where the references are only known as text
+	void scan(const std::string_view script) {
+		const auto is_identifier = [](const char c) {
+			return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+		};
+
+		size_t position = script.find("gg_");
+		while (position != std::string_view::npos) {
+			size_t end = position;
+			while (end < script.size() && is_identifier(script[end])) {
+				end += 1;
+			}
+			if (position == 0 || !is_identifier(script[position - 1])) {
+				add(script.substr(position, end - position));
+			}
+			position = script.find("gg_", end);
+		}
+	}
+
+	void merge(const ScriptReferences& other) {
+		for (const auto& [creation_number, names] : other.units) {
+			units[creation_number].insert(names.begin(), names.end());
+		}
+		for (const auto& [creation_number, names] : other.destructables) {
+			destructables[creation_number].insert(names.begin(), names.end());
+		}
+	}
+};
+
+/// The script of a single GUI trigger, kept between map script generations until the trigger changes
+struct ConvertedTrigger {
+	std::string script;
+	ScriptReferences references;
+	/// The trigger variable when the trigger runs on map initialization
+	std::vector<std::string> map_initializations;
+};
+
+/// The scripts of all enabled triggers in order, with what the rest of the map script needs from them
+export struct TriggerScripts {
+	std::string script;
+	ScriptReferences references;
+	std::vector<std::string> map_initializations;
+};
+
+/// Only the CreateAllItems and CreateAllUnits functions of the map script, with terrain_offset being Terrain::offset.
+/// Returns the script and how many units and items were packed
+export std::pair<std::string, size_t> generate_preplaced_object_script(const Units& units, glm::vec2 terrain_offset, ScriptMode mode, bool pack);
+
 std::string get_base_type(const std::string& type, const ini::INI& trigger_data) {
 	std::string base_type = trigger_data.data("TriggerTypes", type, 4);
 
@@ -415,6 +494,9 @@ export class Triggers {
 	int unknown2 = 0;
 	int trig_def_ver = 2;
 
+	/// Converted GUI triggers by everything their script is generated from, see trigger_cache_key(). Only the entries used by the last conversion are kept
+	std::unordered_map<std::string, ConvertedTrigger> converted_triggers;
+
   public:
 	ini::INI trigger_strings;
 	ini::INI trigger_data;
@@ -429,13 +511,18 @@ export class Triggers {
   private:
 	std::string get_type(const std::string_view function_name, size_t parameter) const;
 
-	std::string
-	convert_gui_to_jass(const Trigger& trigger, std::vector<std::string>& map_initializations, ScriptMode mode) const;
+	std::string convert_gui_to_jass(
+		const Trigger& trigger,
+		std::vector<std::string>& map_initializations,
+		ScriptReferences& references,
+		ScriptMode mode
+	) const;
 
 	std::string resolve_parameter(
 		const TriggerParameter& parameter,
 		const std::string& trigger_name,
 		MapScriptWriter& pre_actions,
+		ScriptReferences& references,
 		const std::string& type,
 		ScriptMode mode,
 		bool add_call
@@ -444,6 +531,7 @@ export class Triggers {
 	std::string convert_eca_to_script(
 		const ECA& eca,
 		MapScriptWriter& pre_actions,
+		ScriptReferences& references,
 		const std::string& trigger_name,
 		ScriptMode mode,
 		bool add_call
@@ -939,7 +1027,12 @@ export class Triggers {
 		hierarchy.map_file_write("war3map.wct", writer.buffer);
 	}
 
-	/// Returns compile output which could contain errors or general information
+	/// Converts the enabled triggers in order. GUI triggers that changed since the last call are converted in parallel and the others are taken from the cache.
+	/// With parallel set to false every trigger is converted on the calling thread and the cache is neither used nor updated
+	TriggerScripts convert_triggers(ScriptMode mode, bool parallel = true);
+
+	/// Returns compile output which could contain errors or general information.
+	/// With pack_preplaced_objects set, units and items that need nothing but creating are written as rows of data that chunked functions loop over
 	std::expected<void, std::string> generate_map_script(
 		const Terrain& terrain,
 		const Units& units,
@@ -948,6 +1041,7 @@ export class Triggers {
 		const Sounds& sounds,
 		const Regions& regions,
 		const GameCameras& cameras,
-		ScriptMode mode
+		ScriptMode mode,
+		bool pack_preplaced_objects = false
 	);
 };
\ No newline at end of file
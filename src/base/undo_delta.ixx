@@ -0,0 +1,166 @@
+module;
+
+#include <cassert>
+
+export module UndoDelta;
+
+import std;
+import types;
+import <lz4.h>;
+
+/// The change between two equally long runs of trivially copyable records, stored as the bytes that changed with their values before and after.
+/// Undo and redo write those values instead of toggling the bytes, so they give the same records even when something else wrote to them in between.
+/// The bytes are grouped per byte of the record (all first bytes, then all second bytes, ...) so the fields that did not change form long runs,
+/// which are stored as just their length. compress() packs the rest with LZ4 for changes that are unlikely to be undone soon
+export class ByteDelta {
+	std::vector<u8> data;
+	size_t record_size = 0;
+	size_t record_count = 0;
+	/// The size of data before compress(), 0 while it is not compressed
+	size_t encoded_size = 0;
+
+	/// An unchanged run of fewer bytes costs more to end and restart a changed run than it saves
+	static constexpr size_t min_unchanged_run = 3;
+
+	static void write_varint(std::vector<u8>& output, size_t value) {
+		while (value >= 0x80) {
+			output.push_back(static_cast<u8>(value | 0x80));
+			value >>= 7;
+		}
+		output.push_back(static_cast<u8>(value));
+	}
+
+	static size_t read_varint(const u8*& input) {
+		size_t value = 0;
+		for (int shift = 0;; shift += 7) {
+			const u8 byte = *input++;
+			value |= static_cast<size_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) {
+				return value;
+			}
+		}
+	}
+
+	/// Alternating unchanged runs and changed runs, each prefixed by its length. A changed run holds its bytes before and then after the change
+	static std::vector<u8> encode(const std::span<const u8> old_planes, const std::span<const u8> new_planes) {
+		std::vector<u8> output;
+		const auto changed = [&](const size_t i) {
+			return old_planes[i] != new_planes[i];
+		};
+		size_t i = 0;
+		while (i < old_planes.size()) {
+			const size_t unchanged_begin = i;
+			while (i < old_planes.size() && !changed(i)) {
+				i++;
+			}
+			const size_t changed_begin = i;
+			while (i < old_planes.size()) {
+				size_t unchanged = 0;
+				while (i + unchanged < old_planes.size() && !changed(i + unchanged) && unchanged < min_unchanged_run) {
+					unchanged++;
+				}
+				if (unchanged == min_unchanged_run || i + unchanged == old_planes.size()) {
+					break;
+				}
+				i += std::max<size_t>(unchanged, 1);
+			}
+			write_varint(output, changed_begin - unchanged_begin);
+			write_varint(output, i - changed_begin);
+			output.insert(output.end(), old_planes.begin() + changed_begin, old_planes.begin() + i);
+			output.insert(output.end(), new_planes.begin() + changed_begin, new_planes.begin() + i);
+		}
+		return output;
+	}
+
+	/// The bytes of the records grouped per byte of the record
+	static std::vector<u8> to_planes(const std::span<const std::byte> bytes, const size_t record_size, const size_t record_count) {
+		std::vector<u8> planes(bytes.size());
+		for (size_t i = 0; i < record_count; i++) {
+			for (size_t j = 0; j < record_size; j++) {
+				planes[j * record_count + i] = static_cast<u8>(bytes[i * record_size + j]);
+			}
+		}
+		return planes;
+	}
+
+	/// Writes the changed bytes as they were before or after the change, record(i) returns a reference to the i-th record
+	template <typename T, typename F>
+	void write(F&& record, const bool after) const {
+		static_assert(std::is_trivially_copyable_v<T>);
+		assert(sizeof(T) == record_size);
+
+		std::vector<u8> decompressed;
+		std::span<const u8> encoded = data;
+		if (encoded_size > 0) {
+			decompressed.resize(encoded_size);
+			const int size = LZ4_decompress_safe(reinterpret_cast<const char*>(data.data()), reinterpret_cast<char*>(decompressed.data()), static_cast<int>(data.size()), static_cast<int>(encoded_size));
+			assert(size == static_cast<int>(encoded_size));
+			encoded = decompressed;
+		}
+
+		const u8* input = encoded.data();
+		const u8* end = encoded.data() + encoded.size();
+		size_t position = 0;
+		while (input < end) {
+			position += read_varint(input);
+			const size_t count = read_varint(input);
+			const u8* values = after ? input + count : input;
+			for (size_t k = 0; k < count; k++, position++) {
+				T& target = record(position % record_count);
+				reinterpret_cast<u8*>(std::addressof(target))[position / record_count] = values[k];
+			}
+			input += 2 * count;
+		}
+	}
+
+  public:
+	template <typename T>
+	static ByteDelta between(const std::span<const T> old_records, const std::span<const T> new_records) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		assert(old_records.size() == new_records.size());
+
+		ByteDelta delta;
+		delta.record_size = sizeof(T);
+		delta.record_count = old_records.size();
+		delta.data = encode(to_planes(std::as_bytes(old_records), sizeof(T), delta.record_count), to_planes(std::as_bytes(new_records), sizeof(T), delta.record_count));
+		delta.data.shrink_to_fit();
+		return delta;
+	}
+
+	/// Sets the changed bytes back to how they were before the change. record(i) returns a reference to the i-th record, in the order they were passed to between()
+	template <typename T, typename F>
+	void undo(F&& record) const {
+		write<T>(record, false);
+	}
+
+	/// Sets the changed bytes to how they were after the change
+	template <typename T, typename F>
+	void redo(F&& record) const {
+		write<T>(record, true);
+	}
+
+	/// Packs the delta with LZ4, kept as is when that does not make it smaller
+	void compress() {
+		if (encoded_size > 0 || data.empty()) {
+			return;
+		}
+
+		std::vector<u8> compressed(LZ4_compressBound(static_cast<int>(data.size())));
+		const int size = LZ4_compress_default(reinterpret_cast<const char*>(data.data()), reinterpret_cast<char*>(compressed.data()), static_cast<int>(data.size()), static_cast<int>(compressed.size()));
+		if (size <= 0 || static_cast<size_t>(size) >= data.size()) {
+			return;
+		}
+		compressed.resize(size);
+		compressed.shrink_to_fit();
+		encoded_size = data.size();
+		data = std::move(compressed);
+	}
+
+	bool is_compressed() const {
+		return encoded_size > 0;
+	}
+
+	size_t memory_size() const {
+		return sizeof(ByteDelta) + data.capacity();
+	}
+};
\ No newline at end of file
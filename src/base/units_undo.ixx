@@ -2,8 +2,47 @@ export module UnitsUndo;
 
 import std;
 import Units;
+import SkinnedMesh;
+import SkeletalModelInstance;
+import Utilities;
 import WorldUndoManager;
 
+/// The animation state of a unit is larger than the rest of it and is rebuilt from its mesh, so the history keeps units without it
+void strip_skeletons(std::vector<Unit>& units) {
+	for (auto& i : units) {
+		i.skeleton = SkeletalModelInstance();
+	}
+	units.shrink_to_fit();
+}
+
+void rebuild_skeleton(Unit& unit) {
+	unit.skeleton = SkeletalModelInstance(unit.mesh->model, unit.mesh->topology);
+	unit.update();
+}
+
+/// Takes the state of the stored unit while the live unit keeps its animation.
+/// The model may have changed since the state was stored, the animation of the other model would not match the mesh so it is rebuilt
+void restore_state(Unit& target, const Unit& state) {
+	if (target.mesh != state.mesh) {
+		target = state;
+		rebuild_skeleton(target);
+		return;
+	}
+
+	SkeletalModelInstance skeleton = std::move(target.skeleton);
+	target = state;
+	target.skeleton = std::move(skeleton);
+	target.update();
+}
+
+size_t units_memory_size(const std::vector<Unit>& units) {
+	size_t bytes = units.capacity() * sizeof(Unit);
+	for (const auto& i : units) {
+		bytes += i.item_sets.capacity() * sizeof(ItemSet) + i.items.capacity() * sizeof(i.items[0]) + i.abilities.capacity() * sizeof(i.abilities[0]) + i.random.capacity();
+	}
+	return bytes;
+}
+
 // Undo/redo structures
 export class UnitAddAction final : public WorldCommand {
 public:
@@ -15,6 +54,17 @@ public:
 
 	void redo(WorldEditContext& ctx) override {
 		ctx.units.units.insert(ctx.units.units.end(), units.begin(), units.end());
+		for (auto i = ctx.units.units.end() - units.size(); i != ctx.units.units.end(); ++i) {
+			rebuild_skeleton(*i);
+		}
+	}
+
+	size_t memory_size() const override {
+		return sizeof(UnitAddAction) + units_memory_size(units);
+	}
+
+	void compact() override {
+		strip_skeletons(units);
 	}
 };
 
@@ -28,6 +78,9 @@ public:
 		}
 
 		ctx.units.units.insert(ctx.units.units.end(), units.begin(), units.end());
+		for (auto i = ctx.units.units.end() - units.size(); i != ctx.units.units.end(); ++i) {
+			rebuild_skeleton(*i);
+		}
 	}
 
 	void redo(WorldEditContext& ctx) override {
@@ -37,6 +90,14 @@ public:
 
 		ctx.units.units.resize(ctx.units.units.size() - units.size());
 	}
+
+	size_t memory_size() const override {
+		return sizeof(UnitDeleteAction) + units_memory_size(units);
+	}
+
+	void compact() override {
+		strip_skeletons(units);
+	}
 };
 
 export class UnitStateAction final : public WorldCommand {
@@ -48,7 +109,7 @@ public:
 		for (auto& i : old_units) {
 			for (auto& j : ctx.units.units) {
 				if (i.creation_number == j.creation_number) {
-					j = i;
+					restore_state(j, i);
 				}
 			}
 		}
@@ -58,11 +119,20 @@ public:
 		for (auto& i : new_units) {
 			for (auto& j : ctx.units.units) {
 				if (i.creation_number == j.creation_number) {
-					j = i;
+					restore_state(j, i);
 				}
 			}
 		}
 	}
+
+	size_t memory_size() const override {
+		return sizeof(UnitStateAction) + units_memory_size(old_units) + units_memory_size(new_units);
+	}
+
+	void compact() override {
+		strip_skeletons(old_units);
+		strip_skeletons(new_units);
+	}
 };
 
 
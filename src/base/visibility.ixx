@@ -0,0 +1,115 @@
+export module Visibility;
+
+import std;
+import types;
+import <glm/glm.hpp>;
+
+/// One bit per object telling whether its bounds intersect the view frustum.
+/// Computed once per frame so the animation update and the render queue don't both test every object.
+/// Does not touch GL or the camera so it can be tested and benchmarked on the CPU
+export class VisibilitySet {
+	// The amount of objects tested side by side.
+	// The per lane loops have a fixed trip count over contiguous floats so the compiler emits 4 (SSE/NEON) or 8 (AVX2) wide code
+	static constexpr size_t lanes = 8;
+
+	struct alignas(32) Lanes {
+		float v[lanes];
+	};
+
+	/// Returns a mask with a bit set for every lane whose box is not entirely behind one of the planes.
+	/// Matches Camera::inside_frustrum(min, max): only the corner furthest along the plane normal has to be checked
+	static u32 test_batch(const std::span<const glm::vec4> planes, const Lanes* min, const Lanes* max) {
+		u32 inside[lanes];
+		for (size_t l = 0; l < lanes; l++) {
+			inside[l] = 1;
+		}
+
+		for (const auto& plane : planes) {
+			for (size_t l = 0; l < lanes; l++) {
+				const float x = std::max(plane.x * min[0].v[l], plane.x * max[0].v[l]);
+				const float y = std::max(plane.y * min[1].v[l], plane.y * max[1].v[l]);
+				const float z = std::max(plane.z * min[2].v[l], plane.z * max[2].v[l]);
+				inside[l] &= static_cast<u32>(x + y + z + plane.w > 0.f);
+			}
+		}
+
+		u32 mask = 0;
+		for (size_t l = 0; l < lanes; l++) {
+			mask |= inside[l] << l;
+		}
+		return mask;
+	}
+
+  public:
+	std::vector<u64> bits;
+	size_t count = 0;
+
+	bool visible(const size_t index) const {
+		return index < count && ((bits[index / 64] >> (index % 64)) & 1);
+	}
+
+	size_t visible_count() const {
+		size_t total = 0;
+		for (const auto& i : bits) {
+			total += std::popcount(i);
+		}
+		return total;
+	}
+
+	/// Tests count objects against the planes, whose normals point inwards.
+	/// bounds(index, min, max) writes the world space bounds of an object and returns false for objects that are never drawn.
+	/// Every task owns a whole word of the bitset so the words can be written without synchronization
+	template <typename F>
+	void update(const std::span<const glm::vec4> planes, const size_t count, F&& bounds) {
+		this->count = count;
+		bits.assign((count + 63) / 64, 0);
+
+		std::for_each(std::execution::par, bits.begin(), bits.end(), [&](u64& word) {
+			const size_t first = (&word - bits.data()) * 64;
+			const size_t last = std::min(first + 64, count);
+
+			for (size_t batch = first; batch < last; batch += lanes) {
+				Lanes min[3];
+				Lanes max[3];
+				u32 valid = 0;
+				for (size_t l = 0; l < lanes; l++) {
+					glm::vec3 lower(0.f);
+					glm::vec3 upper(0.f);
+					if (batch + l < last && bounds(batch + l, lower, upper)) {
+						valid |= 1u << l;
+					}
+					for (size_t axis = 0; axis < 3; axis++) {
+						min[axis].v[l] = lower[axis];
+						max[axis].v[l] = upper[axis];
+					}
+				}
+
+				word |= static_cast<u64>(test_batch(planes, min, max) & valid) << (batch - first);
+			}
+		});
+	}
+
+	/// Calls callback(index) for every visible object in [first, last) in increasing order
+	template <typename F>
+	void for_each_visible(const size_t first, size_t last, F&& callback) const {
+		last = std::min(last, count);
+		if (first >= last) {
+			return;
+		}
+
+		for (size_t w = first / 64; w <= (last - 1) / 64; w++) {
+			u64 word = bits[w];
+			if (w == first / 64) {
+				word &= ~0ull << (first % 64);
+			}
+			if (w == (last - 1) / 64 && last % 64 != 0) {
+				word &= ~0ull >> (64 - last % 64);
+			}
+
+			while (word) {
+				callback(w * 64 + std::countr_zero(word));
+				word &= word - 1;
+			}
+		}
+	}
+};
\ No newline at end of file
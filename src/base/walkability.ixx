@@ -0,0 +1,184 @@
+export module Walkability;
+
+import std;
+import types;
+import <glm/glm.hpp>;
+
+/// Connected regions of the pathing map for one kind of movement.
+/// Cells connect to their 4 direct neighbours, a diagonal gap between two blocked cells does not let anything through
+export struct PathingComponents {
+	int width = 0;
+	int height = 0;
+	/// Per cell, 0 for blocked cells and otherwise the component. Components are numbered from 1 by decreasing size
+	std::vector<u32> labels;
+	/// Cells per component, sizes[0] counts the blocked cells
+	std::vector<u32> sizes;
+
+	size_t count() const {
+		return sizes.empty() ? 0 : sizes.size() - 1;
+	}
+
+	/// 0 for blocked cells and cells outside of the map
+	u32 label(const int x, const int y) const {
+		if (x < 0 || x >= width || y < 0 || y >= height) {
+			return 0;
+		}
+		return labels[y * width + x];
+	}
+};
+
+constexpr u32 blocked = std::numeric_limits<u32>::max();
+
+/// With path halving, only called for cells of a single band at a time during the parallel pass
+u32 find_root(std::vector<u32>& parent, u32 i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+/// The smaller index becomes the root so that the roots are the first cell of each component in row major order
+void unite(std::vector<u32>& parent, const u32 a, const u32 b) {
+	const u32 root_a = find_root(parent, a);
+	const u32 root_b = find_root(parent, b);
+	if (root_a < root_b) {
+		parent[root_b] = root_a;
+	} else if (root_b < root_a) {
+		parent[root_a] = root_b;
+	}
+}
+
+/// Labels the cells that have none of the blocking flags in static_cells | dynamic_cells.
+/// Bands of rows are united in parallel, after which only the rows where two bands meet have to be joined
+export PathingComponents label_pathing_components(
+	const std::span<const u8> static_cells,
+	const std::span<const u8> dynamic_cells,
+	const int width,
+	const int height,
+	const u8 blocking
+) {
+	PathingComponents components;
+	components.width = width;
+	components.height = height;
+	const size_t cell_count = static_cast<size_t>(width) * height;
+	if (cell_count == 0) {
+		components.sizes = { 0 };
+		return components;
+	}
+
+	const auto open = [&](const size_t i) {
+		return ((static_cells[i] | dynamic_cells[i]) & blocking) == 0;
+	};
+
+	// A few bands per thread so that uneven bands still keep every thread busy
+	const int band_count = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) * 4, 1, height);
+	std::vector<int> band_starts(band_count + 1);
+	for (int i = 0; i <= band_count; i++) {
+		band_starts[i] = static_cast<int>(static_cast<i64>(height) * i / band_count);
+	}
+	std::vector<int> bands(band_count);
+	std::iota(bands.begin(), bands.end(), 0);
+
+	std::vector<u32> parent(cell_count);
+	std::for_each(std::execution::par, bands.begin(), bands.end(), [&](const int band) {
+		for (int y = band_starts[band]; y < band_starts[band + 1]; y++) {
+			for (int x = 0; x < width; x++) {
+				const u32 i = y * width + x;
+				if (!open(i)) {
+					parent[i] = blocked;
+					continue;
+				}
+				parent[i] = i;
+				if (x > 0 && open(i - 1)) {
+					unite(parent, i, i - 1);
+				}
+				if (y > band_starts[band] && open(i - width)) {
+					unite(parent, i, i - width);
+				}
+			}
+		}
+	});
+
+	for (int band = 1; band < band_count; band++) {
+		const int y = band_starts[band];
+		for (int x = 0; x < width; x++) {
+			const u32 i = y * width + x;
+			if (parent[i] != blocked && parent[i - width] != blocked) {
+				unite(parent, i, i - width);
+			}
+		}
+	}
+
+	// Resolve the roots without writing to parent, so the bands can be read concurrently
+	components.labels.resize(cell_count);
+	std::for_each(std::execution::par, bands.begin(), bands.end(), [&](const int band) {
+		for (u32 i = band_starts[band] * width; i < static_cast<u32>(band_starts[band + 1] * width); i++) {
+			u32 root = parent[i];
+			if (root == blocked) {
+				components.labels[i] = blocked;
+				continue;
+			}
+			while (parent[root] != root) {
+				root = parent[root];
+			}
+			components.labels[i] = root;
+		}
+	});
+
+	// Number the roots and count the cells of every component, parent is reused to map a root to its number
+	std::vector<u32> provisional_sizes;
+	size_t blocked_cells = 0;
+	for (u32 i = 0; i < cell_count; i++) {
+		const u32 root = components.labels[i];
+		if (root == blocked) {
+			blocked_cells += 1;
+			continue;
+		}
+		// Roots are the first cell of their component, so they are numbered before any other cell refers to them
+		if (root == i) {
+			parent[i] = static_cast<u32>(provisional_sizes.size());
+			provisional_sizes.push_back(0);
+		}
+		provisional_sizes[parent[root]] += 1;
+	}
+
+	std::vector<u32> order(provisional_sizes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](const u32 a, const u32 b) {
+		return provisional_sizes[a] > provisional_sizes[b];
+	});
+	std::vector<u32> final_labels(order.size());
+	components.sizes.resize(order.size() + 1);
+	components.sizes[0] = static_cast<u32>(blocked_cells);
+	for (size_t i = 0; i < order.size(); i++) {
+		final_labels[order[i]] = static_cast<u32>(i + 1);
+		components.sizes[i + 1] = provisional_sizes[order[i]];
+	}
+
+	std::for_each(std::execution::par, bands.begin(), bands.end(), [&](const int band) {
+		for (u32 i = band_starts[band] * width; i < static_cast<u32>(band_starts[band + 1] * width); i++) {
+			const u32 root = components.labels[i];
+			components.labels[i] = root == blocked ? 0 : final_labels[parent[root]];
+		}
+	});
+
+	return components;
+}
+
+/// The indices of the start locations (in pathing cells) that stand on a blocked cell or share their component with no other start location
+export std::vector<size_t> isolated_start_locations(const PathingComponents& components, const std::span<const glm::ivec2> start_locations) {
+	std::unordered_map<u32, size_t> per_component;
+	for (const auto& location : start_locations) {
+		per_component[components.label(location.x, location.y)] += 1;
+	}
+
+	std::vector<size_t> isolated;
+	for (size_t i = 0; i < start_locations.size(); i++) {
+		const u32 component = components.label(start_locations[i].x, start_locations[i].y);
+		if (component == 0 || (start_locations.size() > 1 && per_component[component] == 1)) {
+			isolated.push_back(i);
+		}
+	}
+	return isolated;
+}
\ No newline at end of file
@@ -1,3 +1,7 @@
+module;
+
+#include <QSettings>
+
 export module WorldUndoManager;
 
 import std;
@@ -22,21 +26,75 @@ export class WorldCommand {
 	virtual void undo(WorldEditContext& ctx) = 0;
 	virtual void redo(WorldEditContext& ctx) = 0;
 
+	/// Approximately the bytes the command keeps alive, for the memory budget of the history
+	virtual size_t memory_size() const = 0;
+
+	/// Called when the command enters the history, to drop what can be rebuilt when the command is undone or redone
+	virtual void compact() {}
+
+	/// Called once the command is no longer in one of the most recent groups, trading undo speed for memory
+	virtual void compress() {}
+
 	virtual ~WorldCommand() = default;
 };
 
 export class WorldUndoManager {
-	std::vector<std::vector<std::unique_ptr<WorldCommand>>> undo_actions;
-	std::vector<std::vector<std::unique_ptr<WorldCommand>>> redo_actions;
+	struct CommandGroup {
+		std::vector<std::unique_ptr<WorldCommand>> commands;
+		size_t bytes = 0;
+		bool compressed = false;
+	};
+
+	/// The most recent groups are kept as they are so that undoing a few steps stays instant
+	static constexpr size_t uncompressed_groups = 8;
+
+	std::deque<CommandGroup> undo_actions;
+	std::vector<CommandGroup> redo_actions;
+	size_t history_bytes = 0;
+
+	/// Compresses the groups behind the most recent ones. Anything older was compressed earlier, so this stops at the first compressed group
+	void compress_old_groups() {
+		for (size_t i = undo_actions.size() - std::min(undo_actions.size(), uncompressed_groups); i-- > 0;) {
+			CommandGroup& group = undo_actions[i];
+			if (group.compressed) {
+				break;
+			}
+
+			history_bytes -= group.bytes;
+			group.bytes = 0;
+			for (const auto& command : group.commands) {
+				command->compress();
+				group.bytes += command->memory_size();
+			}
+			history_bytes += group.bytes;
+			group.compressed = true;
+		}
+	}
+
+	/// Drops the oldest groups until the history fits, the current group is always kept
+	void enforce_budget() {
+		while (history_bytes > memory_budget && undo_actions.size() > 1) {
+			history_bytes -= undo_actions.front().bytes;
+			undo_actions.pop_front();
+		}
+	}
 
   public:
+	/// In bytes, the oldest undo groups are dropped once the undo and redo history together take more. Set in the settings in MiB
+	size_t memory_budget;
+
+	WorldUndoManager() {
+		QSettings settings;
+		memory_budget = settings.value("undoMemoryBudget", 512).toULongLong() * 1024 * 1024;
+	}
+
 	void undo(WorldEditContext& ctx) {
 		if (undo_actions.empty()) {
 			return;
 		}
 
 		auto& actions = undo_actions.back();
-		for (const auto& i : actions) {
+		for (const auto& i : actions.commands) {
 			i->undo(ctx);
 		}
 
@@ -50,7 +108,7 @@ export class WorldUndoManager {
 		}
 
 		auto& actions = redo_actions.back();
-		for (const auto& i : actions) {
+		for (const auto& i : actions.commands) {
 			i->redo(ctx);
 		}
 
@@ -60,6 +118,7 @@ export class WorldUndoManager {
 
 	void new_undo_group() {
 		undo_actions.push_back({});
+		compress_old_groups();
 	}
 
 	void add_undo_action(std::unique_ptr<WorldCommand> action) {
@@ -67,10 +126,31 @@ export class WorldUndoManager {
 			return;
 		}
 
-		undo_actions.back().push_back(std::move(action));
+		action->compact();
+		const size_t bytes = action->memory_size();
+		undo_actions.back().commands.push_back(std::move(action));
+		undo_actions.back().bytes += bytes;
+		history_bytes += bytes;
+
+		for (const auto& i : redo_actions) {
+			history_bytes -= i.bytes;
+		}
 		redo_actions.clear();
+
+		enforce_budget();
 	};
-};
 
+	void set_memory_budget(const size_t bytes) {
+		memory_budget = bytes;
+		enforce_budget();
+	}
 
+	/// The bytes held by the undo and redo history
+	size_t memory_used() const {
+		return history_bytes;
+	}
 
+	size_t undo_groups() const {
+		return undo_actions.size();
+	}
+};
\ No newline at end of file
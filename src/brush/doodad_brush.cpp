@@ -27,7 +27,7 @@ DoodadBrush::DoodadBrush()
 	brush_offset = { 0.0f, 0.0f };
 
 	click_helper = resource_manager.load<SkinnedMesh>("Objects/InvalidObject/InvalidObject.mdx", "", std::nullopt);
-	click_helper_skeleton = SkeletalModelInstance(click_helper->model);
+	click_helper_skeleton = SkeletalModelInstance(click_helper->model, click_helper->topology);
 }
 
 /// Gets a random variation from the possible_variation list
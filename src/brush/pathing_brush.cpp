@@ -4,12 +4,25 @@
 
 import std;
 import <glm/glm.hpp>;
+import <glad/glad.h>;
 import MapGlobal;
 import PathingUndo;
+import UndoDelta;
+import Camera;
+import ResourceManager;
+import Terrain;
+import Timer;
 
 PathingBrush::PathingBrush() : Brush() {
 	brush_offset = {0.125f, 0.125f};
 	granularity = 4.f;
+
+	glCreateBuffers(1, &path_vertex_buffer);
+	path_shader = resource_manager.load<Shader>({ "data/shaders/physics_debug.vert", "data/shaders/physics_debug.frag" });
+}
+
+PathingBrush::~PathingBrush() {
+	glDeleteBuffers(1, &path_vertex_buffer);
 }
 
 void PathingBrush::apply_begin() {
@@ -58,6 +71,7 @@ void PathingBrush::apply(double frame_delta) {
 
 	applied_area = applied_area.united(area);
 
+	map->pathing_map.mark_static_dirty(area);
 	map->pathing_map.upload_static_pathing();
 }
 
@@ -71,21 +85,102 @@ void PathingBrush::add_pathing_undo(const QRect& area) {
 	undo_action->area = area;
 	const auto width = map->pathing_map.width;
 
-	// Copy old corners
-	undo_action->old_pathing.reserve(area.width() * area.height());
+	std::vector<uint8_t> before;
+	std::vector<uint8_t> after;
+	before.reserve(area.width() * area.height());
+	after.reserve(area.width() * area.height());
 	for (int j = area.top(); j <= area.bottom(); j++) {
 		for (int i = area.left(); i <= area.right(); i++) {
-			undo_action->old_pathing.push_back(old_pathing_cells_static[j * width + i]);
+			before.push_back(old_pathing_cells_static[j * width + i]);
+			after.push_back(map->pathing_map.pathing_cells_static[j * width + i]);
 		}
 	}
+	undo_action->cells = ByteDelta::between<uint8_t>(before, after);
 
-	// Copy new corners
-	undo_action->new_pathing.reserve(area.width() * area.height());
-	for (int j = area.top(); j <= area.bottom(); j++) {
-		for (int i = area.left(); i <= area.right(); i++) {
-			undo_action->new_pathing.push_back(map->pathing_map.pathing_cells_static[j * width + i]);
+	map->world_undo.add_undo_action(std::move(undo_action));
+}
+
+void PathingBrush::mouse_move_event(QMouseEvent* event, double frame_delta) {
+	if (path_preview) {
+		set_position(input_handler.mouse_world);
+		return;
+	}
+	Brush::mouse_move_event(event, frame_delta);
+}
+
+void PathingBrush::mouse_press_event(QMouseEvent* event, double frame_delta) {
+	if (!path_preview || event->button() != Qt::LeftButton) {
+		Brush::mouse_press_event(event, frame_delta);
+		return;
+	}
+
+	const glm::ivec2 cell = glm::floor(glm::vec2(input_handler.mouse_world) * 4.f);
+	// A third click starts a new path
+	if (!path_start || path_goal) {
+		path_start = cell;
+		path_goal.reset();
+	} else {
+		path_goal = cell;
+	}
+	update_path();
+}
+
+void PathingBrush::mouse_release_event(QMouseEvent* event) {
+	if (path_preview) {
+		return;
+	}
+	Brush::mouse_release_event(event);
+}
+
+void PathingBrush::update_path() {
+	path.reset();
+	path_vertex_count = 0;
+
+	if (path_start && path_goal) {
+		Timer timer;
+		path = map->find_ground_path(*path_start, *path_goal, path_footprint);
+		const double elapsed = timer.elapsed_ms();
+
+		if (path) {
+			std::println("Path of {:.1f} cells ({:.0f} world units) found in {:.2f}ms", path->length, path->length * 32.f, elapsed);
+
+			// Through the cell centers, slightly above the ground so the line isn't hidden by it
+			std::vector<glm::vec3> vertices;
+			vertices.reserve(path->cells.size());
+			for (const auto& cell : path->cells) {
+				const glm::vec2 position = (glm::vec2(cell) + 0.5f) / 4.f;
+				vertices.push_back({ position, map->terrain.interpolated_height(position.x, position.y, false) + 0.05f });
+			}
+			glNamedBufferData(path_vertex_buffer, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_DYNAMIC_DRAW);
+			path_vertex_count = static_cast<GLsizei>(vertices.size());
+		} else {
+			std::println("No path for footprint {} found in {:.2f}ms", path_footprint, elapsed);
 		}
 	}
 
-	map->world_undo.add_undo_action(std::move(undo_action));
+	emit path_changed();
+}
+
+void PathingBrush::clear_path() {
+	path_start.reset();
+	path_goal.reset();
+	update_path();
+}
+
+void PathingBrush::render_selection() const {
+	if (path_vertex_count == 0) {
+		return;
+	}
+
+	glDisable(GL_DEPTH_TEST);
+	path_shader->use();
+	glUniformMatrix4fv(1, 1, GL_FALSE, &camera.projection_view[0][0]);
+
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, path_vertex_buffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+	glDrawArrays(GL_LINE_STRIP, 0, path_vertex_count);
+
+	glDisableVertexAttribArray(0);
+	glEnable(GL_DEPTH_TEST);
 }
\ No newline at end of file
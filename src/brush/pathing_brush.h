@@ -3,11 +3,16 @@
 #include <QRect>
 
 #include <cstdint>
+#include <optional>
 #include <vector>
 
 #include "brush.h"
 
+import Pathfinding;
+
 class PathingBrush : public Brush {
+	Q_OBJECT
+
 public:
 	enum class Operation {
 		replace,
@@ -21,7 +26,13 @@ public:
 
 	QRect applied_area;
 
+	// While previewing, left clicks pick the start and the goal of a ground path instead of painting
+	bool path_preview = false;
+	int path_footprint = 1;
+	std::optional<GridPath> path;
+
 	PathingBrush();
+	~PathingBrush();
 
 	void apply_begin() override;
 	void apply(double frame_delta) override;
@@ -29,6 +40,29 @@ public:
 
 	void add_pathing_undo(const QRect& area);
 
+	void mouse_move_event(QMouseEvent* event, double frame_delta) override;
+	void mouse_press_event(QMouseEvent* event, double frame_delta) override;
+	void mouse_release_event(QMouseEvent* event) override;
+	void render_selection() const override;
+
+	/// Searches the path again, for when the footprint or the pathing changed
+	void update_path();
+	void clear_path();
+
+	/// Whether both the start and the goal have been picked
+	bool path_searched() const {
+		return path_start && path_goal;
+	}
+
 private:
 	std::vector<uint8_t> old_pathing_cells_static;
+
+	std::optional<glm::ivec2> path_start;
+	std::optional<glm::ivec2> path_goal;
+	GLuint path_vertex_buffer;
+	GLsizei path_vertex_count = 0;
+	std::shared_ptr<Shader> path_shader;
+
+signals:
+	void path_changed();
 };
\ No newline at end of file
@@ -5,6 +5,7 @@ import MapGlobal;
 import Terrain;
 import DoodadsUndo;
 import PathingUndo;
+import UndoDelta;
 import TerrainUndo;
 
 TerrainBrush::TerrainBrush() : Brush() {
@@ -422,8 +423,11 @@ void TerrainBrush::apply(double frame_delta) {
 		}
 	}
 
+	map->pathing_map.mark_static_dirty(QRect(updated_area.x() * 4, updated_area.y() * 4, updated_area.width() * 4, updated_area.height() * 4));
 	map->pathing_map.upload_static_pathing();
 
+	map->terrain.update_minimap(area.united(updated_area));
+
 	if (apply_height || apply_cliff) {
 		if (change_doodad_heights) {
 			for (auto&& i : map->doodads.doodads) {
@@ -468,8 +472,6 @@ void TerrainBrush::apply_end() {
 
 	QRect pathing_area = QRect(cliff_area.x() * 4, cliff_area.y() * 4, cliff_area.width() * 4, cliff_area.height() * 4).adjusted(-2, -2, 2, 2).intersected({ 0, 0, map->pathing_map.width, map->pathing_map.height });
 	add_pathing_undo(pathing_area);
-
-	map->terrain.update_minimap();
 }
 
 int TerrainBrush::get_random_variation() const {
@@ -496,21 +498,17 @@ void TerrainBrush::add_terrain_undo(const QRect& area, TerrainUndoType type) {
 	undo_action->area = area;
 	undo_action->undo_type = type;
 
-	// Copy old corners
-	undo_action->old_corners.reserve(area.width() * area.height());
-	for (int j = area.top(); j <= area.bottom(); j++) {
-		for (int i = area.left(); i <= area.right(); i++) {
-			undo_action->old_corners.push_back(old_corners[i][j]);
-		}
-	}
-
-	// Copy new corners
-	undo_action->new_corners.reserve(area.width() * area.height());
+	std::vector<Corner> before;
+	std::vector<Corner> after;
+	before.reserve(area.width() * area.height());
+	after.reserve(area.width() * area.height());
 	for (int j = area.top(); j <= area.bottom(); j++) {
 		for (int i = area.left(); i <= area.right(); i++) {
-			undo_action->new_corners.push_back(map->terrain.corners[i][j]);
+			before.push_back(old_corners[i][j]);
+			after.push_back(map->terrain.corners[i][j]);
 		}
 	}
+	undo_action->corners = ByteDelta::between<Corner>(before, after);
 
 	map->world_undo.add_undo_action(std::move(undo_action));
 }
@@ -521,21 +519,17 @@ void TerrainBrush::add_pathing_undo(const QRect& area) {
 	undo_action->area = area;
 	const auto width = map->pathing_map.width;
 
-	// Copy old corners
-	undo_action->old_pathing.reserve(area.width() * area.height());
-	for (int j = area.top(); j <= area.bottom(); j++) {
-		for (int i = area.left(); i <= area.right(); i++) {
-			undo_action->old_pathing.push_back(old_pathing_cells_static[j * width + i]);
-		}
-	}
-
-	// Copy new corners
-	undo_action->new_pathing.reserve(area.width() * area.height());
+	std::vector<uint8_t> before;
+	std::vector<uint8_t> after;
+	before.reserve(area.width() * area.height());
+	after.reserve(area.width() * area.height());
 	for (int j = area.top(); j <= area.bottom(); j++) {
 		for (int i = area.left(); i <= area.right(); i++) {
-			undo_action->new_pathing.push_back(map->pathing_map.pathing_cells_static[j * width + i]);
+			before.push_back(old_pathing_cells_static[j * width + i]);
+			after.push_back(map->pathing_map.pathing_cells_static[j * width + i]);
 		}
 	}
+	undo_action->cells = ByteDelta::between<uint8_t>(before, after);
 
 	map->world_undo.add_undo_action(std::move(undo_action));
 }
\ No newline at end of file
@@ -7,6 +7,9 @@ import std;
 import OpenGLUtilities;
 import Camera;
 import MapGlobal;
+import SkeletalModelInstance;
+import FrameArena;
+import Profiler;
 import <glad/glad.h>;
 
 void APIENTRY gl_debug_output(const GLenum source, const GLenum type, const GLuint id, const GLenum severity, const GLsizei, const GLchar *message, void *) {
@@ -116,7 +119,17 @@ void GLWidget::paintGL() {
 		return;
 	}
 
-	map->update(delta, width(), height());
+	// Time between frames in milliseconds
+	static RollingSamples frame_times;
+
+	profiler.enabled = map->render_debug;
+	profiler.begin_frame();
+	ProfileScope frame_scope("frame");
+
+	{
+		ProfileScope scope("Map::update");
+		map->update(delta, width(), height());
+	}
 
 	//glEnable(GL_FRAMEBUFFER_SRGB);
 	glEnable(GL_DEPTH_TEST);
@@ -125,23 +138,48 @@ void GLWidget::paintGL() {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	glBindVertexArray(vao);
-	map->render();
+	{
+		ProfileScope scope("Map::render");
+		map->render();
+	}
 
 	glBindVertexArray(0);
 
 	if (map->render_debug) {
+		ProfileScope scope("UI");
+
 		QPainter p(this);
 		p.setPen(QColor(Qt::GlobalColor::white));
 		p.setFont(QFont("Arial", 10, 100, false));
 
 		// Rendering time
-		static std::vector<double> frametimes;
-		frametimes.push_back(delta);
-		if (frametimes.size() > 60) {
-			frametimes.erase(frametimes.begin());
+		const auto frame_time = frame_times.percentiles();
+		p.drawText(10, 20, QString::fromStdString(std::format("Total time: {:.2f}ms p50, {:.2f}ms p95, {:.2f}ms p99", frame_time[0], frame_time[1], frame_time[2])));
+		p.drawText(10, 35, QString::fromStdString(std::format("Skeletal evaluations: {}", SkeletalModelInstance::skeletal_evaluations.load())));
+		p.drawText(10, 50, QString::fromStdString(std::format("Opaque draws: {} commands in {} calls", map->render_manager.opaque_draws.commands.size(), map->render_manager.opaque_draw_calls)));
+		p.drawText(10, 65, QString::fromStdString(std::format("Transparent draws: {} instances in {} runs, {} blended calls", map->render_manager.transparent_instance_ids.size(), map->render_manager.transparent_runs.size(), map->render_manager.blended_draw_calls)));
+		p.drawText(10, 80, QString::fromStdString(std::format("Frame arena: {} KiB used, {} KiB peak", frame_arena().used / 1024, frame_arena().peak / 1024)));
+		p.drawText(10, 95, QString::fromStdString(std::format("Undo history: {} KiB in {} groups, {} MiB budget", map->world_undo.memory_used() / 1024, map->world_undo.undo_groups(), map->world_undo.memory_budget / 1024 / 1024)));
+
+		// Profiler scopes and counters, p50/p95/p99 over the last frames. F12 writes them to profile.json
+		int y = 110;
+		p.drawText(10, y, "Scope (ms)                       CPU p50 / p95 / p99         GPU p50 / p95 / p99");
+		for (const auto i : profiler.scope_order()) {
+			const Profiler::Scope& profile_scope = profiler.scopes[i];
+			const auto cpu = profile_scope.cpu.percentiles();
+			y += 15;
+			p.drawText(10 + profile_scope.depth * 10, y, QString::fromStdString(std::string(profile_scope.name)));
+			p.drawText(200, y, QString::fromStdString(std::format("{:.2f} / {:.2f} / {:.2f}", cpu[0], cpu[1], cpu[2])));
+			if (profile_scope.gpu.size()) {
+				const auto gpu = profile_scope.gpu.percentiles();
+				p.drawText(350, y, QString::fromStdString(std::format("{:.2f} / {:.2f} / {:.2f}", gpu[0], gpu[1], gpu[2])));
+			}
+		}
+		for (const auto& counter : profiler.counters) {
+			const auto values = counter.values.percentiles();
+			y += 15;
+			p.drawText(10, y, QString::fromStdString(std::format("{}: {:.0f} ({:.0f} / {:.0f} / {:.0f})", counter.name, counter.values.last(), values[0], values[1], values[2])));
 		}
-		float average_frametime = std::accumulate(frametimes.begin(), frametimes.end(), 0.f) / frametimes.size();
-		p.drawText(10, 20, QString::fromStdString(std::format("Total time: {:.2f}ms", average_frametime * 1000.0)));
 
 		// General info
 		p.drawText(300, 20, QString::fromStdString(std::format("Mouse World Position X:{:.4f} Y:{:.4f} Z:{:.4f}", input_handler.mouse_world.x, input_handler.mouse_world.y, input_handler.mouse_world.z)));
@@ -161,6 +199,18 @@ void GLWidget::paintGL() {
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	}
+
+	frame_scope.end();
+
+	if (profiler.enabled) {
+		const auto& render_manager = map->render_manager;
+		frame_times.push(static_cast<float>(delta * 1000.0));
+		profiler.count("draw calls", render_manager.opaque_draw_calls + render_manager.blended_draw_calls + render_manager.transparent_draw_calls);
+		profiler.count("instances", render_manager.rendered_instances);
+		profiler.count("skeletal evaluations", SkeletalModelInstance::skeletal_evaluations.load());
+		profiler.count("bytes uploaded", render_manager.uploaded_bytes);
+	}
+	profiler.end_frame();
 }
 
 void GLWidget::keyPressEvent(QKeyEvent* event) {
@@ -170,6 +220,12 @@ void GLWidget::keyPressEvent(QKeyEvent* event) {
 
 	input_handler.keys_pressed.emplace(event->key());
 
+	if (event->key() == Qt::Key_F12 && profiler.frames > 0) {
+		if (profiler.dump_json("profile.json")) {
+			std::println("Wrote profile of the last {} frames to profile.json", std::min(profiler.frames, size_t(240)));
+		}
+	}
+
 	if (map->brush) {
 		map->brush->key_press_event(event);
 	}
@@ -105,9 +105,17 @@ HiveWE::HiveWE(QWidget* parent)
 	connect(ui.ribbon->units_visible, &QPushButton::toggled, [](bool checked) { map->render_units = checked; });
 	connect(ui.ribbon->doodads_visible, &QPushButton::toggled, [](bool checked) { map->render_doodads = checked; });
 	connect(ui.ribbon->pathing_visible, &QPushButton::toggled, [](bool checked) { map->render_pathing = checked; });
+	connect(ui.ribbon->walkability_visible, &QPushButton::toggled, [this](bool checked) {
+		if (checked) {
+			ui.widget->makeCurrent();
+			map->analyze_walkability();
+		}
+		map->render_walkability = checked;
+	});
 	connect(ui.ribbon->brush_visible, &QPushButton::toggled, [](bool checked) { map->render_brush = checked; });
 	connect(ui.ribbon->lighting_visible, &QPushButton::toggled, [](bool checked) { map->render_lighting = checked; });
 	connect(ui.ribbon->wireframe_visible, &QPushButton::toggled, [](bool checked) { map->render_wireframe = checked; });
+	connect(ui.ribbon->weighted_transparency, &QPushButton::toggled, [](bool checked) { map->render_weighted_transparency = checked; });
 	connect(ui.ribbon->debug_visible, &QPushButton::toggled, [](bool checked) { map->render_debug = checked; });
 	connect(ui.ribbon->minimap_visible, &QPushButton::toggled, [&](bool checked) { (checked) ? minimap->show() : minimap->hide(); });
 
@@ -70,6 +70,11 @@ MainRibbon::MainRibbon(QWidget* parent) : QRibbon(parent) {
 	pathing_visible->setText("Pathing");
 	pathing_visible->setCheckable(true);
 	visible_section->addWidget(pathing_visible);
+
+	walkability_visible->setIcon(QIcon("data/icons/ribbon/pathing32x32.png"));
+	walkability_visible->setText("Walkable\nRegions");
+	walkability_visible->setCheckable(true);
+	visible_section->addWidget(walkability_visible);
 	
 	brush_visible->setIcon(QIcon("data/icons/ribbon/brush32x32.png"));
 	brush_visible->setText("Brush");
@@ -88,6 +93,11 @@ MainRibbon::MainRibbon(QWidget* parent) : QRibbon(parent) {
 	wireframe_visible->setCheckable(true);
 	visible_section->addWidget(wireframe_visible);
 
+	weighted_transparency->setIcon(QIcon("data/icons/ribbon/doodads32x32.png"));
+	weighted_transparency->setText("Fast\nTransparency");
+	weighted_transparency->setCheckable(true);
+	visible_section->addWidget(weighted_transparency);
+
 	debug_visible->setIcon(QIcon("data/icons/ribbon/debug32x32.png"));
 	debug_visible->setText("Debug");
 	debug_visible->setCheckable(true);
@@ -20,9 +20,11 @@ public:
 	QRibbonButton* units_visible = new QRibbonButton;
 	QRibbonButton* doodads_visible = new QRibbonButton;
 	QRibbonButton* pathing_visible = new QRibbonButton;
+	QRibbonButton* walkability_visible = new QRibbonButton;
 	QRibbonButton* brush_visible = new QRibbonButton;
 	QRibbonButton* lighting_visible = new QRibbonButton;
 	QRibbonButton* wireframe_visible = new QRibbonButton;
+	QRibbonButton* weighted_transparency = new QRibbonButton;
 	QRibbonButton* debug_visible = new QRibbonButton;
 	QRibbonButton* minimap_visible = new QRibbonButton;
 
@@ -1,6 +1,7 @@
 #include "minimap.h"
 
 #include <QMouseEvent>
+#include <QPainter>
 
 import std;
 
@@ -9,9 +10,16 @@ Minimap::Minimap(QWidget *parent) : QWidget(parent) {
 	show();
 }
 
-void Minimap::set_minimap(Texture texture) {
-	QImage temp_image = QImage(texture.data.data(), texture.width, texture.height, texture.width * texture.channels, QImage::Format::Format_RGBA8888);
-	ui.image->setPixmap(QPixmap::fromImage(temp_image));
+void Minimap::set_minimap(const Texture& texture, QRect area) {
+	const QImage image = QImage(texture.data.data(), texture.width, texture.height, texture.width * texture.channels, QImage::Format::Format_RGBA8888);
+	if (pixmap.size() != image.size()) {
+		pixmap = QPixmap::fromImage(image);
+	} else {
+		QPainter painter(&pixmap);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.drawImage(area.topLeft(), image, area);
+	}
+	ui.image->setPixmap(pixmap);
 }
 
 int x_offset;
@@ -11,13 +11,15 @@ public:
 	Minimap(QWidget* parent = nullptr);
 
 public slots:
-	void set_minimap(Texture texture);
+	/// Only area (in image coordinates) is copied into the shown minimap, unless the size changed
+	void set_minimap(const Texture& texture, QRect area);
 
 signals:
 	/// point contains the location clicked on the minimap in the range [0..1]
 	void clicked(QPointF point);
 private:
 	Ui::Minimap ui;
+	QPixmap pixmap;
 
 	void mousePressEvent(QMouseEvent* event) override;
 	void mouseReleaseEvent(QMouseEvent* event) override;
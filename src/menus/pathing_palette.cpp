@@ -2,7 +2,10 @@
 
 #include <QDialog>
 
+import std;
 import MapGlobal;
+import Globals;
+import Pathfinding;
 
 PathingPalette::PathingPalette(QWidget *parent) : Palette(parent) {
 	ui.setupUi(this);
@@ -40,6 +43,45 @@ PathingPalette::PathingPalette(QWidget *parent) : Palette(parent) {
 	connect(ui.brushShapeCircle, &QPushButton::clicked, [&]() { brush.set_shape(Brush::Shape::circle); });
 	connect(ui.brushShapeSquare, &QPushButton::clicked, [&]() { brush.set_shape(Brush::Shape::square); });
 	connect(ui.brushShapeDiamond, &QPushButton::clicked, [&]() { brush.set_shape(Brush::Shape::diamond); });
+
+	// One ground unit per footprint, units that share a footprint take the same paths
+	std::map<int, std::pair<std::string, float>> footprints;
+	for (size_t i = 0; i < units_slk.rows(); i++) {
+		const std::string& id = units_slk.index_to_row.at(i);
+		const std::string move_type = units_slk.data("movetp", id);
+		if (move_type.empty() || move_type == "fly") {
+			continue;
+		}
+		const float collision = units_slk.data<float>("collision", id);
+		footprints.try_emplace(pathing_footprint(collision), units_slk.data("name", id), collision);
+	}
+	for (const auto& [footprint, unit] : footprints) {
+		const auto& [name, collision] = unit;
+		ui.pathUnitSize->addItem(QString::fromStdString(std::format("{} ({} collision, {} cells)", name, collision, footprint)), footprint);
+	}
+
+	connect(ui.pathPreview, &QPushButton::toggled, [&](bool checked) {
+		brush.path_preview = checked;
+		if (!checked) {
+			brush.clear_path();
+		}
+	});
+
+	connect(ui.pathUnitSize, QOverload<int>::of(&QComboBox::currentIndexChanged), [&](int index) {
+		brush.path_footprint = ui.pathUnitSize->itemData(index).toInt();
+		brush.update_path();
+	});
+	if (ui.pathUnitSize->count() > 0) {
+		brush.path_footprint = ui.pathUnitSize->currentData().toInt();
+	}
+
+	connect(&brush, &PathingBrush::path_changed, [&]() {
+		if (brush.path) {
+			ui.pathLength->setText(QString::fromStdString(std::format("{:.1f} cells, {:.0f} world units", brush.path->length, brush.path->length * 32.f)));
+		} else {
+			ui.pathLength->setText(brush.path_searched() ? "No path" : "");
+		}
+	});
 }
 
 PathingPalette::~PathingPalette() {
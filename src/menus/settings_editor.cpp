@@ -4,6 +4,7 @@
 #include <QFile>
 
 import std;
+import MapGlobal;
 
 void setTestArgs(Ui::SettingsEditor &ui) {
 	ui.testArgs->setText(ui.userArgs->text() + " -mapdiff " + QString::fromStdString(std::string("") + char(ui.diff->currentIndex() + '0')) +
@@ -25,6 +26,8 @@ SettingsEditor::SettingsEditor(QWidget* parent)
 	ui.flavour->setCurrentText(settings.value("flavour").toString());
 	ui.hd->setChecked(settings.value("hd", "True").toString() != "False");
 	ui.teen->setChecked(settings.value("teen", "False").toString() != "False");
+	ui.undoMemoryBudget->setValue(settings.value("undoMemoryBudget", 512).toInt());
+	ui.packPreplacedObjects->setChecked(settings.value("packPreplacedObjects", "False").toString() != "False");
 
 	ui.userArgs->setText(settings.value("userArgs", "").toString());
 	ui.diff->setCurrentText(settings.value("diff", "Normal").toString());
@@ -72,6 +75,11 @@ void SettingsEditor::save() const {
 	settings.setValue("comments", ui.comments->isChecked() ? "True" : "False");
 	settings.setValue("hd", ui.hd->isChecked() ? "True" : "False");
 	settings.setValue("teen", ui.teen->isChecked() ? "True" : "False");
+	settings.setValue("undoMemoryBudget", ui.undoMemoryBudget->value());
+	if (map) {
+		map->world_undo.set_memory_budget(static_cast<size_t>(ui.undoMemoryBudget->value()) * 1024 * 1024);
+	}
+	settings.setValue("packPreplacedObjects", ui.packPreplacedObjects->isChecked() ? "True" : "False");
 	settings.setValue("userArgs", ui.userArgs->text());
 	settings.setValue("diff", ui.diff->currentText());
 	settings.setValue("windowmode", ui.windowmode->currentText());
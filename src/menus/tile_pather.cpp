@@ -142,7 +142,8 @@ void TilePather::save_tiles() {
 		}
 	}
 
-	glTextureSubImage2D(map->pathing_map.texture_static, 0, 0, 0, map->pathing_map.width, map->pathing_map.height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, map->pathing_map.pathing_cells_static.data());
+	map->pathing_map.mark_static_dirty(QRect(0, 0, map->pathing_map.width, map->pathing_map.height));
+	map->pathing_map.upload_static_pathing();
 
 	close();
 }
\ No newline at end of file
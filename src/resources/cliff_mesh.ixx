@@ -16,13 +16,11 @@ export class CliffMesh : public Resource {
 	GLuint uv_buffer;
 	GLuint normal_buffer;
 	GLuint index_buffer;
-	GLuint instance_buffer;
+	GLuint vao;
 	size_t indices;
 
 	static constexpr const char* name = "CliffMesh";
 
-	std::vector<glm::vec4> render_jobs;
-
 	explicit CliffMesh(const fs::path& path) {
 		if (path.extension() == ".mdx" || path.extension() == ".MDX") {
 			auto reader = hierarchy.open_file(path).value();
@@ -39,11 +37,29 @@ export class CliffMesh : public Resource {
 			glCreateBuffers(1, &normal_buffer);
 			glNamedBufferData(normal_buffer, static_cast<int>(set.normals.size() * sizeof(glm::vec3)), set.normals.data(), GL_STATIC_DRAW);
 
-			glCreateBuffers(1, &instance_buffer);
-
 			indices = set.faces.size();
 			glCreateBuffers(1, &index_buffer);
 			glNamedBufferData(index_buffer, static_cast<int>(set.faces.size() * sizeof(uint16_t)), set.faces.data(), GL_STATIC_DRAW);
+
+			glCreateVertexArrays(1, &vao);
+			glVertexArrayVertexBuffer(vao, 0, vertex_buffer, 0, sizeof(glm::vec3));
+			glVertexArrayVertexBuffer(vao, 1, uv_buffer, 0, sizeof(glm::vec2));
+			glVertexArrayVertexBuffer(vao, 2, normal_buffer, 0, sizeof(glm::vec3));
+			glVertexArrayElementBuffer(vao, index_buffer);
+
+			glEnableVertexArrayAttrib(vao, 0);
+			glEnableVertexArrayAttrib(vao, 1);
+			glEnableVertexArrayAttrib(vao, 2);
+			glEnableVertexArrayAttrib(vao, 3);
+			glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+			glVertexArrayAttribFormat(vao, 1, 2, GL_FLOAT, GL_FALSE, 0);
+			glVertexArrayAttribFormat(vao, 2, 3, GL_FLOAT, GL_FALSE, 0);
+			glVertexArrayAttribFormat(vao, 3, 4, GL_FLOAT, GL_FALSE, 0);
+			for (GLuint i = 0; i < 4; i++) {
+				glVertexArrayAttribBinding(vao, i, i);
+			}
+			// The instance buffer is bound to binding 3 at draw time
+			glVertexArrayBindingDivisor(vao, 3, 1);
 		}
 	}
 
@@ -51,47 +67,14 @@ export class CliffMesh : public Resource {
 		glDeleteBuffers(1, &vertex_buffer);
 		glDeleteBuffers(1, &uv_buffer);
 		glDeleteBuffers(1, &normal_buffer);
-		glDeleteBuffers(1, &instance_buffer);
 		glDeleteBuffers(1, &index_buffer);
+		glDeleteVertexArrays(1, &vao);
 	}
 
-	void render_queue(const glm::vec4 position) {
-		render_jobs.push_back(position);
-	}
-
-	void render() {
-		if (render_jobs.empty()) {
-			return;
-		}
-
-		glNamedBufferData(instance_buffer, static_cast<int>(render_jobs.size() * sizeof(glm::vec4)), render_jobs.data(), GL_STATIC_DRAW);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uv_buffer);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normal_buffer);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-		glEnableVertexAttribArray(3);
-		glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
-		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
-		glVertexAttribDivisor(3, 1);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
-		glDrawElementsInstanced(GL_TRIANGLES, indices, GL_UNSIGNED_SHORT, nullptr, static_cast<int>(render_jobs.size()));
-
-		glVertexAttribDivisor(3, 0); // ToDo use vao
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
-		glDisableVertexAttribArray(3);
-
-		render_jobs.clear();
+	/// Draws count instances whose vec4 (x, y, z offset, texture index) instance data starts at first in instance_buffer
+	void render(const GLuint instance_buffer, const size_t first, const size_t count) const {
+		glBindVertexArray(vao);
+		glVertexArrayVertexBuffer(vao, 3, instance_buffer, first * sizeof(glm::vec4), sizeof(glm::vec4));
+		glDrawElementsInstanced(GL_TRIANGLES, indices, GL_UNSIGNED_SHORT, nullptr, static_cast<int>(count));
 	}
 };
\ No newline at end of file
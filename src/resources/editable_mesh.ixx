@@ -221,8 +221,7 @@ export class EditableMesh : public Resource {
 			} else {
 				textures.push_back(resource_manager.load<GPUTexture>(texture.file_name, std::to_string(texture.flags)));
 			}
-			glTextureParameteri(textures.back()->id, GL_TEXTURE_WRAP_S, texture.flags & 1 ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-			glTextureParameteri(textures.back()->id, GL_TEXTURE_WRAP_T, texture.flags & 2 ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+			textures.back()->set_wrap(texture.flags & 1, texture.flags & 2);
 		}
 
 		glEnableVertexArrayAttrib(vao, 0);
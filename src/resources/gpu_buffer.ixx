@@ -0,0 +1,314 @@
+export module GPUBuffer;
+
+import std;
+import <glad/glad.h>;
+
+/// The GL calls used by the buffers in this module.
+/// The buffers take the backend as a template parameter so their bookkeeping can be exercised with a fake backend without a GL context
+export struct OpenGLBufferBackend {
+	static GLuint create() {
+		GLuint buffer;
+		glCreateBuffers(1, &buffer);
+		return buffer;
+	}
+
+	static void destroy(const GLuint buffer) {
+		glDeleteBuffers(1, &buffer);
+	}
+
+	static void allocate(const GLuint buffer, const size_t size) {
+		glNamedBufferData(buffer, size, nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	static void write(const GLuint buffer, const size_t offset, const size_t size, const void* data) {
+		glNamedBufferSubData(buffer, offset, size, data);
+	}
+
+	/// Allocates immutable storage and maps it for the lifetime of the buffer
+	static void* allocate_persistent(const GLuint buffer, const size_t size) {
+		constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glNamedBufferStorage(buffer, size, nullptr, flags);
+		return glMapNamedBufferRange(buffer, 0, size, flags);
+	}
+
+	static GLsync fence() {
+		return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	static void wait(const GLsync fence) {
+		// Only flush on the first try, after that the fence is guaranteed to be in the command stream
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (true) {
+			const GLenum result = glClientWaitSync(fence, flags, 1'000'000);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) {
+				return;
+			}
+			flags = 0;
+		}
+	}
+
+	static void delete_fence(const GLsync fence) {
+		glDeleteSync(fence);
+	}
+
+	static size_t storage_offset_alignment() {
+		GLint alignment;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		return alignment;
+	}
+};
+
+/// First fit allocator for ranges inside a buffer. Only does the bookkeeping, the caller owns the storage
+export class RangeAllocator {
+	// offset -> size
+	std::map<size_t, size_t> free_ranges;
+
+  public:
+	size_t capacity = 0;
+
+	/// Returns nothing if there is no free range large enough, grow() and try again
+	std::optional<size_t> allocate(const size_t size) {
+		if (size == 0) {
+			return 0;
+		}
+
+		for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+			auto [offset, free_size] = *it;
+			if (free_size < size) {
+				continue;
+			}
+
+			free_ranges.erase(it);
+			if (free_size > size) {
+				free_ranges.emplace(offset + size, free_size - size);
+			}
+			return offset;
+		}
+		return std::nullopt;
+	}
+
+	void free(const size_t offset, const size_t size) {
+		if (size == 0) {
+			return;
+		}
+
+		auto [it, inserted] = free_ranges.emplace(offset, size);
+
+		// Merge with the next range
+		if (const auto next = std::next(it); next != free_ranges.end() && it->first + it->second == next->first) {
+			it->second += next->second;
+			free_ranges.erase(next);
+		}
+
+		// Merge with the previous range
+		if (it != free_ranges.begin()) {
+			if (const auto previous = std::prev(it); previous->first + previous->second == it->first) {
+				previous->second += it->second;
+				free_ranges.erase(it);
+			}
+		}
+	}
+
+	/// Adds the space between the old and new capacity as a free range
+	void grow(const size_t new_capacity) {
+		if (new_capacity <= capacity) {
+			return;
+		}
+		const size_t old_capacity = capacity;
+		capacity = new_capacity;
+		free(old_capacity, new_capacity - old_capacity);
+	}
+};
+
+/// A buffer whose contents are produced on the GPU (or fully rewritten), only reallocated when it has to grow.
+/// Grows geometrically so a slowly increasing size doesn't reallocate every frame
+export template <typename Backend = OpenGLBufferBackend>
+class GrowableBuffer {
+  public:
+	GLuint buffer = 0;
+	size_t capacity = 0;
+
+	GrowableBuffer() = default;
+	GrowableBuffer(const GrowableBuffer&) = delete;
+	GrowableBuffer& operator=(const GrowableBuffer&) = delete;
+
+	~GrowableBuffer() {
+		if (buffer) {
+			Backend::destroy(buffer);
+		}
+	}
+
+	/// Makes sure the buffer can hold at least size bytes. Returns whether it was (re)allocated, in which case the old contents are lost
+	bool reserve(const size_t size) {
+		if (buffer == 0) {
+			buffer = Backend::create();
+		}
+
+		if (size <= capacity && capacity != 0) {
+			return false;
+		}
+
+		capacity = std::max({ size, capacity + capacity / 2, size_t(256) });
+		Backend::allocate(buffer, capacity);
+		return true;
+	}
+};
+
+/// Keeps a CPU copy of what was last uploaded and only rewrites the range that changed.
+/// For data that is mostly static between frames, like the instance matrices of doodads that are not being edited
+export template <typename T, typename Backend = OpenGLBufferBackend>
+class RetainedBuffer {
+	GrowableBuffer<Backend> storage;
+	std::vector<T> uploaded;
+
+	static bool equal(const T& left, const T& right) {
+		return std::memcmp(&left, &right, sizeof(T)) == 0;
+	}
+
+  public:
+	GLuint buffer() const {
+		return storage.buffer;
+	}
+
+	/// Returns the amount of bytes that had to be written
+	size_t upload(const std::span<const T> data) {
+		if (storage.reserve(data.size_bytes())) {
+			uploaded.clear();
+		}
+
+		// Find the first and last element that differ from the previous upload
+		const size_t common = std::min(uploaded.size(), data.size());
+		size_t first = 0;
+		while (first < common && equal(data[first], uploaded[first])) {
+			first += 1;
+		}
+
+		size_t last = data.size();
+		if (uploaded.size() == data.size()) {
+			while (last > first && equal(data[last - 1], uploaded[last - 1])) {
+				last -= 1;
+			}
+		}
+
+		if (first < last) {
+			Backend::write(storage.buffer, first * sizeof(T), (last - first) * sizeof(T), data.data() + first);
+		}
+
+		uploaded.assign(data.begin(), data.end());
+		return (last - first) * sizeof(T);
+	}
+};
+
+/// A persistently mapped buffer for data that changes every frame, like bone matrices.
+/// The buffer is split in frames_in_flight regions which are fenced after use, so the CPU never overwrites data the GPU is still reading.
+/// Writes return a range that has to be bound with glBindBufferRange
+export template <typename Backend = OpenGLBufferBackend>
+class StreamBuffer {
+  public:
+	static constexpr size_t frames_in_flight = 3;
+
+	struct Range {
+		GLuint buffer = 0;
+		size_t offset = 0;
+		size_t size = 0;
+	};
+
+  private:
+	GLuint buffer = 0;
+	std::byte* mapping = nullptr;
+	size_t region_size = 0;
+	size_t region = 0;
+	size_t head = 0;
+	size_t alignment = 0;
+	std::array<GLsync, frames_in_flight> fences = {};
+
+	// Buffers replaced during a frame are still referenced by that frame's bindings
+	std::vector<GLuint> retired;
+
+	void recreate(const size_t size) {
+		for (auto& i : fences) {
+			if (i) {
+				Backend::delete_fence(i);
+				i = nullptr;
+			}
+		}
+
+		if (buffer) {
+			retired.push_back(buffer);
+		}
+
+		region_size = size;
+		buffer = Backend::create();
+		mapping = static_cast<std::byte*>(Backend::allocate_persistent(buffer, region_size * frames_in_flight));
+	}
+
+  public:
+	/// Bytes written during the current frame
+	size_t frame_bytes = 0;
+
+	StreamBuffer() = default;
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	~StreamBuffer() {
+		for (const auto& i : fences) {
+			if (i) {
+				Backend::delete_fence(i);
+			}
+		}
+		for (const auto& i : retired) {
+			Backend::destroy(i);
+		}
+		if (buffer) {
+			Backend::destroy(buffer);
+		}
+	}
+
+	/// Moves to the next region, waiting for the GPU if it is still reading from it
+	void begin_frame() {
+		for (const auto& i : retired) {
+			Backend::destroy(i);
+		}
+		retired.clear();
+
+		if (buffer == 0) {
+			alignment = Backend::storage_offset_alignment();
+			recreate(1024 * 1024);
+		}
+
+		region = (region + 1) % frames_in_flight;
+		if (fences[region]) {
+			Backend::wait(fences[region]);
+			Backend::delete_fence(fences[region]);
+			fences[region] = nullptr;
+		}
+
+		head = 0;
+		frame_bytes = 0;
+	}
+
+	/// Copies size bytes into the current region. Grows the buffer if the region is full
+	Range write(const void* data, const size_t size) {
+		// Ranges can't be empty when bound
+		const size_t reserved = (std::max(size, size_t(1)) + alignment - 1) / alignment * alignment;
+
+		if (head + reserved > region_size) {
+			recreate(std::max(region_size * 2, reserved));
+			head = 0;
+		}
+
+		const size_t offset = region * region_size + head;
+		if (size > 0) {
+			std::memcpy(mapping + offset, data, size);
+		}
+		head += reserved;
+		frame_bytes += size;
+
+		return { buffer, offset, reserved };
+	}
+
+	/// Fences the current region, call once all draws using this frame's data have been issued
+	void end_frame() {
+		fences[region] = Backend::fence();
+	}
+};
\ No newline at end of file
@@ -14,6 +14,7 @@ namespace fs = std::filesystem;
 export class GPUTexture : public Resource {
   public:
 	GLuint id = 0;
+	GLuint64 bindless_handle = 0;
 
 	static constexpr const char* name = "GPUTexture";
 
@@ -69,6 +70,28 @@ export class GPUTexture : public Resource {
 	}
 
 	virtual ~GPUTexture() {
+		if (bindless_handle) {
+			glMakeTextureHandleNonResidentARB(bindless_handle);
+		}
 		glDeleteTextures(1, &id);
 	}
+
+	/// Creates and makes the handle resident on first use.
+	/// The sampler state of the texture is frozen after that, so set_wrap() calls are ignored
+	GLuint64 get_bindless_handle() {
+		if (!bindless_handle) {
+			bindless_handle = glGetTextureHandleARB(id);
+			glMakeTextureHandleResidentARB(bindless_handle);
+		}
+		return bindless_handle;
+	}
+
+	void set_wrap(const bool repeat_s, const bool repeat_t) {
+		// Textures are loaded per combination of wrap flags, so the frozen state is already the right one
+		if (bindless_handle) {
+			return;
+		}
+		glTextureParameteri(id, GL_TEXTURE_WRAP_S, repeat_s ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+		glTextureParameteri(id, GL_TEXTURE_WRAP_T, repeat_t ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+	}
 };
\ No newline at end of file
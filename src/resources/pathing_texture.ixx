@@ -11,7 +11,53 @@ import <glm/glm.hpp>;
 
 namespace fs = std::filesystem;
 
+/// A pathing texture converted to PathingMap flags (unwalkable 0b10, unflyable 0b100, unbuildable 0b1000) and rotated.
+/// Rows go bottom to top like the pathing map so that a stamp can be ORed onto it row by row
+export struct PathingStamp {
+	int width = 0;
+	int height = 0;
+	std::vector<u8> cells;
+};
+
 export class PathingTexture : public Resource {
+	/// A channel counts as set from this value on, anything below is treated as empty
+	static constexpr u8 threshold = 251;
+
+	bool is_homogeneous() const {
+		bool result = true;
+		for (size_t i = 0; i < data.size(); i += channels) {
+			if (channels == 3) {
+				result = result && *reinterpret_cast<const glm::u8vec3*>(data.data() + i) == *reinterpret_cast<const glm::u8vec3*>(data.data());
+			} else if (channels == 4) {
+				result = result && *reinterpret_cast<const glm::u8vec4*>(data.data() + i) == *reinterpret_cast<const glm::u8vec4*>(data.data());
+			}
+		}
+		return result;
+	}
+
+	/// Thresholds the image once and stores it at 0, 90, 180 and 270 degrees
+	void build_stamps() {
+		for (int r = 0; r < 4; r++) {
+			PathingStamp& stamp = stamps[r];
+			stamp.width = (r % 2) ? height : width;
+			stamp.height = (r % 2) ? width : height;
+			stamp.cells.assign(width * height, 0);
+		}
+
+		for (int j = 0; j < height; j++) {
+			for (int i = 0; i < width; i++) {
+				// Images are stored top to bottom
+				const size_t index = ((height - 1 - j) * width + i) * channels;
+				const u8 flags = (data[index] >= threshold) * 0b0010 | (data[index + 1] >= threshold) * 0b0100 | (data[index + 2] >= threshold) * 0b1000;
+
+				stamps[0].cells[j * width + i] = flags;
+				stamps[1].cells[i * height + (height - 1 - j)] = flags;
+				stamps[2].cells[(height - 1 - j) * width + (width - 1 - i)] = flags;
+				stamps[3].cells[(width - 1 - i) * height + j] = flags;
+			}
+		}
+	}
+
   public:
 	int width;
 	int height;
@@ -20,8 +66,18 @@ export class PathingTexture : public Resource {
 
 	bool homogeneous;
 
+	/// The texture rotated counterclockwise by 0, 90, 180 and 270 degrees
+	std::array<PathingStamp, 4> stamps;
+
 	static constexpr const char* name = "PathingTexture";
 
+	/// From raw 8 bit image data with 3 or 4 channels, top row first
+	PathingTexture(const int width, const int height, const int channels, std::vector<u8> data)
+		: width(width), height(height), channels(channels), data(std::move(data)) {
+		homogeneous = is_homogeneous();
+		build_stamps();
+	}
+
 	explicit PathingTexture(const fs::path& path) {
 		BinaryReader reader = hierarchy.open_file(path).value();
 		uint8_t* image_data;
@@ -34,13 +90,21 @@ export class PathingTexture : public Resource {
 		data = std::vector<u8>(image_data, image_data + width * height * channels);
 		delete image_data;
 
-		homogeneous = true;
-		for (size_t i = 0; i < data.size(); i += channels) {
-			if (channels == 3) {
-				homogeneous = homogeneous && *reinterpret_cast<glm::u8vec3*>(data.data() + i) == *reinterpret_cast<glm::u8vec3*>(data.data());
-			} else if (channels == 4) {
-				homogeneous = homogeneous && *reinterpret_cast<glm::u8vec4*>(data.data() + i) == *reinterpret_cast<glm::u8vec4*>(data.data());
-			}
+		homogeneous = is_homogeneous();
+		build_stamps();
+	}
+
+	/// Rotations other than 90, 180 and 270 use the unrotated stamp
+	const PathingStamp& rotated(const int rotation) const {
+		switch (rotation) {
+			case 90:
+				return stamps[1];
+			case 180:
+				return stamps[2];
+			case 270:
+				return stamps[3];
+			default:
+				return stamps[0];
 		}
 	}
 };
\ No newline at end of file
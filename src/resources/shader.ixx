@@ -8,18 +8,91 @@ import <glad/glad.h>;
 namespace fs = std::filesystem;
 
 export class Shader : public Resource {
-  public:
-	GLuint program;
+	/// Linked programs as returned by glGetProgramBinary, one file per program
+	static inline const fs::path cache_directory = "data/cache/shaders";
 
-	static constexpr const char* name = "Shader";
+	static std::uint64_t fnv1a(std::uint64_t hash, const std::string_view data) {
+		for (const char c : data) {
+			hash ^= static_cast<std::uint8_t>(c);
+			hash *= 0x100000001b3ull;
+		}
+		// Separates consecutive strings so that "ab" + "c" and "a" + "bc" differ
+		hash ^= 0xff;
+		hash *= 0x100000001b3ull;
+		return hash;
+	}
 
-	// vertex: .vert
-	// fragment: .frag
-	// compute: .comp
-	explicit Shader(std::initializer_list<fs::path> paths) {
-		program = glCreateProgram();
+	/// Binaries are only valid for the driver that created them, so it is part of the key
+	static std::uint64_t cache_key(const std::vector<std::pair<fs::path, std::string>>& sources) {
+		std::uint64_t hash = 0xcbf29ce484222325ull;
+		for (const GLenum i : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+			const char* value = reinterpret_cast<const char*>(glGetString(i));
+			hash = fnv1a(hash, value ? value : "");
+		}
+		for (const auto& [path, source] : sources) {
+			hash = fnv1a(hash, path.extension().string());
+			hash = fnv1a(hash, source);
+		}
+		return hash;
+	}
 
-		for (const auto& path : paths) {
+	static fs::path cache_path(const std::uint64_t key) {
+		return cache_directory / std::format("{:016x}.bin", key);
+	}
+
+	/// Returns false when there is no cached binary or the driver rejects it
+	bool load_binary(const std::uint64_t key) {
+		std::ifstream file(cache_path(key), std::ios::binary);
+		if (!file) {
+			return false;
+		}
+
+		GLenum format;
+		if (!file.read(reinterpret_cast<char*>(&format), sizeof(format))) {
+			return false;
+		}
+		const std::vector<char> binary(std::istreambuf_iterator<char>(file), {});
+		if (binary.empty()) {
+			return false;
+		}
+
+		glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+		GLint status;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (!status) {
+			// Usually a driver update that kept the version string, the program is compiled and the cache entry overwritten
+			std::print("Cached shader binary {} was rejected, compiling instead\n", cache_path(key).string());
+			return false;
+		}
+		return true;
+	}
+
+	void save_binary(const std::uint64_t key) const {
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (formats == 0 || length == 0) {
+			return;
+		}
+
+		std::vector<char> binary(length);
+		GLenum format;
+		glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+		std::error_code error;
+		fs::create_directories(cache_directory, error);
+		std::ofstream file(cache_path(key), std::ios::binary);
+		if (!file) {
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+		file.write(binary.data(), binary.size());
+	}
+
+	void compile(const std::vector<std::pair<fs::path, std::string>>& sources) {
+		std::vector<GLuint> shaders;
+		for (const auto& [path, source] : sources) {
 			GLuint shader;
 			if (path.extension() == ".vert") {
 				shader = glCreateShader(GL_VERTEX_SHADER);
@@ -31,7 +104,6 @@ export class Shader : public Resource {
 
 			static char buffer[512];
 			GLint status;
-			const std::string source = read_text_file(path);
 			const char* source_c_str = source.c_str();
 			glShaderSource(shader, 1, &source_c_str, nullptr);
 			glCompileShader(shader);
@@ -43,21 +115,65 @@ export class Shader : public Resource {
 			}
 
 			glAttachShader(program, shader);
+			shaders.push_back(shader);
 		}
 
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		glLinkProgram(program);
-		static char buffer[512];
-		GLint status;
-		glGetProgramiv(program, GL_LINK_STATUS, &status);
-		if (!status) {
-			glGetProgramInfoLog(program, 512, nullptr, buffer);
 
-			std::print("Failed to link\n");
-			for (const auto& path : paths) {
-				std::print("{}\n", path.string());
+		// The program keeps what it needs
+		for (const auto shader : shaders) {
+			glDetachShader(program, shader);
+			glDeleteShader(shader);
+		}
+	}
+
+  public:
+	GLuint program;
+
+	// Startup statistics, loading from the cache is a warm start and compiling a cold one
+	static inline double load_ms = 0.0;
+	static inline size_t cache_hits = 0;
+	static inline size_t compiled = 0;
+
+	static constexpr const char* name = "Shader";
+
+	// vertex: .vert
+	// fragment: .frag
+	// compute: .comp
+	explicit Shader(std::initializer_list<fs::path> paths) {
+		const auto begin = std::chrono::steady_clock::now();
+		program = glCreateProgram();
+
+		std::vector<std::pair<fs::path, std::string>> sources;
+		for (const auto& path : paths) {
+			sources.emplace_back(path, read_text_file(path));
+		}
+
+		const std::uint64_t key = cache_key(sources);
+		if (load_binary(key)) {
+			cache_hits += 1;
+		} else {
+			compile(sources);
+			compiled += 1;
+
+			static char buffer[512];
+			GLint status;
+			glGetProgramiv(program, GL_LINK_STATUS, &status);
+			if (!status) {
+				glGetProgramInfoLog(program, 512, nullptr, buffer);
+
+				std::print("Failed to link\n");
+				for (const auto& path : paths) {
+					std::print("{}\n", path.string());
+				}
+				std::print("{}\n", buffer);
+			} else {
+				save_binary(key);
 			}
-			std::print("{}\n", buffer);
 		}
+
+		load_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
 	}
 
 	~Shader() {
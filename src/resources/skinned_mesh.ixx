@@ -5,11 +5,17 @@ import MDX;
 import BinaryReader;
 import ResourceManager;
 import GPUTexture;
+import GPUBuffer;
 import Shader;
 import Hierarchy;
 import Camera;
 import SkeletalModelInstance;
+import SkeletonTopology;
+import MeshArena;
+import DrawCommands;
+import FrameArena;
 import Utilities;
+import Picking;
 import <glad/glad.h>;
 import <glm/glm.hpp>;
 import <glm/gtc/matrix_transform.hpp>;
@@ -33,6 +39,7 @@ export class SkinnedMesh : public Resource {
 	};
 
 	std::shared_ptr<mdx::MDX> model;
+	std::shared_ptr<SkeletonTopology> topology;
 
 	std::vector<MeshEntry> geosets;
 	bool has_mesh; // ToDo remove when added support for meshless
@@ -40,33 +47,32 @@ export class SkinnedMesh : public Resource {
 
 	uint32_t instance_vertex_count = 0;
 
-	GLuint vao;
-	GLuint vertex_snorm_buffer;
-	GLuint uv_snorm_buffer;
-	GLuint normal_buffer;
-	GLuint tangent_buffer;
-	GLuint weight_buffer;
-	GLuint index_buffer;
-	GLuint layer_alpha;
-
-	GLuint instance_ssbo;
-	GLuint layer_colors_ssbo;
+	// The geometry lives in skinned_mesh_arena, MeshEntry base_vertex/base_index are absolute offsets into it
+	MeshArena::Allocation allocation;
+
 	GLuint layer_texture_ssbo;
-	GLuint bones_ssbo;
-	GLuint bones_ssbo_colored;
 
-	GLuint preskinned_vertex_ssbo;
-	GLuint preskinned_tangent_light_direction_ssbo;
+	// Bone matrices are streamed every frame, this is the range written this frame
+	StreamBuffer<>::Range bones_range;
+
+	// Where the data of this mesh starts in the buffers RenderManager shares between all meshes this frame
+	uint32_t instance_offset = 0;
+	uint32_t layer_color_offset = 0;
+	uint32_t preskinned_offset = 0;
 
 	int skip_count = 0;
 
 	fs::path path;
 	std::vector<std::shared_ptr<GPUTexture>> textures;
-	std::vector<glm::mat4> render_jobs;
-	std::vector<glm::vec3> render_colors;
-	std::vector<const SkeletalModelInstance*> skeletons;
-	std::vector<glm::mat4> instance_bone_matrices;
-	std::vector<glm::vec4> layer_colors;
+	// Per frame render lists, allocated from the frame arena and released by RenderManager::render()
+	frame_vector<glm::mat4> render_jobs;
+	frame_vector<glm::vec3> render_colors;
+	frame_vector<const SkeletalModelInstance*> skeletons;
+	frame_vector<glm::mat4> instance_bone_matrices;
+	frame_vector<glm::vec4> layer_colors;
+
+	// Built on the first pick, most models are never clicked
+	std::unique_ptr<PickingMesh> picking;
 
 	static constexpr const char* name = "SkinnedMesh";
 
@@ -83,9 +89,7 @@ export class SkinnedMesh : public Resource {
 		size_t matrices = 0;
 
 		model = std::make_shared<mdx::MDX>(reader);
-
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		topology = std::make_shared<SkeletonTopology>(*model);
 
 		has_mesh = model->geosets.size();
 		if (!has_mesh) {
@@ -111,36 +115,14 @@ export class SkinnedMesh : public Resource {
 		}
 
 		// Allocate space
-		glCreateBuffers(1, &vertex_snorm_buffer);
-		glNamedBufferStorage(vertex_snorm_buffer, vertices * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
-
-		glCreateBuffers(1, &uv_snorm_buffer);
-		glNamedBufferStorage(uv_snorm_buffer, vertices * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
-
-		glCreateBuffers(1, &normal_buffer);
-		glNamedBufferStorage(normal_buffer, vertices * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
-
-		glCreateBuffers(1, &tangent_buffer);
-		glNamedBufferStorage(tangent_buffer, vertices * sizeof(glm::vec4), nullptr, GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
-
-		glCreateBuffers(1, &weight_buffer);
-		glNamedBufferStorage(weight_buffer, vertices * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
+		allocation = skinned_mesh_arena.allocate(vertices, indices);
+		const MeshArena& arena = skinned_mesh_arena;
 
-		glCreateBuffers(1, &index_buffer);
-		glNamedBufferStorage(index_buffer, indices * sizeof(uint16_t), nullptr, GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
-
-		glCreateBuffers(1, &instance_ssbo);
-		glCreateBuffers(1, &layer_colors_ssbo);
 		glCreateBuffers(1, &layer_texture_ssbo);
-		glCreateBuffers(1, &bones_ssbo);
-		glCreateBuffers(1, &bones_ssbo_colored);
-
-		glCreateBuffers(1, &preskinned_vertex_ssbo);
-		glCreateBuffers(1, &preskinned_tangent_light_direction_ssbo);
 
 		// Buffer Data
-		int base_vertex = 0;
-		int base_index = 0;
+		int base_vertex = static_cast<int>(allocation.vertex_offset);
+		int base_index = static_cast<int>(allocation.index_offset);
 
 		for (const auto& i : model->geosets) {
 			if (i.lod != 0) {
@@ -162,9 +144,9 @@ export class SkinnedMesh : public Resource {
 			if (i.skin.empty()) {
 				// If the skin vector is empty, then the model has SD bone weights, and we convert them to the HD skin weights.
 				const auto skin_weights = mdx::MDX::matrix_groups_as_skin_weights(i);
-				glNamedBufferSubData(weight_buffer, base_vertex * sizeof(glm::uvec2), entry.vertices * 8, skin_weights.data());
+				glNamedBufferSubData(arena.weight_buffer, base_vertex * sizeof(glm::uvec2), entry.vertices * 8, skin_weights.data());
 			} else {
-				glNamedBufferSubData(weight_buffer, base_vertex * sizeof(glm::uvec2), entry.vertices * 8, i.skin.data());
+				glNamedBufferSubData(arena.weight_buffer, base_vertex * sizeof(glm::uvec2), entry.vertices * 8, i.skin.data());
 			}
 
 			std::vector<glm::uvec2> vertices_snorm;
@@ -174,27 +156,27 @@ export class SkinnedMesh : public Resource {
 
 				vertices_snorm.push_back(glm::uvec2(xy, zw));
 			}
-			glNamedBufferSubData(vertex_snorm_buffer, base_vertex * sizeof(glm::uvec2), entry.vertices * sizeof(glm::uvec2), vertices_snorm.data());
+			glNamedBufferSubData(arena.vertex_snorm_buffer, base_vertex * sizeof(glm::uvec2), entry.vertices * sizeof(glm::uvec2), vertices_snorm.data());
 
 			std::vector<uint32_t> uvs_snorm;
 			for (const auto& j : i.uv_sets.front()) {
 				uvs_snorm.push_back(glm::packSnorm2x16((j + 1.f) / 4.f));
 			}
-			glNamedBufferSubData(uv_snorm_buffer, base_vertex * sizeof(uint32_t), entry.vertices * sizeof(uint32_t), uvs_snorm.data());
+			glNamedBufferSubData(arena.uv_snorm_buffer, base_vertex * sizeof(uint32_t), entry.vertices * sizeof(uint32_t), uvs_snorm.data());
 
 			std::vector<uint32_t> normals_oct_snorm;
 			for (const auto& normal : i.normals) {
 				normals_oct_snorm.push_back(glm::packSnorm2x16(float32x3_to_oct(normal)));
 			}
-			glNamedBufferSubData(normal_buffer, base_vertex * sizeof(uint32_t), entry.vertices * sizeof(uint32_t), normals_oct_snorm.data());
+			glNamedBufferSubData(arena.normal_buffer, base_vertex * sizeof(uint32_t), entry.vertices * sizeof(uint32_t), normals_oct_snorm.data());
 
 			if (!i.tangents.empty()) {
-				glNamedBufferSubData(tangent_buffer, base_vertex * sizeof(glm::vec4), entry.vertices * sizeof(glm::vec4), i.tangents.data());
+				glNamedBufferSubData(arena.tangent_buffer, base_vertex * sizeof(glm::vec4), entry.vertices * sizeof(glm::vec4), i.tangents.data());
 			} else {
 				//glNamedBufferSubData(tangent_buffer, base_vertex * sizeof(glm::vec4), entry.vertices * sizeof(glm::vec4), normals_vec4.data());
 			}
 
-			glNamedBufferSubData(index_buffer, base_index * sizeof(uint16_t), entry.indices * sizeof(uint16_t), i.faces.data());
+			glNamedBufferSubData(arena.index_buffer, base_index * sizeof(uint16_t), entry.indices * sizeof(uint16_t), i.faces.data());
 
 			base_vertex += entry.vertices;
 			base_index += entry.indices;
@@ -202,7 +184,7 @@ export class SkinnedMesh : public Resource {
 
 		for (const auto& i : geosets) {
 			skip_count += model->materials[i.material_id].layers.size();
-			instance_vertex_count += i.indices;
+			instance_vertex_count += i.vertices;
 		}
 
 		// animations geoset ids > geosets
@@ -265,10 +247,7 @@ export class SkinnedMesh : public Resource {
 			} else {
 				textures.push_back(resource_manager.load<GPUTexture>(texture.file_name, std::to_string(texture.flags)));
 			}
-			// TODO we should have a unique texture resource for each combination of the below two settings
-			// Or emulate it in the shader?
-			glTextureParameteri(textures.back()->id, GL_TEXTURE_WRAP_S, texture.flags & 1 ? GL_REPEAT : GL_CLAMP_TO_EDGE);
-			glTextureParameteri(textures.back()->id, GL_TEXTURE_WRAP_T, texture.flags & 2 ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+			textures.back()->set_wrap(texture.flags & 1, texture.flags & 2);
 		}
 
 		// Reclaim some space
@@ -298,43 +277,33 @@ export class SkinnedMesh : public Resource {
 		// 	i.uv_sets.clear();
 		// 	i.uv_sets.shrink_to_fit();
 		// }
-
-		glVertexArrayElementBuffer(vao, index_buffer);
 	}
 
 	~SkinnedMesh() {
-		glDeleteBuffers(1, &vertex_snorm_buffer);
-		glDeleteBuffers(1, &uv_snorm_buffer);
-		glDeleteBuffers(1, &normal_buffer);
-		glDeleteBuffers(1, &tangent_buffer);
-		glDeleteBuffers(1, &weight_buffer);
-		glDeleteBuffers(1, &index_buffer);
-		glDeleteBuffers(1, &layer_alpha);
-		glDeleteBuffers(1, &layer_colors_ssbo);
+		if (!has_mesh) {
+			return;
+		}
+		skinned_mesh_arena.free(allocation);
 		glDeleteBuffers(1, &layer_texture_ssbo);
-		glDeleteBuffers(1, &instance_ssbo);
-		glDeleteBuffers(1, &bones_ssbo);
-		glDeleteBuffers(1, &bones_ssbo_colored);
-
-		glDeleteBuffers(1, &preskinned_vertex_ssbo);
-		glDeleteBuffers(1, &preskinned_tangent_light_direction_ssbo);
 	}
 
-	void upload_render_data(uint64_t& size) {
+	/// Streams the bone matrices and computes the layer colors, RenderManager gathers the instance matrices and layer colors of all meshes.
+	/// Returns the amount of bytes uploaded
+	size_t upload_render_data(StreamBuffer<>& stream) {
+		layer_colors.clear();
 		if (!has_mesh) {
-			return;
+			return 0;
 		}
 
-		glNamedBufferData(instance_ssbo, render_jobs.size() * sizeof(glm::mat4), render_jobs.data(), GL_DYNAMIC_DRAW);
-
+		instance_bone_matrices.reserve(render_jobs.size() * model->bones.size());
 		for (int i = 0; i < render_jobs.size(); i++) {
 			instance_bone_matrices.insert(instance_bone_matrices.end(), skeletons[i]->world_matrices.begin(), skeletons[i]->world_matrices.begin() + model->bones.size());
 		}
 
-		glNamedBufferData(bones_ssbo, instance_bone_matrices.size() * sizeof(glm::mat4), instance_bone_matrices.data(), GL_DYNAMIC_DRAW);
-
-		layer_colors.clear();
+		bones_range = stream.write(instance_bone_matrices.data(), instance_bone_matrices.size() * sizeof(glm::mat4));
+		const size_t uploaded = instance_bone_matrices.size() * sizeof(glm::mat4);
 
+		layer_colors.reserve(render_jobs.size() * skip_count);
 		for (size_t k = 0; k < render_jobs.size(); k++) {
 			for (const auto& i : geosets) {
 				glm::vec3 geoset_color = render_colors[k];
@@ -355,53 +324,76 @@ export class SkinnedMesh : public Resource {
 			}
 		}
 
-		glNamedBufferData(layer_colors_ssbo, layer_colors.size() * sizeof(glm::vec4), layer_colors.data(), GL_DYNAMIC_DRAW);
+		return uploaded;
+	}
 
-		glNamedBufferData(preskinned_vertex_ssbo, instance_vertex_count * sizeof(glm::uvec2) * render_jobs.size(), nullptr, GL_DYNAMIC_DRAW);
-		glNamedBufferData(preskinned_tangent_light_direction_ssbo, instance_vertex_count * sizeof(uint32_t) * render_jobs.size(), nullptr, GL_DYNAMIC_DRAW);
+	static void bind_range(const GLuint index, const StreamBuffer<>::Range& range) {
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, range.buffer, range.offset, range.size);
 	}
 
 	// Render all geometry and save the resulting vertices in a buffer
+	// The shared buffers are bound by RenderManager
 	void preskin_geometry() {
 		if (!has_mesh) {
 			return;
 		}
 
-		glBindVertexArray(vao);
-
 		glUniform1ui(2, instance_vertex_count);
 		glUniform1ui(3, model->bones.size());
+		glUniform1ui(7, instance_offset);
+		glUniform1ui(8, allocation.vertex_offset);
+		glUniform1ui(9, preskinned_offset);
+		glUniform1ui(10, render_jobs.size());
 
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instance_ssbo);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, bones_ssbo);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, vertex_snorm_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, normal_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, tangent_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, weight_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, preskinned_vertex_ssbo);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, preskinned_tangent_light_direction_ssbo);
+		bind_range(2, bones_range);
 
 		glDispatchCompute(((instance_vertex_count * render_jobs.size()) + 63) / 64, 1, 1);
-		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 	}
 
-	void render_opaque(bool render_hd, bool render_lighting) {
+	/// Adds the draw of one layer for all instances of the mesh
+	void add_layer_draw(DrawCommandList& list, const MeshEntry& geoset, const mdx::Layer& layer, const size_t layer_in_material, const int lay_index, const bool render_lighting) {
+		DrawData data;
+		// Slots the layer doesn't have were left bound to whatever came before, reuse the first texture instead
+		for (size_t texture_slot = 0; texture_slot < std::size(data.textures); texture_slot++) {
+			const size_t slot = texture_slot < layer.texturess.size() ? texture_slot : 0;
+			data.textures[texture_slot] = textures[layer.texturess[slot].id]->get_bindless_handle();
+		}
+		data.instance_offset = instance_offset;
+		data.layer_color_offset = layer_color_offset;
+		data.layer_skip_count = skip_count;
+		data.layer_index = lay_index;
+		data.vertex_offset = allocation.vertex_offset;
+		data.preskinned_offset = preskinned_offset;
+		data.instance_vertex_count = instance_vertex_count;
+		data.alpha_test = layer.blend_mode == 1 ? 0.75f : -1.0f;
+		data.show_lighting = !(layer.shading_flags & 0x1) && render_lighting;
+
+		const PipelineState state = {
+			.layer = static_cast<uint32_t>(layer_in_material),
+			.blend_mode = layer.blend_mode == 1 ? 0u : static_cast<uint32_t>(layer.blend_mode),
+			.hd = layer.hd,
+			.two_sided = (layer.shading_flags & 0x10) != 0,
+			.depth_test = !(layer.shading_flags & 0x40),
+			.depth_write = !(layer.shading_flags & 0x80),
+		};
+
+		const DrawElementsIndirectCommand command = {
+			.count = static_cast<uint32_t>(geoset.indices),
+			.instance_count = static_cast<uint32_t>(render_jobs.size()),
+			.first_index = static_cast<uint32_t>(geoset.base_index),
+			.base_vertex = geoset.base_vertex,
+			.base_instance = 0,
+		};
+
+		list.add(state, command, data);
+	}
+
+	/// Adds a draw for every visible opaque layer, all instances of the mesh are drawn by the same command
+	void queue_opaque_draws(DrawCommandList& list, bool render_lighting) {
 		if (!has_mesh) {
 			return;
 		}
 
-		glBindVertexArray(vao);
-
-		glUniform1i(4, skip_count);
-		glUniform1ui(6, instance_vertex_count);
-
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, layer_colors_ssbo);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, uv_snorm_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, preskinned_vertex_ssbo);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, preskinned_tangent_light_direction_ssbo);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, normal_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, instance_ssbo);
-
 		int lay_index = 0;
 		for (const auto& i : geosets) {
 			const auto& layers = model->materials[i.material_id].layers;
@@ -411,92 +403,73 @@ export class SkinnedMesh : public Resource {
 				continue;
 			}
 
-			for (const auto& j : layers) {
+			for (size_t l = 0; l < layers.size(); l++) {
+				const auto& j = layers[l];
+
 				// We don't have to render fully transparent meshes
 				// Some Reforged bridges for instance have a FilterMode None but a static alpha of 0 for some materials
-				if (layer_colors[lay_index].a <= 0.01f) {
-					lay_index += 1;
-					continue;
-				}
-
-				if (j.hd != render_hd) {
+				if (layer_colors[lay_index].a <= 0.01f || j.texturess.empty()) {
 					lay_index += 1;
 					continue;
 				}
 
-				glUniform1f(1, j.blend_mode == 1 ? 0.75f : -1.0f);
-				glUniform1i(5, lay_index);
+				add_layer_draw(list, i, j, l, lay_index, render_lighting);
+				lay_index += 1;
+			}
+		}
+	}
 
-				switch (j.blend_mode) {
-					case 0:
-					case 1:
-						glBlendFunc(GL_ONE, GL_ZERO);
-						break;
-					case 2:
-						glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-						break;
-					case 3:
-						glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-						break;
-					case 4:
-						glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-						break;
-					case 5:
-						glBlendFunc(GL_ZERO, GL_SRC_COLOR);
-						break;
-					case 6:
-						glBlendFunc(GL_DST_COLOR, GL_SRC_COLOR);
-						break;
-				}
+	/// Adds a draw for every alpha blended layer of the transparent geosets, for the weighted blended transparency pass.
+	/// The blend order doesn't matter there so all instances are drawn by the same command, just like the opaque layers
+	void queue_blended_draws(DrawCommandList& list, bool render_lighting) {
+		if (!has_mesh) {
+			return;
+		}
 
-				glUniform1i(2, !(j.shading_flags & 0x1) && render_lighting);
+		size_t draw_calls = 0;
+		int lay_index = 0;
+		for (const auto& i : geosets) {
+			const auto& layers = model->materials[i.material_id].layers;
 
-				if (j.shading_flags & 0x10) {
-					glDisable(GL_CULL_FACE);
-				} else {
-					glEnable(GL_CULL_FACE);
-				}
+			if (layers[0].blend_mode == 0 || layers[0].blend_mode == 1) {
+				lay_index += layers.size();
+				continue;
+			}
 
-				if (j.shading_flags & 0x40) {
-					glDisable(GL_DEPTH_TEST);
-				} else {
-					glEnable(GL_DEPTH_TEST);
-				}
+			for (size_t l = 0; l < layers.size(); l++) {
+				const auto& j = layers[l];
 
-				if (j.shading_flags & 0x80) {
-					glDepthMask(false);
-				} else {
-					glDepthMask(true);
+				// Instances for which the layer is invisible add nothing to the accumulation, so they can be drawn along
+				bool visible = false;
+				for (size_t k = 0; k < render_jobs.size() && !visible; k++) {
+					visible = layer_colors[k * skip_count + lay_index].a > 0.01f;
 				}
 
-				for (size_t texture_slot = 0; texture_slot < j.texturess.size(); texture_slot++) {
-					glBindTextureUnit(texture_slot, textures[j.texturess[texture_slot].id]->id);
+				if (j.blend_mode == 2 && visible && !j.texturess.empty()) {
+					add_layer_draw(list, i, j, l, lay_index, render_lighting);
 				}
-
-				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, i.indices, GL_UNSIGNED_SHORT, reinterpret_cast<void*>(i.base_index * sizeof(uint16_t)), render_jobs.size(), i.base_vertex);
 				lay_index += 1;
 			}
 		}
 	}
 
-	void render_transparent(int instance_id, bool render_hd, bool render_lighting) {
+	/// Draws the transparent layers of several instances with one instanced draw per layer.
+	/// instance_ids are the instance indices stored at list_offset in the instance list RenderManager binds to binding 7
+	/// When skip_blended is set the alpha blended layers are left out as they were drawn by the weighted blended transparency pass.
+	/// Returns the amount of draw calls
+	size_t render_transparent(const uint32_t list_offset, const std::span<const uint32_t> instance_ids, bool render_hd, bool render_lighting, bool skip_blended) {
 		if (!has_mesh) {
-			return;
+			return 0;
 		}
 
-		glBindVertexArray(vao);
-
-		glUniform1i(4, instance_id);
+		glUniform1ui(4, list_offset);
 		glUniform1i(6, skip_count);
 
 		glUniform1ui(9, instance_vertex_count);
-
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, layer_colors_ssbo);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, uv_snorm_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, preskinned_vertex_ssbo);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, preskinned_tangent_light_direction_ssbo);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, normal_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, instance_ssbo);
+		glUniform1ui(10, instance_offset);
+		glUniform1ui(11, layer_color_offset);
+		glUniform1ui(12, allocation.vertex_offset);
+		glUniform1ui(13, preskinned_offset);
 
 		int lay_index = 0;
 		for (const auto& i : geosets) {
@@ -508,13 +481,16 @@ export class SkinnedMesh : public Resource {
 			}
 
 			for (const auto& j : layers) {
-				// We don't have to render fully transparent meshes
-				if (layer_colors[instance_id * skip_count + lay_index].a <= 0.01f) {
+				// We don't have to render fully transparent meshes, the vertex shader discards the instances for which only this layer is invisible
+				const bool visible = std::ranges::any_of(instance_ids, [&](const uint32_t instance_id) {
+					return layer_colors[instance_id * skip_count + lay_index].a > 0.01f;
+				});
+				if (!visible) {
 					lay_index += 1;
 					continue;
 				}
 
-				if (j.hd != render_hd) {
+				if (j.hd != render_hd || (skip_blended && j.blend_mode == 2)) {
 					lay_index += 1;
 					continue;
 				}
@@ -557,68 +533,60 @@ export class SkinnedMesh : public Resource {
 					glBindTextureUnit(texture_slot, textures[j.texturess[texture_slot].id]->id);
 				}
 
-				glDrawElementsBaseVertex(GL_TRIANGLES, i.indices, GL_UNSIGNED_SHORT, reinterpret_cast<void*>(i.base_index * sizeof(uint16_t)), i.base_vertex);
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, i.indices, GL_UNSIGNED_SHORT, reinterpret_cast<void*>(i.base_index * sizeof(uint16_t)), instance_ids.size(), i.base_vertex);
+				draw_calls += 1;
 				lay_index += 1;
 			}
 		}
+		return draw_calls;
 	}
 
-	void render_color_coded(const SkeletalModelInstance& skeleton, int id) {
-		if (!has_mesh) {
-			return;
+	/// The triangles of the geosets that are rendered, the geoset ids are indices into geosets
+	const PickingMesh& picking_mesh() {
+		if (picking) {
+			return *picking;
 		}
 
-		glBindVertexArray(vao);
-
-		glm::mat4 MVP = camera.projection_view * skeleton.matrix;
-		glUniformMatrix4fv(0, 1, false, &MVP[0][0]);
-
-		glUniform1i(7, id);
-
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, bones_ssbo_colored);
-		glNamedBufferData(bones_ssbo_colored, model->bones.size() * sizeof(glm::mat4), skeleton.world_matrices.data(), GL_DYNAMIC_DRAW);
-
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vertex_snorm_buffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, weight_buffer);
-
-		for (const auto& i : geosets) {
-			float geoset_anim_visibility = 1.0f;
-			if (i.geoset_anim && skeleton.sequence_index >= 0) {
-				geoset_anim_visibility = skeleton.get_geoset_animation_visiblity(*i.geoset_anim);
-			}
-
-			for (const auto& j : model->materials[i.material_id].layers) {
-				float layer_visibility = 1.0f;
-				if (skeleton.sequence_index >= 0) {
-					layer_visibility = skeleton.get_layer_visiblity(j);
-				}
-
-				float final_visibility = layer_visibility * geoset_anim_visibility;
-				if (final_visibility <= 0.001f) {
+		picking = std::make_unique<PickingMesh>();
+		if (has_mesh) {
+			uint32_t geoset = 0;
+			for (const auto& i : model->geosets) {
+				if (i.lod != 0) {
 					continue;
 				}
 
-				if (j.shading_flags & 0x40) {
-					glDisable(GL_DEPTH_TEST);
+				if (i.skin.empty()) {
+					const auto skin_weights = mdx::MDX::matrix_groups_as_skin_weights(i);
+					picking->add_geoset(i.vertices, i.faces, std::span(reinterpret_cast<const uint8_t*>(skin_weights.data()), skin_weights.size() * 4), geoset);
 				} else {
-					glEnable(GL_DEPTH_TEST);
+					picking->add_geoset(i.vertices, i.faces, i.skin, geoset);
 				}
+				geoset += 1;
+			}
+			picking->build();
+		}
+		return *picking;
+	}
 
-				if (j.shading_flags & 0x80) {
-					glDepthMask(false);
-				} else {
-					glDepthMask(true);
-				}
+	/// Whether any layer of the geoset is visible in the current pose of skeleton, the geosets that would be drawn
+	bool geoset_visible(const SkeletalModelInstance& skeleton, const size_t geoset) const {
+		const MeshEntry& entry = geosets[geoset];
 
-				if (j.shading_flags & 0x10) {
-					glDisable(GL_CULL_FACE);
-				} else {
-					glEnable(GL_CULL_FACE);
-				}
+		float geoset_anim_visibility = 1.0f;
+		if (entry.geoset_anim && skeleton.sequence_index >= 0) {
+			geoset_anim_visibility = skeleton.get_geoset_animation_visiblity(*entry.geoset_anim);
+		}
 
-				glDrawElementsBaseVertex(GL_TRIANGLES, i.indices, GL_UNSIGNED_SHORT, reinterpret_cast<void*>(i.base_index * sizeof(uint16_t)), i.base_vertex);
-				break;
+		for (const auto& j : model->materials[entry.material_id].layers) {
+			float layer_visibility = 1.0f;
+			if (skeleton.sequence_index >= 0) {
+				layer_visibility = skeleton.get_layer_visiblity(j);
+			}
+
+			if (layer_visibility * geoset_anim_visibility > 0.001f) {
+				return true;
 			}
 		}
+		return false;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,168 @@
+export module DrawCommands;
+
+import std;
+import types;
+
+/// The command layout glMultiDrawElementsIndirect reads from the GL_DRAW_INDIRECT_BUFFER
+export struct DrawElementsIndirectCommand {
+	u32 count;
+	u32 instance_count;
+	u32 first_index;
+	i32 base_vertex;
+	u32 base_instance;
+};
+
+/// Per draw parameters, looked up with gl_DrawID.
+/// Has to match the std430 DrawData struct in skinned_mesh_instanced_sd/hd
+export struct DrawData {
+	u64 textures[6] = {}; // Bindless handles
+	u32 instance_offset = 0;
+	u32 layer_color_offset = 0;
+	u32 layer_skip_count = 0;
+	u32 layer_index = 0;
+	u32 vertex_offset = 0;
+	u32 preskinned_offset = 0;
+	u32 instance_vertex_count = 0;
+	f32 alpha_test = -1.f;
+	u32 show_lighting = 0;
+	u32 padding = 0;
+};
+static_assert(sizeof(DrawData) == 88);
+
+/// The GL state a draw needs. Consecutive draws with the same state are submitted with a single glMultiDrawElementsIndirect
+export struct PipelineState {
+	u32 layer = 0; // Index of the layer in its material, later layers blend on top of the earlier ones
+	u32 blend_mode = 0;
+	bool hd = false;
+	bool two_sided = false;
+	bool depth_test = true;
+	bool depth_write = true;
+
+	/// The layer is the most significant part so that the layers of a material are still drawn in order after sorting
+	u32 key() const {
+		return (std::min(layer, 255u) << 8) | (blend_mode << 4) | (hd << 3) | (two_sided << 2) | (!depth_test << 1) | !depth_write;
+	}
+
+	bool operator==(const PipelineState&) const = default;
+};
+
+/// The opaque draws of a frame. Built and sorted on the CPU without touching GL, RenderManager uploads and submits it
+export class DrawCommandList {
+  public:
+	struct Group {
+		PipelineState state;
+		size_t first;
+		size_t count;
+	};
+
+	// Parallel arrays, commands and draw_data are uploaded as is
+	std::vector<PipelineState> states;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<DrawData> draw_data;
+
+	/// Filled by sort()
+	std::vector<Group> groups;
+
+	void clear() {
+		states.clear();
+		commands.clear();
+		draw_data.clear();
+		groups.clear();
+	}
+
+	void add(const PipelineState& state, const DrawElementsIndirectCommand& command, const DrawData& data) {
+		states.push_back(state);
+		commands.push_back(command);
+		draw_data.push_back(data);
+	}
+
+	/// Sorts the draws on their pipeline state, keeping the submission order for equal states, and builds the groups.
+	/// The submission index is the low part of the sort key, which keeps equal states in order without the temporary buffer of std::stable_sort
+	void sort() {
+		keys.resize(states.size());
+		for (size_t i = 0; i < states.size(); i++) {
+			keys[i] = (static_cast<u64>(states[i].key()) << 32) | i;
+		}
+		std::sort(keys.begin(), keys.end());
+
+		sorted_states.resize(states.size());
+		sorted_commands.resize(commands.size());
+		sorted_draw_data.resize(draw_data.size());
+		for (size_t i = 0; i < keys.size(); i++) {
+			const u32 source = static_cast<u32>(keys[i]);
+			sorted_states[i] = states[source];
+			sorted_commands[i] = commands[source];
+			sorted_draw_data[i] = draw_data[source];
+		}
+		states.swap(sorted_states);
+		commands.swap(sorted_commands);
+		draw_data.swap(sorted_draw_data);
+
+		groups.clear();
+		for (size_t i = 0; i < states.size(); i++) {
+			if (groups.empty() || !(groups.back().state == states[i])) {
+				groups.push_back({ states[i], i, 0 });
+			}
+			groups.back().count += 1;
+		}
+	}
+
+  private:
+	// Scratch space reused between frames
+	std::vector<u64> keys;
+	std::vector<PipelineState> sorted_states;
+	std::vector<DrawElementsIndirectCommand> sorted_commands;
+	std::vector<DrawData> sorted_draw_data;
+};
+
+/// Orders transparent instances back to front. The distance is the most significant part and is quantized,
+/// so instances of the same mesh at nearly the same distance end up next to each other and can share one instanced draw
+export u64 transparent_sort_key(const float distance, const u32 mesh) {
+	// Keeps 11 of the 23 mantissa bits, instances less than about 0.05% of the distance apart may be drawn in any order
+	constexpr u32 dropped_bits = 12;
+	constexpr u32 mask = 0xFFFFFFFFu >> dropped_bits;
+
+	const u32 bits = std::bit_cast<u32>(std::max(distance, 0.f)) >> dropped_bits;
+	return (static_cast<u64>(~bits & mask) << 32) | mesh;
+}
+
+/// Least significant digit radix sort on 64 bit keys with 8 bit digits, carrying a value along with every key.
+/// Passes in which all keys share the same digit are skipped, for transparent_sort_key() that is most of the mesh part
+export class RadixSort {
+	// Scratch space reused between frames
+	std::vector<u64> scratch_keys;
+	std::vector<u32> scratch_values;
+
+  public:
+	void sort(std::vector<u64>& keys, std::vector<u32>& values) {
+		scratch_keys.resize(keys.size());
+		scratch_values.resize(values.size());
+
+		for (u32 shift = 0; shift < 64; shift += 8) {
+			std::array<size_t, 256> offsets = {};
+			for (const auto& key : keys) {
+				offsets[(key >> shift) & 0xFF] += 1;
+			}
+
+			if (keys.empty() || offsets[(keys.front() >> shift) & 0xFF] == keys.size()) {
+				continue;
+			}
+
+			size_t sum = 0;
+			for (auto& i : offsets) {
+				const size_t count = i;
+				i = sum;
+				sum += count;
+			}
+
+			for (size_t i = 0; i < keys.size(); i++) {
+				const size_t destination = offsets[(keys[i] >> shift) & 0xFF]++;
+				scratch_keys[destination] = keys[i];
+				scratch_values[destination] = values[i];
+			}
+
+			keys.swap(scratch_keys);
+			values.swap(scratch_values);
+		}
+	}
+};
\ No newline at end of file
@@ -0,0 +1,97 @@
+export module MeshArena;
+
+import std;
+import GPUBuffer;
+import <glad/glad.h>;
+import <glm/glm.hpp>;
+
+/// Vertex and index storage shared by all SkinnedMeshes so that the geometry of different models can be drawn with a single glMultiDrawElementsIndirect.
+/// Offsets and counts are in vertices/indices. Growing reallocates the buffers and copies the old contents on the GPU
+export class MeshArena {
+  public:
+	struct Allocation {
+		size_t vertex_offset = 0;
+		size_t vertex_count = 0;
+		size_t index_offset = 0;
+		size_t index_count = 0;
+	};
+
+	GLuint vao = 0;
+	GLuint vertex_snorm_buffer = 0;
+	GLuint uv_snorm_buffer = 0;
+	GLuint normal_buffer = 0;
+	GLuint tangent_buffer = 0;
+	GLuint weight_buffer = 0;
+	GLuint index_buffer = 0;
+
+  private:
+	RangeAllocator vertices;
+	RangeAllocator indices;
+
+	static void resize(GLuint& buffer, const size_t old_size, const size_t new_size) {
+		GLuint new_buffer;
+		glCreateBuffers(1, &new_buffer);
+		glNamedBufferStorage(new_buffer, new_size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		if (buffer) {
+			glCopyNamedBufferSubData(buffer, new_buffer, 0, 0, old_size);
+			glDeleteBuffers(1, &buffer);
+		}
+		buffer = new_buffer;
+	}
+
+	void grow_vertices(const size_t required) {
+		const size_t old_capacity = vertices.capacity;
+		const size_t capacity = std::max({ required, old_capacity * 2, size_t(65536) });
+
+		resize(vertex_snorm_buffer, old_capacity * sizeof(glm::uvec2), capacity * sizeof(glm::uvec2));
+		resize(uv_snorm_buffer, old_capacity * sizeof(uint32_t), capacity * sizeof(uint32_t));
+		resize(normal_buffer, old_capacity * sizeof(uint32_t), capacity * sizeof(uint32_t));
+		resize(tangent_buffer, old_capacity * sizeof(glm::vec4), capacity * sizeof(glm::vec4));
+		resize(weight_buffer, old_capacity * sizeof(glm::uvec2), capacity * sizeof(glm::uvec2));
+		vertices.grow(capacity);
+	}
+
+	void grow_indices(const size_t required) {
+		const size_t old_capacity = indices.capacity;
+		const size_t capacity = std::max({ required, old_capacity * 2, size_t(65536) });
+
+		resize(index_buffer, old_capacity * sizeof(uint16_t), capacity * sizeof(uint16_t));
+		indices.grow(capacity);
+		glVertexArrayElementBuffer(vao, index_buffer);
+	}
+
+  public:
+	Allocation allocate(const size_t vertex_count, const size_t index_count) {
+		if (vao == 0) {
+			glCreateVertexArrays(1, &vao);
+		}
+
+		Allocation allocation;
+		allocation.vertex_count = vertex_count;
+		allocation.index_count = index_count;
+
+		std::optional<size_t> vertex_offset = vertices.allocate(vertex_count);
+		while (!vertex_offset) {
+			grow_vertices(vertices.capacity + vertex_count);
+			vertex_offset = vertices.allocate(vertex_count);
+		}
+		allocation.vertex_offset = *vertex_offset;
+
+		std::optional<size_t> index_offset = indices.allocate(index_count);
+		while (!index_offset) {
+			grow_indices(indices.capacity + index_count);
+			index_offset = indices.allocate(index_count);
+		}
+		allocation.index_offset = *index_offset;
+
+		return allocation;
+	}
+
+	void free(const Allocation& allocation) {
+		vertices.free(allocation.vertex_offset, allocation.vertex_count);
+		indices.free(allocation.index_offset, allocation.index_count);
+	}
+};
+
+// Lives as long as the GL context, so the buffers are left for the driver to clean up
+export inline MeshArena skinned_mesh_arena;
\ No newline at end of file
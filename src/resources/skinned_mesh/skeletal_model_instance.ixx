@@ -8,7 +8,8 @@ import std;
 import Camera;
 import Utilities;
 import MathOperations;
-import RenderNode;
+import SkeletonTopology;
+import PoolAllocator;
 import MDX;
 import <glm/glm.hpp>;
 import <glm/gtc/matrix_transform.hpp>;
@@ -27,52 +28,73 @@ struct CurrentKeyFrame {
 	int right = 0;
 };
 
+/// How often an instance evaluates its skeleton, chosen per frame from camera distance and projected size
+export enum class AnimationLOD {
+	full = 1,
+	half = 2,
+	quarter = 4,
+	eighth = 8,
+	clock_only = 0 // Outside of the view frustum, only the sequence clock advances
+};
+
+/// Picks the animation update rate for an instance with the given world space bounds, for when its visibility is already known
+export AnimationLOD animation_lod(const Camera& camera, const glm::vec3& min, const glm::vec3& max, const bool visible) {
+	if (!visible) {
+		return AnimationLOD::clock_only;
+	}
+
+	const glm::vec3 eye = camera.position - camera.direction * camera.distance;
+	const float distance = std::max(glm::distance(eye, (min + max) * 0.5f), camera.draw_distance_close);
+
+	// Fraction of the screen height covered by the instance bounds
+	const float projected_size = glm::length(max - min) / (distance * camera.tan_height);
+
+	if (projected_size > 0.08f) {
+		return AnimationLOD::full;
+	} else if (projected_size > 0.04f) {
+		return AnimationLOD::half;
+	} else if (projected_size > 0.02f) {
+		return AnimationLOD::quarter;
+	}
+	return AnimationLOD::eighth;
+}
+
+/// Picks the animation update rate for an instance with the given world space bounds
+export AnimationLOD animation_lod(const Camera& camera, const glm::vec3& min, const glm::vec3& max) {
+	return animation_lod(camera, min, max, camera.inside_frustrum(min, max));
+}
+
 export class SkeletalModelInstance {
   public:
+	/// Number of skeleton evaluations (update_nodes calls) since the last reset, used by the debug overlay
+	static inline std::atomic<uint32_t> skeletal_evaluations = 0;
+
 	std::shared_ptr<mdx::MDX> model;
+	/// Shared between all instances of the same model
+	std::shared_ptr<const SkeletonTopology> topology;
 
 	int sequence_index = 0; // can be -1 if not animating
 	int current_frame = 0;
 
+	// Animation LOD state, the delta of skipped updates is accumulated and applied on the next full update
+	double accumulated_delta = 0.0;
+	uint32_t lod_frame = 0;
+
 	glm::mat4 matrix = glm::mat4(1.f);
 
-	std::vector<CurrentKeyFrame> current_keyframes;
-	std::vector<RenderNode> render_nodes;
-	std::vector<glm::mat4> world_matrices;
+	std::vector<CurrentKeyFrame, pool_allocator<CurrentKeyFrame>> current_keyframes;
+	std::vector<glm::mat4, pool_allocator<glm::mat4>> world_matrices;
 
 	SkeletalModelInstance() = default;
-	explicit SkeletalModelInstance(std::shared_ptr<mdx::MDX> model) : model(model) {
-		size_t node_count = model->bones.size() +
-							model->lights.size() +
-							model->help_bones.size() +
-							model->attachments.size() +
-							model->emitters1.size() +
-							model->emitters2.size() +
-							model->ribbons.size() +
-							model->event_objects.size() +
-							model->collision_shapes.size() +
-							model->corn_emitters.size();
-
-		// ToDo: for each camera: add camera source node to renderNodes
-		render_nodes.resize(node_count);
-		world_matrices.resize(node_count);
-		model->for_each_node([&](mdx::Node& node) {
-			// Seen it happen with Emmitter1, is this an error in the model?
-			// ToDo purge (when adding a validation layer or just crashing)
-			if (node.id == -1) {
-				return;
-			}
-
-			RenderNode renderNode = RenderNode(node, model->pivots[node.id]);
-			if (node.parent_id != -1) {
-				renderNode.parent = &render_nodes[node.parent_id];
-			} else {
-				renderNode.parent = nullptr;
-			}
-
-			render_nodes[node.id] = renderNode;
-		});
+	/// Prefer passing the topology of the owning SkinnedMesh, this builds a new one for just this instance
+	explicit SkeletalModelInstance(std::shared_ptr<mdx::MDX> model)
+		: SkeletalModelInstance(model, std::make_shared<SkeletonTopology>(*model)) {
+	}
 
+	SkeletalModelInstance(std::shared_ptr<mdx::MDX> model, std::shared_ptr<const SkeletonTopology> topology)
+		: model(model), topology(topology) {
+		// ToDo: for each camera: add camera source node
+		world_matrices.resize(topology->node_count);
 		current_keyframes.resize(model->unique_tracks);
 
 		for (size_t i = 0; i < model->sequences.size(); i++) {
@@ -83,6 +105,13 @@ export class SkeletalModelInstance {
 		}
 	}
 
+	/// The heap and inline memory used by this instance
+	size_t memory_usage() const {
+		return sizeof(SkeletalModelInstance)
+			+ current_keyframes.capacity() * sizeof(CurrentKeyFrame)
+			+ world_matrices.capacity() * sizeof(glm::mat4);
+	}
+
 	void update_location(const glm::vec3 position, const glm::quat& rotation, const glm::vec3& scale) {
 		fromRotationTranslationScaleOrigin(rotation, position, scale, matrix, glm::vec3(0, 0, 0));
 	}
@@ -92,11 +121,61 @@ export class SkeletalModelInstance {
 		fromRotationTranslationScaleOrigin(rotation, position, scale, matrix, glm::vec3(0, 0, 0));
 	}
 
-	void update(const double delta) {
+	/// Updates at the rate given by lod, skipped frames only accumulate their delta
+	void update(const double delta, const AnimationLOD lod) {
+		if (advance(delta, lod)) {
+			update_nodes();
+		}
+	}
+
+	/// Advances the animation at the rate given by lod, skipped frames only accumulate their delta.
+	/// Returns whether the skeleton is due for an evaluation with update_nodes()
+	bool advance(const double delta, const AnimationLOD lod) {
+		accumulated_delta += delta;
+
+		if (lod == AnimationLOD::clock_only) {
+			advance_clock(accumulated_delta);
+			accumulated_delta = 0.0;
+			return false;
+		}
+
+		lod_frame += 1;
+		if (lod_frame < static_cast<uint32_t>(lod)) {
+			return false;
+		}
+
+		const bool animating = advance(accumulated_delta);
+		accumulated_delta = 0.0;
+		lod_frame = 0;
+		return animating;
+	}
+
+	/// Only advances the sequence time without evaluating any tracks.
+	/// The keyframe cursors catch up on the next full update as advance_keyframes() scans forward and detects loops
+	void advance_clock(const double delta) {
 		if (model->sequences.empty() || sequence_index == -1) {
 			return;
 		}
 
+		const mdx::Sequence& sequence = model->sequences[sequence_index];
+		current_frame += delta * 1000.0;
+		if (current_frame > sequence.end_frame) {
+			current_frame = sequence.start_frame;
+		}
+	}
+
+	void update(const double delta) {
+		if (advance(delta)) {
+			update_nodes();
+		}
+	}
+
+	/// Advances the current frame and keyframe cursors. Returns false if the instance is not animating
+	bool advance(const double delta) {
+		if (model->sequences.empty() || sequence_index == -1) {
+			return false;
+		}
+
 		// Advance current frame
 		const mdx::Sequence& sequence = model->sequences[sequence_index];
 		//if (sequence.flags & mdx::Sequence::non_looping) {
@@ -108,7 +187,7 @@ export class SkeletalModelInstance {
 			}
 		//}
 
-		for (const auto& i : render_nodes) {
+		for (const auto& i : topology->nodes) {
 			advance_keyframes(i.node->KGTR);
 			advance_keyframes(i.node->KGRT);
 			advance_keyframes(i.node->KGSC);
@@ -126,14 +205,17 @@ export class SkeletalModelInstance {
 			}
 		}
 
-		update_nodes();
+		return true;
 	}
 
 	void update_nodes() {
 		assert(sequence_index >= 0 && sequence_index < model->sequences.size());
 
+		skeletal_evaluations.fetch_add(1, std::memory_order_relaxed);
+
 		// update skeleton to position based on animation @ time
-		for (auto& node : render_nodes) {
+		// The topology is sorted so that parents are always evaluated before their children
+		for (const auto& node : topology->nodes) {
 			// node.position = interpolate_keyframes(node.node->KGTR, TRANSLATION_IDENTITY);
 			// node.rotation = interpolate_keyframes(node.node->KGRT, ROTATION_IDENTITY);
 			// node.scale = interpolate_keyframes(node.node->KGSC, SCALE_IDENTITY);
@@ -144,11 +226,11 @@ export class SkeletalModelInstance {
 
 			fromRotationTranslationScaleOrigin(rotation, position, scale, world_matrices[node.node->id], node.pivot);
 
-			if (node.node->parent_id != -1) {
-				world_matrices[node.node->id] = world_matrices[node.node->parent_id] * world_matrices[node.node->id];
+			if (node.parent != -1) {
+				world_matrices[node.node->id] = world_matrices[node.parent] * world_matrices[node.node->id];
 			}
 
-			if (node.billboarded || node.billboardedX) {
+			if (node.billboarded) {
 
 				world_matrices[node.node->id][1][0] = 0.f;
 				world_matrices[node.node->id][2][0] = 0.f;
@@ -181,7 +263,7 @@ export class SkeletalModelInstance {
 		this->sequence_index = sequence_index;
 		current_frame = model->sequences[sequence_index].start_frame;
 
-		for (const auto& i : render_nodes) {
+		for (const auto& i : topology->nodes) {
 			calculate_sequence_extents(i.node->KGTR);
 			calculate_sequence_extents(i.node->KGRT);
 			calculate_sequence_extents(i.node->KGSC);
@@ -0,0 +1,162 @@
+export module SkeletonBatch;
+
+import std;
+import MDX;
+import MathOperations;
+import SkeletonTopology;
+import SkeletalModelInstance;
+import <glm/glm.hpp>;
+import <glm/gtc/quaternion.hpp>;
+
+// The amount of instances that are evaluated side by side.
+// The per lane loops below have a fixed trip count over contiguous floats so the compiler emits 4 (SSE/NEON) or 8 (AVX2) wide code
+constexpr size_t lanes = 8;
+
+// Affine matrices are stored as 12 floats (4 columns of 3 rows), each float as a row of lanes
+constexpr size_t matrix_floats = 12;
+
+struct alignas(32) Lanes {
+	float v[lanes];
+};
+
+/// Composes the local matrices like fromRotationTranslationScaleOrigin() but for all lanes at once
+void compose_local(
+	const Lanes* rotation,
+	const Lanes* translation,
+	const Lanes* scale,
+	const glm::vec3& pivot,
+	Lanes* out
+) {
+	for (size_t l = 0; l < lanes; l++) {
+		const float x = rotation[0].v[l];
+		const float y = rotation[1].v[l];
+		const float z = rotation[2].v[l];
+		const float w = rotation[3].v[l];
+		const float x2 = x + x;
+		const float y2 = y + y;
+		const float z2 = z + z;
+		const float xx = x * x2;
+		const float xy = x * y2;
+		const float xz = x * z2;
+		const float yy = y * y2;
+		const float yz = y * z2;
+		const float zz = z * z2;
+		const float wx = w * x2;
+		const float wy = w * y2;
+		const float wz = w * z2;
+		const float sx = scale[0].v[l];
+		const float sy = scale[1].v[l];
+		const float sz = scale[2].v[l];
+
+		const float m00 = (1 - (yy + zz)) * sx;
+		const float m01 = (xy + wz) * sy;
+		const float m02 = (xz - wy) * sz;
+		const float m10 = (xy - wz) * sx;
+		const float m11 = (1 - (xx + zz)) * sy;
+		const float m12 = (yz + wx) * sz;
+		const float m20 = (xz + wy) * sx;
+		const float m21 = (yz - wx) * sy;
+		const float m22 = (1 - (xx + yy)) * sz;
+
+		out[0].v[l] = m00;
+		out[1].v[l] = m01;
+		out[2].v[l] = m02;
+		out[3].v[l] = m10;
+		out[4].v[l] = m11;
+		out[5].v[l] = m12;
+		out[6].v[l] = m20;
+		out[7].v[l] = m21;
+		out[8].v[l] = m22;
+		out[9].v[l] = translation[0].v[l] + pivot.x - (m00 * pivot.x + m10 * pivot.y + m20 * pivot.z);
+		out[10].v[l] = translation[1].v[l] + pivot.y - (m01 * pivot.x + m11 * pivot.y + m21 * pivot.z);
+		out[11].v[l] = translation[2].v[l] + pivot.z - (m02 * pivot.x + m12 * pivot.y + m22 * pivot.z);
+	}
+}
+
+/// out = parent * local for all lanes. out may not alias parent or local
+void multiply_affine(const Lanes* parent, const Lanes* local, Lanes* out) {
+	for (size_t column = 0; column < 4; column++) {
+		for (size_t row = 0; row < 3; row++) {
+			for (size_t l = 0; l < lanes; l++) {
+				float value = parent[row].v[l] * local[column * 3].v[l]
+							+ parent[3 + row].v[l] * local[column * 3 + 1].v[l]
+							+ parent[6 + row].v[l] * local[column * 3 + 2].v[l];
+				if (column == 3) {
+					value += parent[9 + row].v[l];
+				}
+				out[column * 3 + row].v[l] = value;
+			}
+		}
+	}
+}
+
+/// Evaluates the skeletons of several instances of the same model at once, equivalent to calling update_nodes() on each of them.
+/// The instances must have been advanced and be animating (sequence_index != -1)
+export void update_nodes_batched(const SkeletonTopology& topology, const std::span<SkeletalModelInstance* const> instances) {
+	// The world matrices of a block of instances in SoA layout, reused between calls
+	thread_local std::vector<Lanes> world;
+	world.resize(topology.node_count * matrix_floats);
+
+	Lanes rotation[4];
+	Lanes translation[3];
+	Lanes scale[3];
+	Lanes local[matrix_floats];
+
+	for (size_t block = 0; block < instances.size(); block += lanes) {
+		const size_t count = std::min(lanes, instances.size() - block);
+		SkeletalModelInstance::skeletal_evaluations.fetch_add(count, std::memory_order_relaxed);
+
+		for (const auto& node : topology.nodes) {
+			// Keyframe interpolation depends on the per instance cursors, so gather it lane by lane
+			for (size_t l = 0; l < lanes; l++) {
+				glm::vec3 t = TRANSLATION_IDENTITY;
+				glm::quat r = ROTATION_IDENTITY;
+				glm::vec3 s = SCALE_IDENTITY;
+				if (l < count) {
+					const SkeletalModelInstance& instance = *instances[block + l];
+					t = instance.interpolate_keyframes(node.node->KGTR, TRANSLATION_IDENTITY);
+					r = instance.interpolate_keyframes(node.node->KGRT, ROTATION_IDENTITY);
+					s = instance.interpolate_keyframes(node.node->KGSC, SCALE_IDENTITY);
+				}
+				translation[0].v[l] = t.x;
+				translation[1].v[l] = t.y;
+				translation[2].v[l] = t.z;
+				rotation[0].v[l] = r.x;
+				rotation[1].v[l] = r.y;
+				rotation[2].v[l] = r.z;
+				rotation[3].v[l] = r.w;
+				scale[0].v[l] = s.x;
+				scale[1].v[l] = s.y;
+				scale[2].v[l] = s.z;
+			}
+
+			Lanes* node_world = &world[node.node->id * matrix_floats];
+			if (node.parent == -1) {
+				compose_local(rotation, translation, scale, node.pivot, node_world);
+			} else {
+				compose_local(rotation, translation, scale, node.pivot, local);
+				multiply_affine(&world[node.parent * matrix_floats], local, node_world);
+			}
+
+			// Only keep the diagonal, the same as update_nodes()
+			if (node.billboarded) {
+				for (const size_t i : { 1, 2, 3, 5, 6, 7, 9, 10, 11 }) {
+					for (size_t l = 0; l < lanes; l++) {
+						node_world[i].v[l] = 0.f;
+					}
+				}
+			}
+
+			// Scatter back to the per instance matrices which are consumed by the renderer
+			for (size_t l = 0; l < count; l++) {
+				glm::mat4& matrix = instances[block + l]->world_matrices[node.node->id];
+				for (size_t column = 0; column < 4; column++) {
+					matrix[column][0] = node_world[column * 3].v[l];
+					matrix[column][1] = node_world[column * 3 + 1].v[l];
+					matrix[column][2] = node_world[column * 3 + 2].v[l];
+					matrix[column][3] = column == 3 ? 1.f : 0.f;
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
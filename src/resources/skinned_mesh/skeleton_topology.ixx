@@ -0,0 +1,83 @@
+export module SkeletonTopology;
+
+import std;
+import MDX;
+import <glm/glm.hpp>;
+
+/// The node hierarchy of a model, computed once per model and shared by all of its instances
+export struct SkeletonTopology {
+	struct Node {
+		const mdx::Node* node;
+		int parent; // -1 if this is a root node
+		glm::vec3 pivot;
+		bool billboarded;
+	};
+
+	/// Sorted so that every parent comes before its children
+	std::vector<Node> nodes;
+	/// The number of world matrices an instance needs, indexed by node id
+	size_t node_count = 0;
+
+	SkeletonTopology() = default;
+	explicit SkeletonTopology(mdx::MDX& model) {
+		node_count = model.bones.size() +
+					 model.lights.size() +
+					 model.help_bones.size() +
+					 model.attachments.size() +
+					 model.emitters1.size() +
+					 model.emitters2.size() +
+					 model.ribbons.size() +
+					 model.event_objects.size() +
+					 model.collision_shapes.size() +
+					 model.corn_emitters.size();
+
+		std::vector<const mdx::Node*> by_id(node_count, nullptr);
+		model.for_each_node([&](mdx::Node& node) {
+			// Seen it happen with Emmitter1, is this an error in the model?
+			if (node.id < 0 || static_cast<size_t>(node.id) >= node_count) {
+				return;
+			}
+			by_id[node.id] = &node;
+		});
+
+		const auto valid_parent = [&](const mdx::Node& node) {
+			return node.parent_id >= 0 && static_cast<size_t>(node.parent_id) < node_count && by_id[node.parent_id];
+		};
+
+		// The depth of a node is the length of its parent chain, sorting on it places parents before children
+		std::vector<int> depths(node_count, -1);
+		const auto depth_of = [&](size_t id) {
+			size_t depth = 0;
+			const mdx::Node* current = by_id[id];
+			while (valid_parent(*current)) {
+				current = by_id[current->parent_id];
+				depth += 1;
+
+				// Malformed models can contain cycles
+				if (depth > node_count) {
+					break;
+				}
+			}
+			return static_cast<int>(depth);
+		};
+
+		for (size_t i = 0; i < node_count; i++) {
+			if (!by_id[i]) {
+				continue;
+			}
+			depths[i] = depth_of(i);
+
+			const mdx::Node& node = *by_id[i];
+			nodes.push_back(Node {
+				.node = &node,
+				.parent = valid_parent(node) ? node.parent_id : -1,
+				.pivot = model.pivots[node.id],
+				.billboarded = (node.flags & mdx::Node::Flags::billboarded) || (node.flags & mdx::Node::Flags::billboarded_lock_x),
+			});
+		}
+
+		std::stable_sort(nodes.begin(), nodes.end(), [&](const Node& left, const Node& right) {
+			return depths[left.node->id] < depths[right.node->id];
+		});
+	}
+};
\ No newline at end of file
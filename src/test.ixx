@@ -1,10 +1,42 @@
+module;
+
+#include <cassert>
+
 export module test;
 
 import std;
+import types;
 import BinaryReader;
 import MDX;
 import no_init_allocator;
+import SkeletalModelInstance;
+import SkeletonTopology;
+import SkeletonBatch;
+import DrawCommands;
+import GPUBuffer;
+import TerrainChunks;
+import Visibility;
+import FrameArena;
+import Camera;
+import Picking;
+import HeightfieldRay;
+import Profiler;
+import PathingTexture;
+import PathingMap;
+import Walkability;
+import Pathfinding;
+import Terrain;
+import UndoDelta;
+import Triggers;
+import Units;
+import JassChecker;
+import RenderManager;
+import SkinnedMesh;
+import <ankerl/unordered_dense.h>;
 import <glm/glm.hpp>;
+import <glad/glad.h>;
+import "bullet/BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h";
+import "btBulletDynamicsCommon.h";
 
 namespace fs = std::filesystem;
 
@@ -39,10 +71,1592 @@ void parse_all_mdx() {
 	});
 }
 
+// Compares evaluating 10k skeletons one by one against evaluating them in batches
+void benchmark_skeleton_update(const fs::path& path) {
+	std::ifstream stream(path, std::ios::binary);
+	auto buffer = std::vector<uint8_t, default_init_allocator<uint8_t>>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+	BinaryReader reader(buffer);
+	auto mdx = std::make_shared<mdx::MDX>(reader);
+	auto topology = std::make_shared<SkeletonTopology>(*mdx);
+
+	std::vector<SkeletalModelInstance> instances;
+	for (size_t i = 0; i < 10'000; i++) {
+		instances.emplace_back(mdx, topology);
+		instances.back().update(i * 0.001);
+	}
+
+	std::vector<SkeletalModelInstance*> pointers;
+	for (auto& i : instances) {
+		pointers.push_back(&i);
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	for (auto& i : instances) {
+		i.update_nodes();
+	}
+	auto scalar = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	begin = std::chrono::steady_clock::now();
+	update_nodes_batched(*topology, pointers);
+	auto batched = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	std::print("[INFO] 10k skeletons of {} with {} nodes: {}ms one by one, {}ms batched\n", path.string(), topology->nodes.size(), scalar, batched);
+}
+
+/// Stands in for OpenGLBufferBackend and records what the buffers ask of it. Fences are numbered from 1 in the order they are created
+struct FakeBufferBackend {
+	struct Write {
+		GLuint buffer;
+		size_t offset;
+		size_t size;
+	};
+
+	enum class Event {
+		wait,
+		delete_fence,
+	};
+
+	static inline GLuint next_buffer = 1;
+	static inline size_t next_fence = 1;
+	static inline std::set<GLuint> live_buffers;
+	static inline std::set<size_t> live_fences;
+	static inline std::unordered_map<GLuint, std::vector<std::byte>> mappings;
+	static inline std::vector<size_t> allocations;
+	static inline std::vector<Write> writes;
+	static inline std::vector<std::pair<Event, size_t>> fence_events;
+
+	static void reset() {
+		live_buffers.clear();
+		live_fences.clear();
+		mappings.clear();
+		allocations.clear();
+		writes.clear();
+		fence_events.clear();
+	}
+
+	static GLuint create() {
+		live_buffers.insert(next_buffer);
+		return next_buffer++;
+	}
+
+	static void destroy(const GLuint buffer) {
+		const size_t erased = live_buffers.erase(buffer);
+		assert(erased == 1);
+		mappings.erase(buffer);
+	}
+
+	static void allocate(const GLuint buffer, const size_t size) {
+		assert(live_buffers.contains(buffer));
+		allocations.push_back(size);
+	}
+
+	static void write(const GLuint buffer, const size_t offset, const size_t size, const void*) {
+		assert(live_buffers.contains(buffer));
+		writes.push_back({ buffer, offset, size });
+	}
+
+	static void* allocate_persistent(const GLuint buffer, const size_t size) {
+		assert(live_buffers.contains(buffer));
+		allocations.push_back(size);
+		auto& mapping = mappings[buffer];
+		mapping.resize(size);
+		return mapping.data();
+	}
+
+	static GLsync fence() {
+		live_fences.insert(next_fence);
+		return reinterpret_cast<GLsync>(next_fence++);
+	}
+
+	static void wait(const GLsync fence) {
+		assert(live_fences.contains(reinterpret_cast<size_t>(fence)));
+		fence_events.emplace_back(Event::wait, reinterpret_cast<size_t>(fence));
+	}
+
+	static void delete_fence(const GLsync fence) {
+		const size_t erased = live_fences.erase(reinterpret_cast<size_t>(fence));
+		assert(erased == 1);
+		fence_events.emplace_back(Event::delete_fence, reinterpret_cast<size_t>(fence));
+	}
+
+	static size_t storage_offset_alignment() {
+		return 256;
+	}
+};
+
+// Runs the buffers of GPUBuffer against FakeBufferBackend: growth, dirty range uploads, region rotation and fencing of the stream buffer
+void test_gpu_buffers() {
+	FakeBufferBackend::reset();
+	{
+		GrowableBuffer<FakeBufferBackend> buffer;
+		for (const size_t size : { 100, 256, 300, 385, 400, 1000 }) {
+			buffer.reserve(size);
+			assert(buffer.capacity >= size);
+		}
+		// Never less than 256 bytes and 1.5x the previous capacity, unless more is asked for
+		assert((FakeBufferBackend::allocations == std::vector<size_t>{ 256, 384, 576, 1000 }));
+	}
+	assert(FakeBufferBackend::live_buffers.empty());
+
+	FakeBufferBackend::reset();
+	{
+		RetainedBuffer<u32, FakeBufferBackend> buffer;
+		std::vector<u32> data(100);
+		std::iota(data.begin(), data.end(), 0);
+
+		const auto last_write_was = [](const size_t offset, const size_t size) {
+			const auto write = FakeBufferBackend::writes.back();
+			return write.offset == offset && write.size == size;
+		};
+
+		size_t written = buffer.upload(data);
+		assert(written == 400 && last_write_was(0, 400));
+		written = buffer.upload(data);
+		assert(written == 0 && FakeBufferBackend::writes.size() == 1);
+
+		// Only the range from the first to the last changed element is rewritten
+		data[10] = 1000;
+		data[20] = 1000;
+		written = buffer.upload(data);
+		assert(written == 44 && last_write_was(40, 44));
+
+		// Growing reallocates, which loses the contents, so everything is written again
+		data.push_back(100);
+		written = buffer.upload(data);
+		assert(written == 404 && last_write_was(0, 404));
+
+		// Elements past the end of the previous upload are always written
+		data.resize(50);
+		written = buffer.upload(data);
+		assert(written == 0);
+		data.resize(60, 7);
+		written = buffer.upload(data);
+		assert(written == 40 && last_write_was(200, 40));
+	}
+
+	FakeBufferBackend::reset();
+	{
+		using Stream = StreamBuffer<FakeBufferBackend>;
+		Stream buffer;
+		const std::array<std::byte, 100> bytes = {};
+
+		// Fence of the frame that last used each region
+		std::array<size_t, Stream::frames_in_flight> region_fences = {};
+		size_t region_size = 0;
+		size_t previous_region = 0;
+		for (size_t frame = 0; frame < 9; frame++) {
+			const size_t events = FakeBufferBackend::fence_events.size();
+			buffer.begin_frame();
+
+			const Stream::Range first = buffer.write(bytes.data(), bytes.size());
+			const Stream::Range second = buffer.write(bytes.data(), 0);
+			if (frame == 0) {
+				region_size = FakeBufferBackend::allocations.back() / Stream::frames_in_flight;
+			}
+
+			assert(first.offset % 256 == 0 && first.size == 256);
+			assert(second.offset == first.offset + 256 && second.size == 256);
+
+			const size_t region = first.offset / region_size;
+			assert(frame == 0 || region == (previous_region + 1) % Stream::frames_in_flight);
+			previous_region = region;
+
+			// The fence of the frame that used this region before is waited on and only then deleted
+			if (region_fences[region] != 0) {
+				const std::vector<std::pair<FakeBufferBackend::Event, size_t>> expected = {
+					{ FakeBufferBackend::Event::wait, region_fences[region] },
+					{ FakeBufferBackend::Event::delete_fence, region_fences[region] },
+				};
+				assert(std::equal(FakeBufferBackend::fence_events.begin() + events, FakeBufferBackend::fence_events.end(), expected.begin(), expected.end()));
+			} else {
+				assert(FakeBufferBackend::fence_events.size() == events);
+			}
+
+			buffer.end_frame();
+			region_fences[region] = FakeBufferBackend::next_fence - 1;
+		}
+		assert(FakeBufferBackend::live_fences.size() == Stream::frames_in_flight);
+
+		// Outgrowing a region while the other regions are in flight moves to a new buffer.
+		// Its regions were never used, so the old fences are dropped without waiting and the old buffer lives until the next frame
+		buffer.begin_frame();
+		const Stream::Range small = buffer.write(bytes.data(), bytes.size());
+		const std::vector<std::byte> large(region_size, std::byte(1));
+		const size_t events = FakeBufferBackend::fence_events.size();
+		const Stream::Range grown = buffer.write(large.data(), large.size());
+
+		assert(grown.buffer != small.buffer);
+		assert(FakeBufferBackend::allocations.back() == 2 * region_size * Stream::frames_in_flight);
+		assert(FakeBufferBackend::live_fences.empty());
+		assert(std::ranges::none_of(std::span(FakeBufferBackend::fence_events).subspan(events), [](const auto& event) {
+			return event.first == FakeBufferBackend::Event::wait;
+		}));
+		assert(FakeBufferBackend::live_buffers.contains(small.buffer));
+		assert(std::ranges::all_of(std::span(FakeBufferBackend::mappings[grown.buffer]).subspan(grown.offset, region_size), [](const std::byte byte) {
+			return byte == std::byte(1);
+		}));
+
+		buffer.end_frame();
+		buffer.begin_frame();
+		assert(!FakeBufferBackend::live_buffers.contains(small.buffer));
+		buffer.end_frame();
+	}
+	assert(FakeBufferBackend::live_buffers.empty() && FakeBufferBackend::live_fences.empty());
+
+	std::print("[INFO] GPU buffers: growth, dirty ranges and stream buffer fencing behave\n");
+}
+
+// Checks that sorting keeps the layers of a material in order and merges draws with the same state
+void test_draw_command_sorting() {
+	DrawCommandList list;
+	for (uint32_t i = 0; i < 1000; i++) {
+		const PipelineState state = {
+			.layer = i % 3 == 0 ? 1u : 0u,
+			.hd = i % 2 == 0,
+			.two_sided = i % 5 == 0,
+		};
+		list.add(state, { .count = 3, .instance_count = 1, .first_index = i, .base_vertex = 0, .base_instance = 0 }, {});
+	}
+	list.sort();
+
+	size_t draws = 0;
+	for (size_t i = 0; i < list.groups.size(); i++) {
+		const auto& group = list.groups[i];
+		draws += group.count;
+		for (size_t j = group.first; j < group.first + group.count; j++) {
+			assert(list.states[j] == group.state);
+			// Stable within a group
+			assert(j == group.first || list.commands[j - 1].first_index < list.commands[j].first_index);
+		}
+		assert(i == 0 || list.groups[i - 1].state.layer <= group.state.layer);
+	}
+	assert(draws == 1000);
+	assert(list.groups.size() == 8);
+
+	std::print("[INFO] 1000 draws sorted into {} groups\n", list.groups.size());
+}
+
+// Culls a 100x70 tile terrain against the half space x < 40
+void test_terrain_chunk_culling() {
+	const int tiles_x = 100;
+	const int tiles_y = 70;
+	const size_t corner_count = (tiles_x + 1) * (tiles_y + 1);
+	std::vector<float> ground_heights(corner_count, 0.f);
+	std::vector<float> water_heights(corner_count, 0.f);
+	std::vector<uint32_t> water_exists(corner_count, 0);
+	water_exists[5 * (tiles_x + 1) + 5] = 1;
+
+	TerrainChunks chunks;
+	chunks.resize(tiles_x, tiles_y);
+	chunks.update({ 0, 0 }, { tiles_x - 1, tiles_y - 1 }, ground_heights, water_heights, water_exists, 0.f);
+
+	std::vector<glm::ivec2> ground;
+	std::vector<glm::ivec2> water;
+	chunks.cull([](const glm::vec3& min, const glm::vec3&) { return min.x < 40.f; }, ground, water);
+
+	assert(chunks.chunks.size() == 12);
+	assert(ground.size() == 6);
+	assert(water.size() == 1 && water.front() == glm::ivec2(0, 0));
+
+	// Raising a corner on a chunk border grows both chunks
+	ground_heights[32 * (tiles_x + 1) + 32] = 5.f;
+	chunks.update({ 31, 31 }, { 32, 32 }, ground_heights, water_heights, water_exists, 0.f);
+	assert(chunks.chunks[0].ground_max.z == 5.f);
+	assert(chunks.chunks[chunks.chunks_x + 1].ground_max.z == 5.f);
+	assert(chunks.chunks[2].ground_max.z == 0.f);
+
+	std::print("[INFO] Terrain chunk culling kept {} of {} chunks\n", ground.size(), chunks.chunks.size());
+}
+
+// Compares testing 50k objects one by one with Camera::inside_frustrum against the batched visibility pass
+void benchmark_visibility() {
+	Camera test_camera;
+	test_camera.position = glm::vec3(128.f, 128.f, 0.f);
+	test_camera.update(0.0);
+
+	// Objects of 1x1x2 spread over a 256x256 map
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> distribution(0.f, 256.f);
+	std::vector<glm::vec3> minimums;
+	std::vector<glm::vec3> maximums;
+	for (size_t i = 0; i < 50'000; i++) {
+		const glm::vec3 position = { distribution(generator), distribution(generator), 0.f };
+		minimums.push_back(position - glm::vec3(0.5f, 0.5f, 0.f));
+		maximums.push_back(position + glm::vec3(0.5f, 0.5f, 2.f));
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	std::vector<uint8_t> expected(minimums.size());
+	for (size_t i = 0; i < minimums.size(); i++) {
+		expected[i] = test_camera.inside_frustrum(minimums[i], maximums[i]);
+	}
+	auto scalar = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	begin = std::chrono::steady_clock::now();
+	VisibilitySet visibility;
+	visibility.update(std::span<const glm::vec4>(test_camera.frustum_planes, 5), minimums.size(), [&](const size_t index, glm::vec3& min, glm::vec3& max) {
+		min = minimums[index];
+		max = maximums[index];
+		return true;
+	});
+	auto batched = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	// Boxes right on a plane may round differently, these are rare enough to ignore
+	size_t mismatches = 0;
+	size_t visited = 0;
+	for (size_t i = 0; i < minimums.size(); i++) {
+		mismatches += visibility.visible(i) != static_cast<bool>(expected[i]);
+	}
+	visibility.for_each_visible(0, minimums.size(), [&](const size_t index) {
+		assert(visibility.visible(index));
+		visited += 1;
+	});
+	assert(mismatches < 10);
+	assert(visited == visibility.visible_count());
+
+	std::print("[INFO] 50k objects, {} visible: {}ms one by one, {}ms batched\n", visited, scalar, batched);
+}
+
+// Compares std::sort on distance against the radix sort on transparent_sort_key() for 5k to 50k transparent instances
+void benchmark_transparent_sort() {
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> distances(1.f, 100.f);
+	std::uniform_int_distribution<uint32_t> meshes(0, 200);
+
+	RadixSort radix;
+	for (const size_t count : { 5'000, 20'000, 50'000 }) {
+		std::vector<std::pair<float, uint32_t>> instances;
+		for (size_t i = 0; i < count; i++) {
+			instances.push_back({ distances(generator), meshes(generator) });
+		}
+
+		auto sorted = instances;
+		auto begin = std::chrono::steady_clock::now();
+		std::sort(sorted.begin(), sorted.end(), [](const auto& left, const auto& right) { return left.first > right.first; });
+		auto comparison = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+		std::vector<uint64_t> keys;
+		std::vector<uint32_t> order;
+		begin = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; i++) {
+			keys.push_back(transparent_sort_key(instances[i].first, instances[i].second));
+			order.push_back(static_cast<uint32_t>(i));
+		}
+		radix.sort(keys, order);
+		auto radix_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+		size_t runs = 0;
+		for (size_t i = 0; i < count; i++) {
+			assert(i == 0 || keys[i - 1] <= keys[i]);
+			// Back to front, up to the quantization of the key
+			assert(i == 0 || instances[order[i - 1]].first * 1.001f >= instances[order[i]].first);
+			runs += i == 0 || keys[i - 1] != keys[i];
+		}
+
+		std::print("[INFO] {} transparent instances: {}ms std::sort, {}ms radix sort, {} runs\n", count, comparison, radix_time, runs);
+	}
+}
+
+/// Counts the allocations that reach the heap
+class CountingResource : public std::pmr::memory_resource {
+  public:
+	size_t allocations = 0;
+
+  protected:
+	void* do_allocate(const size_t bytes, const size_t alignment) override {
+		allocations += 1;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* pointer, const size_t bytes, const size_t alignment) override {
+		std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+// Counts the calls of the global operator new while counting_allocations is set, for the checks that a warm frame doesn't allocate outside of the frame arena either.
+// Replacing them applies to the whole program, outside of the tests they only add a relaxed load
+std::atomic<bool> counting_allocations = false;
+std::atomic<size_t> counted_allocations = 0;
+
+void count_allocation() {
+	if (counting_allocations.load(std::memory_order_relaxed)) {
+		counted_allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void* operator new(const std::size_t size) {
+	count_allocation();
+	if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+// Over-aligned blocks keep the pointer malloc returned right in front of them
+void* operator new(const std::size_t size, const std::align_val_t alignment) {
+	count_allocation();
+	const size_t align = static_cast<size_t>(alignment);
+	void* base = std::malloc(size + align + sizeof(void*));
+	if (!base) {
+		throw std::bad_alloc();
+	}
+	const std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(base) + sizeof(void*) + align - 1) & ~(align - 1);
+	reinterpret_cast<void**>(aligned)[-1] = base;
+	return reinterpret_cast<void*>(aligned);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+	if (pointer) {
+		std::free(static_cast<void**>(pointer)[-1]);
+	}
+}
+
+void operator delete(void* pointer, std::size_t, const std::align_val_t alignment) noexcept {
+	operator delete(pointer, alignment);
+}
+
+// Fills arena backed lists the way RenderManager fills its render lists and checks that once warmed up the arena no longer reaches its upstream.
+// Then runs the CPU side of a frame with the containers RenderManager and Map keep between frames and checks that a warm frame doesn't call the global operator new at all
+void test_frame_arena() {
+	CountingResource heap;
+	FrameArena arena(&heap);
+
+	size_t warm_allocations = 0;
+	for (size_t frame = 0; frame < 10; frame++) {
+		arena.reset();
+		if (frame == 2) {
+			warm_allocations = heap.allocations;
+		}
+
+		// Grown one element at a time on purpose, the arena has to absorb the reallocations
+		std::pmr::vector<glm::mat4> render_jobs(&arena);
+		std::pmr::vector<glm::vec3> render_colors(&arena);
+		std::pmr::vector<glm::vec4> layer_colors(&arena);
+		for (size_t i = 0; i < 5'000; i++) {
+			render_jobs.push_back(glm::mat4(1.f));
+			render_colors.push_back(glm::vec3(1.f));
+			layer_colors.push_back(glm::vec4(1.f));
+			layer_colors.push_back(glm::vec4(1.f));
+		}
+	}
+
+	assert(heap.allocations == warm_allocations);
+	assert(arena.peak >= 5'000 * (sizeof(glm::mat4) + sizeof(glm::vec3) + 2 * sizeof(glm::vec4)));
+	assert(arena.capacity() >= arena.peak);
+
+	std::print("[INFO] Frame arena: {} upstream allocations while warming up, none after, {} KiB peak\n", warm_allocations, arena.peak / 1024);
+
+	// The meshes are only compared, never dereferenced
+	constexpr size_t instance_count = 20'000;
+	constexpr size_t mesh_count = 200;
+	std::vector<std::byte> mesh_storage(mesh_count);
+	const auto mesh = [&](const size_t i) {
+		return reinterpret_cast<SkinnedMesh*>(mesh_storage.data() + i % mesh_count);
+	};
+	std::vector<SkeletalModelInstance> skeletons(instance_count);
+
+	ankerl::unordered_dense::map<SkinnedMesh*, std::vector<SkeletalModelInstance*>> skeleton_batches;
+	DrawCommandList opaque_draws;
+	RadixSort transparent_sort;
+	std::vector<u64> transparent_keys;
+	std::vector<uint32_t> transparent_order;
+
+	std::mt19937 generator(3);
+	std::uniform_real_distribution<float> distances(1.f, 100.f);
+	for (size_t frame = 0; frame < 10; frame++) {
+		if (frame == 3) {
+			counted_allocations = 0;
+			counting_allocations = true;
+		}
+		frame_arena().reset();
+
+		// Map::render() gathers the visible objects and RenderManager::queue_visible() groups them per mesh
+		frame_vector<RenderManager::QueuedInstance> render_queue;
+		render_queue.reserve(instance_count);
+		for (size_t i = 0; i < instance_count; i++) {
+			render_queue.push_back({ mesh(i * 7 + frame), &skeletons[i], glm::vec3(1.f) });
+		}
+		RenderManager::group_by_mesh(render_queue);
+
+		// Map::update() batches the skeleton evaluations per mesh
+		for (auto& [key, batch] : skeleton_batches) {
+			batch.clear();
+		}
+		for (size_t i = 0; i < instance_count; i += 2) {
+			skeleton_batches[mesh(i)].push_back(&skeletons[i]);
+		}
+		std::atomic<size_t> batched = 0;
+		std::for_each(std::execution::par, skeleton_batches.begin(), skeleton_batches.end(), [&](auto& entry) {
+			batched += entry.second.size();
+		});
+		assert(batched == instance_count / 2);
+
+		// RenderManager::render() sorts the opaque draws on their state and the transparent instances back to front
+		opaque_draws.clear();
+		for (uint32_t i = 0; i < 3'000; i++) {
+			opaque_draws.add({ .layer = (i + static_cast<uint32_t>(frame)) % 3, .hd = i % 2 == 0 }, { .count = 3, .instance_count = 1, .first_index = i, .base_vertex = 0, .base_instance = 0 }, {});
+		}
+		opaque_draws.sort();
+
+		transparent_keys.clear();
+		transparent_order.clear();
+		for (size_t i = 0; i < 5'000; i++) {
+			transparent_keys.push_back(transparent_sort_key(distances(generator), static_cast<uint32_t>(i % mesh_count)));
+			transparent_order.push_back(static_cast<uint32_t>(i));
+		}
+		transparent_sort.sort(transparent_keys, transparent_order);
+
+		release(render_queue);
+	}
+	counting_allocations = false;
+	const size_t frame_allocations = counted_allocations;
+
+	assert(frame_allocations == 0);
+	std::print("[INFO] Warm frames: {} calls of operator new over 7 frames\n", frame_allocations);
+}
+
+// Checks the triangle BVH against testing every triangle, the posed query against a moved bone and the early out of pick_nearest
+void test_picking() {
+	// 16x16 unit boxes with a gap of 1 between them, 12 triangles each
+	constexpr uint16_t box_faces[] = { 0, 1, 3, 0, 3, 2, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4, 2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 3, 7, 1, 7, 5 };
+	std::vector<glm::vec3> vertices;
+	std::vector<uint16_t> faces;
+	for (int y = 0; y < 16; y++) {
+		for (int x = 0; x < 16; x++) {
+			const uint16_t base = static_cast<uint16_t>(vertices.size());
+			for (int corner = 0; corner < 8; corner++) {
+				vertices.push_back(glm::vec3(x * 2 + (corner & 1), y * 2 + ((corner >> 1) & 1), (corner >> 2) & 1));
+			}
+			for (const auto i : box_faces) {
+				faces.push_back(base + i);
+			}
+		}
+	}
+	// Every vertex fully weighted to bone 0
+	std::vector<uint8_t> skin;
+	for (size_t i = 0; i < vertices.size(); i++) {
+		skin.insert(skin.end(), { 0, 0, 0, 0, 255, 0, 0, 0 });
+	}
+
+	PickingMesh mesh;
+	mesh.add_geoset(vertices, faces, skin, 0);
+	mesh.build();
+	assert(mesh.triangle_count() == 16 * 16 * 12);
+
+	const auto all_visible = [](const uint32_t) {
+		return true;
+	};
+
+	const auto brute_force = [&](const glm::vec3& origin, const glm::vec3& direction) {
+		std::optional<float> nearest;
+		for (size_t i = 0; i < faces.size(); i += 3) {
+			const auto distance = ray_triangle_distance(origin, direction, vertices[faces[i]], vertices[faces[i + 1]], vertices[faces[i + 2]]);
+			if (distance && (!nearest || *distance < *nearest)) {
+				nearest = distance;
+			}
+		}
+		return nearest;
+	};
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> coordinates(-4.f, 36.f);
+	std::vector<std::pair<glm::vec3, glm::vec3>> rays;
+	for (size_t i = 0; i < 1'000; i++) {
+		const glm::vec3 origin = { coordinates(generator), coordinates(generator), 20.f };
+		const glm::vec3 target = { coordinates(generator), coordinates(generator), 0.f };
+		rays.push_back({ origin, glm::normalize(target - origin) });
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	std::vector<std::optional<float>> expected;
+	for (const auto& [origin, direction] : rays) {
+		expected.push_back(brute_force(origin, direction));
+	}
+	auto brute_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	begin = std::chrono::steady_clock::now();
+	size_t hits = 0;
+	for (size_t i = 0; i < rays.size(); i++) {
+		const auto distance = mesh.intersect(rays[i].first, rays[i].second, all_visible);
+		// The same triangle is tested with the same function, so the results match exactly
+		assert(distance == expected[i]);
+		hits += distance.has_value();
+	}
+	auto bvh_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	// Straight down on the first box, which is 1 high
+	const glm::vec3 down_origin = { 0.5f, 0.5f, 20.f };
+	const glm::vec3 down = { 0.f, 0.f, -1.f };
+	assert(mesh.intersect(down_origin, down, all_visible) == 19.f);
+	assert(!mesh.intersect(down_origin, down, [](const uint32_t) { return false; }));
+
+	// Raising the bone by 10 should bring the hit 10 closer, the refitted bounds must not cull it
+	glm::mat4 raised(1.f);
+	raised[3] = glm::vec4(0.f, 0.f, 10.f, 1.f);
+	const std::vector<glm::mat4> bones = { raised };
+	assert(mesh.intersect_posed(down_origin, down, bones, all_visible) == 9.f);
+	// And the scratch space is reused without leaking the previous pose
+	assert(mesh.intersect_posed(down_origin, down, bones, all_visible) == 9.f);
+
+	// Three boxes along the x axis, the middle one is missed by the exact test
+	const std::vector<float> box_x = { 10.f, 20.f, 30.f };
+	size_t exact_tests = 0;
+	const auto nearest = pick_nearest(
+		glm::vec3(0.f, 0.5f, 0.5f),
+		glm::vec3(1.f, 0.f, 0.f),
+		box_x.size() + 1,
+		[&](const size_t i, glm::vec3& min, glm::vec3& max) {
+			if (i == box_x.size()) {
+				return false;
+			}
+			min = glm::vec3(box_x[i], 0.f, 0.f);
+			max = glm::vec3(box_x[i] + 1.f, 1.f, 1.f);
+			return true;
+		},
+		[&](const size_t i) -> std::optional<float> {
+			exact_tests += 1;
+			if (i == 0) {
+				return {};
+			}
+			return box_x[i];
+		}
+	);
+	assert(nearest && nearest->first == 1 && nearest->second == 20.f);
+	// The box at 30 starts behind the hit at 20 and is never tested exactly
+	assert(exact_tests == 2);
+
+	std::print("[INFO] Picking {} rays against {} triangles, {} hits: {}ms brute force, {}ms BVH\n", rays.size(), mesh.triangle_count(), hits, brute_time, bvh_time);
+}
+
+// Compares the heightfield ray march with a Bullet rayTest against the same heights on random rays
+void test_heightfield_ray() {
+	constexpr int width = 129;
+	constexpr int height = 129;
+
+	// Rolling ground on blocks of cliff levels with a raised ramp corner here and there, like final_ground_heights
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+	std::vector<float> heights(width * height);
+	for (int j = 0; j < height; j++) {
+		for (int i = 0; i < width; i++) {
+			const int layer = (i / 8 + j / 8) % 3;
+			const float ramp = (i % 8 == 0 && j % 16 == 0) ? 0.5f : 0.f;
+			heights[j * width + i] = noise(generator) + layer + ramp;
+		}
+	}
+
+	// Flipped quad edges so Bullet splits the tiles along the same diagonal as terrain.vert
+	btHeightfieldTerrainShape shape(width, height, heights.data(), 0, -16.f, 16.f, 2, PHY_FLOAT, true);
+	btCollisionObject object;
+	object.setCollisionShape(&shape);
+	object.getWorldTransform().setOrigin(btVector3(width / 2.f - 0.5f, height / 2.f - 0.5f, 0.f));
+
+	btDefaultCollisionConfiguration configuration;
+	btCollisionDispatcher dispatcher(&configuration);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher, &broadphase, &configuration);
+	world.addCollisionObject(&object);
+
+	// Camera like rays from above, some starting outside of the map and some at a grazing angle
+	std::uniform_real_distribution<float> coordinates(-20.f, width + 20.f);
+	std::uniform_real_distribution<float> elevations(5.f, 40.f);
+	std::vector<std::pair<glm::vec3, glm::vec3>> rays;
+	for (size_t i = 0; i < 10'000; i++) {
+		const glm::vec3 origin = { coordinates(generator), coordinates(generator), elevations(generator) };
+		const glm::vec3 target = { coordinates(generator), coordinates(generator), 0.f };
+		rays.push_back({ origin, glm::normalize(target - origin) });
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	std::vector<std::optional<glm::vec3>> expected;
+	for (const auto& [origin, direction] : rays) {
+		const glm::vec3 end = origin + direction * 2000.f;
+		const btVector3 from(origin.x, origin.y, origin.z);
+		const btVector3 to(end.x, end.y, end.z);
+		btCollisionWorld::ClosestRayResultCallback result(from, to);
+		world.rayTest(from, to, result);
+		if (result.hasHit()) {
+			expected.push_back(glm::vec3(result.m_hitPointWorld.x(), result.m_hitPointWorld.y(), result.m_hitPointWorld.z()));
+		} else {
+			expected.push_back(std::nullopt);
+		}
+	}
+	auto bullet_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	begin = std::chrono::steady_clock::now();
+	std::vector<std::optional<glm::vec3>> results;
+	for (const auto& [origin, direction] : rays) {
+		results.push_back(intersect_heightfield(heights, width, height, origin, direction, 2000.f));
+	}
+	auto march_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	// Rays grazing a triangle edge may be decided differently, these are rare enough to ignore
+	size_t hits = 0;
+	size_t mismatches = 0;
+	for (size_t i = 0; i < rays.size(); i++) {
+		hits += results[i].has_value();
+		if (results[i].has_value() != expected[i].has_value()) {
+			mismatches += 1;
+		} else if (results[i] && glm::distance(*results[i], *expected[i]) > 1e-3f) {
+			mismatches += 1;
+		}
+	}
+	assert(mismatches < rays.size() / 1000);
+
+	world.removeCollisionObject(&object);
+
+	std::print("[INFO] Heightfield rays: {} of {} hit, {} differ from Bullet, {}ms Bullet, {}ms ray march\n", hits, rays.size(), mismatches, bullet_time, march_time);
+}
+
+// Checks the percentiles of the rolling window and measures what a disabled ProfileScope costs
+void benchmark_profiler() {
+	RollingSamples samples(100);
+	for (int i = 1; i <= 150; i++) {
+		samples.push(static_cast<float>(i));
+	}
+	// Only the last 100 values, 51 to 150, are kept
+	const auto percentiles = samples.percentiles();
+	assert(samples.size() == 100);
+	assert(samples.last() == 150.f);
+	assert(percentiles[0] == 100.f && percentiles[1] == 145.f && percentiles[2] == 149.f);
+
+	profiler.enabled = false;
+	constexpr size_t iterations = 10'000'000;
+	volatile size_t sink = 0;
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		ProfileScope scope("benchmark");
+		sink = sink + 1;
+	}
+	const double disabled = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / iterations;
+
+	begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		sink = sink + 1;
+	}
+	const double baseline = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / iterations;
+
+	// Around 20 scopes per frame against a 16.6ms frame
+	const double overhead = std::max(disabled - baseline, 0.0) * 20.0 / 16'666'666.0 * 100.0;
+	assert(overhead < 1.0);
+	assert(profiler.scopes.empty());
+
+	std::print("[INFO] Disabled ProfileScope: {:.2f}ns, {:.6f}% of a 60 FPS frame with 20 scopes\n", disabled - baseline, overhead);
+}
+
+// The per cell blit and collision test that the pre-rotated stamps replaced, kept as the reference
+void reference_blit(std::vector<uint8_t>& cells, int width, int height, glm::vec2 position, int rotation, const PathingTexture& texture, bool test, uint8_t mask, bool& free) {
+	const int div_w = (rotation % 180) ? texture.height : texture.width;
+	const int div_h = (rotation % 180) ? texture.width : texture.height;
+	for (int j = 0; j < texture.height; j++) {
+		for (int i = 0; i < texture.width; i++) {
+			int x = i;
+			int y = j;
+			switch (rotation) {
+				case 90:
+					x = texture.height - 1 - j;
+					y = i;
+					break;
+				case 180:
+					x = texture.width - 1 - i;
+					y = texture.height - 1 - j;
+					break;
+				case 270:
+					x = j;
+					y = texture.width - 1 - i;
+					break;
+			}
+
+			const int xx = position.x * 4 + x - div_w / 2;
+			const int yy = position.y * 4 + y - div_h / 2;
+			if (xx < 0 || xx > width - 1 || yy < 0 || yy > height - 1) {
+				continue;
+			}
+
+			const unsigned int index = ((texture.height - 1 - j) * texture.width + i) * texture.channels;
+			const uint8_t flags = (texture.data[index] > 250) * PathingMap::Flags::unwalkable | (texture.data[index + 1] > 250) * PathingMap::Flags::unflyable
+				| (texture.data[index + 2] > 250) * PathingMap::Flags::unbuildable;
+
+			if (test) {
+				if (flags & mask && cells[yy * width + xx]) {
+					free = false;
+				}
+			} else {
+				cells[yy * width + xx] |= flags;
+			}
+		}
+	}
+}
+
+void test_pathing_stamps() {
+	constexpr int width = 61;
+	constexpr int height = 45;
+
+	std::mt19937 generator(3);
+	std::uniform_int_distribution<int> channel(0, 3);
+	// Positions on the pathing cell grid, partly hanging over every edge of the map
+	std::uniform_int_distribution<int> quarter_tiles(-24, 4 * 17);
+
+	std::vector<std::shared_ptr<PathingTexture>> textures;
+	for (const auto& [w, h] : std::array<std::pair<int, int>, 7> { { { 1, 1 }, { 3, 5 }, { 7, 2 }, { 9, 13 }, { 16, 16 }, { 17, 3 }, { 31, 9 } } }) {
+		for (const int channels : { 3, 4 }) {
+			std::vector<uint8_t> data(w * h * channels);
+			for (auto& value : data) {
+				// Mostly fully set or empty like real pathing textures, with some values around the threshold
+				const int kind = channel(generator);
+				value = kind == 0 ? 0 : (kind == 1 ? 255 : 248 + channel(generator) * 2);
+			}
+			textures.push_back(std::make_shared<PathingTexture>(w, h, channels, std::move(data)));
+		}
+	}
+
+	PathingMap map;
+	map.width = width;
+	map.height = height;
+	map.pathing_cells_dynamic.assign(width * height, 0);
+	std::vector<uint8_t> expected(width * height, 0);
+
+	size_t collisions = 0;
+	for (size_t n = 0; n < 4'000; n++) {
+		const auto& texture = textures[n % textures.size()];
+		const int rotation = std::array { 0, 90, 180, 270, 360, 450 }[n / textures.size() % 6];
+		const glm::vec2 position = glm::vec2(quarter_tiles(generator), quarter_tiles(generator)) / 4.f;
+		const uint8_t mask = std::array<uint8_t, 3> { PathingMap::Flags::unwalkable, PathingMap::Flags::unflyable | PathingMap::Flags::unbuildable, 0b1110 }[n % 3];
+
+		bool expected_free = true;
+		reference_blit(expected, width, height, position, rotation, *texture, true, mask, expected_free);
+		const bool free = map.is_area_free(position, rotation, texture, mask);
+		assert(free == expected_free);
+		collisions += !free;
+
+		// Start over now and then so the map does not fill up
+		if (n % 50 == 0) {
+			std::ranges::fill(expected, 0);
+			std::ranges::fill(map.pathing_cells_dynamic, 0);
+		}
+
+		bool unused;
+		reference_blit(expected, width, height, position, rotation, *texture, false, 0, unused);
+		map.blit_pathing_texture(position, rotation, texture);
+		assert(map.pathing_cells_dynamic == expected);
+	}
+
+	// Blitting the pathing of a map full of doodads
+	std::vector<glm::vec2> positions;
+	for (size_t i = 0; i < 100'000; i++) {
+		positions.push_back(glm::vec2(quarter_tiles(generator), quarter_tiles(generator)) / 4.f);
+	}
+	const auto& texture = textures[9];
+
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < positions.size(); i++) {
+		bool unused;
+		reference_blit(expected, width, height, positions[i], (i % 4) * 90, *texture, false, 0, unused);
+	}
+	const auto reference_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < positions.size(); i++) {
+		map.blit_pathing_texture(positions[i], (i % 4) * 90, texture);
+	}
+	const auto stamp_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	std::print("[INFO] Pathing stamps: {} collisions, {}x{} texture blitted {} times in {}ms per cell and {}ms stamped\n", collisions, texture->width, texture->height, positions.size(), reference_time, stamp_time);
+}
+
+// Flood fills every open cell of a grid with a queue as the reference for label_pathing_components
+std::vector<u32> reference_components(const std::vector<uint8_t>& cells, int width, int height, uint8_t blocking) {
+	std::vector<u32> labels(cells.size(), 0);
+	u32 next = 0;
+	std::vector<int> queue;
+	for (int start = 0; start < width * height; start++) {
+		if (cells[start] & blocking || labels[start]) {
+			continue;
+		}
+		next += 1;
+		labels[start] = next;
+		queue = { start };
+		while (!queue.empty()) {
+			const int i = queue.back();
+			queue.pop_back();
+			const int x = i % width;
+			const int y = i / width;
+			for (const auto& [dx, dy] : { std::pair { -1, 0 }, std::pair { 1, 0 }, std::pair { 0, -1 }, std::pair { 0, 1 } }) {
+				if (x + dx < 0 || x + dx >= width || y + dy < 0 || y + dy >= height) {
+					continue;
+				}
+				const int neighbour = (y + dy) * width + x + dx;
+				if (!(cells[neighbour] & blocking) && !labels[neighbour]) {
+					labels[neighbour] = next;
+					queue.push_back(neighbour);
+				}
+			}
+		}
+	}
+	return labels;
+}
+
+void test_walkability() {
+	// Random grids against the flood fill, the labels have to describe the same partition
+	std::mt19937 generator(4);
+	for (const auto& [width, height] : std::array<std::pair<int, int>, 5> { { { 1, 1 }, { 7, 3 }, { 64, 64 }, { 97, 131 }, { 256, 37 } } }) {
+		for (const int percent_blocked : { 0, 30, 45, 60, 100 }) {
+			std::uniform_int_distribution<int> percent(0, 99);
+			std::vector<uint8_t> static_cells(width * height);
+			std::vector<uint8_t> dynamic_cells(width * height);
+			for (size_t i = 0; i < static_cells.size(); i++) {
+				// Half of the blocked cells come from doodads
+				if (percent(generator) < percent_blocked) {
+					(i % 2 ? static_cells : dynamic_cells)[i] = PathingMap::Flags::unwalkable;
+				}
+				static_cells[i] |= percent(generator) < 50 ? PathingMap::Flags::unbuildable : 0;
+			}
+
+			std::vector<uint8_t> combined(width * height);
+			for (size_t i = 0; i < combined.size(); i++) {
+				combined[i] = static_cells[i] | dynamic_cells[i];
+			}
+			const std::vector<u32> expected = reference_components(combined, width, height, PathingMap::Flags::unwalkable);
+			const PathingComponents components = label_pathing_components(static_cells, dynamic_cells, width, height, PathingMap::Flags::unwalkable);
+
+			std::unordered_map<u32, u32> to_expected;
+			std::unordered_map<u32, u32> to_label;
+			for (size_t i = 0; i < expected.size(); i++) {
+				assert((expected[i] == 0) == (components.labels[i] == 0));
+				assert(to_expected.try_emplace(components.labels[i], expected[i]).first->second == expected[i]);
+				assert(to_label.try_emplace(expected[i], components.labels[i]).first->second == components.labels[i]);
+			}
+			const u32 expected_count = expected.empty() ? 0 : *std::max_element(expected.begin(), expected.end());
+			assert(components.count() == expected_count);
+			assert(std::is_sorted(components.sizes.begin() + 1, components.sizes.end(), std::greater()));
+			assert(std::accumulate(components.sizes.begin(), components.sizes.end(), size_t(0)) == static_cast<size_t>(width * height));
+		}
+	}
+
+	// A 1920x1920 map cut into 30x30 rooms by walls every 64 cells, each row of rooms joined by doors into one corridor
+	constexpr int size = 1920;
+	std::vector<uint8_t> static_cells(size * size, 0);
+	std::vector<uint8_t> dynamic_cells(size * size, 0);
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			if (x % 64 == 0 || y % 64 == 0) {
+				static_cells[y * size + x] = PathingMap::Flags::unwalkable | PathingMap::Flags::unbuildable;
+			}
+		}
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	PathingComponents rooms = label_pathing_components(static_cells, dynamic_cells, size, size, PathingMap::Flags::unwalkable);
+	const auto rooms_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+	assert(rooms.count() == 30 * 30);
+	assert(rooms.sizes[1] == 63 * 63 && rooms.sizes.back() == 63 * 63);
+
+	for (int y = 32; y < size; y += 64) {
+		for (int x = 64; x < size; x += 64) {
+			static_cells[y * size + x] = 0;
+		}
+	}
+	// A doodad closes the door into the last room of the first row
+	dynamic_cells[32 * size + 1856] = PathingMap::Flags::unwalkable;
+
+	begin = std::chrono::steady_clock::now();
+	const PathingComponents corridors = label_pathing_components(static_cells, dynamic_cells, size, size, PathingMap::Flags::unwalkable);
+	const auto corridors_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+	assert(corridors.count() == 30 + 1);
+	assert(corridors.sizes[1] == 30 * 63 * 63 + 29);
+	assert(corridors.sizes.back() == 63 * 63);
+	// Air units ignore all of it
+	assert(label_pathing_components(static_cells, dynamic_cells, size, size, PathingMap::Flags::unflyable).count() == 1);
+
+	// Two start locations per corridor, except for the one in the closed off room
+	const std::vector<glm::ivec2> start_locations = { { 10, 10 }, { 1000, 10 }, { 10, 100 }, { 1000, 100 }, { 1900, 10 }, { 64, 64 } };
+	const std::vector<size_t> isolated = isolated_start_locations(corridors, start_locations);
+	assert((isolated == std::vector<size_t> { 4, 5 }));
+
+	std::print("[INFO] Walkability: {} rooms in {}ms, {} corridors in {}ms on a {}x{} grid\n", rooms.count(), rooms_time, corridors.count(), corridors_time, size, size);
+}
+
+// Plain A* over every cell with the movement rules of HierarchicalPathfinder, the reference for its paths
+std::optional<float> reference_path_length(const std::vector<uint8_t>& cells, int width, int height, int footprint, glm::ivec2 from, glm::ivec2 to) {
+	const int offset = (footprint - 1) / 2;
+	const auto is_open = [&](const int x, const int y) {
+		for (int j = y - offset; j < y - offset + footprint; j++) {
+			for (int i = x - offset; i < x - offset + footprint; i++) {
+				if (i < 0 || i >= width || j < 0 || j >= height || cells[j * width + i] & PathingMap::Flags::unwalkable) {
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+	if (!is_open(from.x, from.y) || !is_open(to.x, to.y)) {
+		return {};
+	}
+
+	const auto heuristic = [&](const int x, const int y) {
+		const int dx = std::abs(x - to.x);
+		const int dy = std::abs(y - to.y);
+		return std::max(dx, dy) + (std::numbers::sqrt2_v<float> - 1.f) * std::min(dx, dy);
+	};
+
+	std::vector<float> distance(width * height, std::numeric_limits<float>::infinity());
+	using Entry = std::pair<float, int>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	distance[from.y * width + from.x] = 0.f;
+	queue.push({ heuristic(from.x, from.y), from.y * width + from.x });
+	while (!queue.empty()) {
+		const auto [estimate, current] = queue.top();
+		queue.pop();
+		const int x = current % width;
+		const int y = current / width;
+		if (x == to.x && y == to.y) {
+			return distance[current];
+		}
+		if (estimate > distance[current] + heuristic(x, y) + 1e-4f) {
+			continue;
+		}
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				if ((dx == 0 && dy == 0) || !is_open(x + dx, y + dy)) {
+					continue;
+				}
+				if (dx != 0 && dy != 0 && (!is_open(x + dx, y) || !is_open(x, y + dy))) {
+					continue;
+				}
+				const int next = (y + dy) * width + x + dx;
+				const float next_distance = distance[current] + ((dx != 0 && dy != 0) ? std::numbers::sqrt2_v<float> : 1.f);
+				if (next_distance < distance[next]) {
+					distance[next] = next_distance;
+					queue.push({ next_distance + heuristic(x + dx, y + dy), next });
+				}
+			}
+		}
+	}
+	return {};
+}
+
+/// Scatters rectangular obstacles like cliffs and doodads over a grid
+void scatter_obstacles(std::vector<uint8_t>& cells, int width, int height, size_t count, int max_size, std::mt19937& generator) {
+	std::uniform_int_distribution<int> x_distribution(0, width - 1);
+	std::uniform_int_distribution<int> y_distribution(0, height - 1);
+	std::uniform_int_distribution<int> size_distribution(1, max_size);
+	for (size_t i = 0; i < count; i++) {
+		const int x = x_distribution(generator);
+		const int y = y_distribution(generator);
+		const int w = size_distribution(generator);
+		const int h = size_distribution(generator);
+		for (int j = y; j < std::min(y + h, height); j++) {
+			for (int k = x; k < std::min(x + w, width); k++) {
+				cells[j * width + k] |= PathingMap::Flags::unwalkable;
+			}
+		}
+	}
+}
+
+/// Checks that the path only makes legal steps between open cells and that its steps add up to its length
+void validate_path(const GridPath& path, const std::vector<uint8_t>& cells, int width, glm::ivec2 from, glm::ivec2 to) {
+	assert(path.cells.front() == from && path.cells.back() == to);
+	float length = 0.f;
+	for (size_t i = 1; i < path.cells.size(); i++) {
+		const glm::ivec2 step = path.cells[i] - path.cells[i - 1];
+		assert(std::abs(step.x) <= 1 && std::abs(step.y) <= 1 && (step.x != 0 || step.y != 0));
+		assert(!(cells[path.cells[i].y * width + path.cells[i].x] & PathingMap::Flags::unwalkable));
+		length += (step.x != 0 && step.y != 0) ? std::numbers::sqrt2_v<float> : 1.f;
+	}
+	assert(std::abs(length - path.length) < 1e-2f);
+}
+
+void test_pathfinding() {
+	std::mt19937 generator(5);
+
+	// Against plain A* on a map that does not divide into whole clusters
+	{
+		constexpr int width = 200;
+		constexpr int height = 150;
+		std::vector<uint8_t> static_cells(width * height, 0);
+		std::vector<uint8_t> dynamic_cells(width * height, 0);
+		scatter_obstacles(static_cells, width, height, 700, 8, generator);
+		std::uniform_int_distribution<int> x_distribution(0, width - 1);
+		std::uniform_int_distribution<int> y_distribution(0, height - 1);
+
+		for (const int footprint : { 1, 2, 3 }) {
+			HierarchicalPathfinder pathfinder(footprint, PathingMap::Flags::unwalkable);
+			pathfinder.build(static_cells, dynamic_cells, width, height);
+
+			size_t found = 0;
+			double overhead = 0.0;
+			for (size_t i = 0; i < 300; i++) {
+				const glm::ivec2 from = { x_distribution(generator), y_distribution(generator) };
+				const glm::ivec2 to = { x_distribution(generator), y_distribution(generator) };
+				const auto expected = reference_path_length(static_cells, width, height, footprint, from, to);
+				const auto path = pathfinder.find_path(from, to);
+				assert(expected.has_value() == path.has_value());
+				if (path) {
+					validate_path(*path, static_cells, width, from, to);
+					assert(path->length >= *expected - 1e-3f);
+					assert(path->length <= *expected * 1.25f + 2.f);
+					overhead += *expected > 0.f ? path->length / *expected - 1.0 : 0.0;
+					found += 1;
+				}
+			}
+			std::print("[INFO] Pathfinding footprint {}: {} paths, {:.2f}% longer than optimal on average\n", footprint, found, overhead / std::max<size_t>(found, 1) * 100.0);
+		}
+
+		// Repairing after doodads were placed and removed gives the same paths as building from scratch
+		HierarchicalPathfinder repaired(2, PathingMap::Flags::unwalkable);
+		repaired.build(static_cells, dynamic_cells, width, height);
+		for (size_t change = 0; change < 40; change++) {
+			const int x = x_distribution(generator);
+			const int y = y_distribution(generator);
+			const int size = 1 + change % 7;
+			for (int j = y; j < std::min(y + size, height); j++) {
+				for (int i = x; i < std::min(x + size, width); i++) {
+					dynamic_cells[j * width + i] = change % 3 ? PathingMap::Flags::unwalkable : 0;
+					static_cells[j * width + i] &= change % 5 ? 0xFF : ~PathingMap::Flags::unwalkable;
+				}
+			}
+			repaired.repair(static_cells, dynamic_cells, x, y, x + size, y + size);
+		}
+
+		HierarchicalPathfinder fresh(2, PathingMap::Flags::unwalkable);
+		fresh.build(static_cells, dynamic_cells, width, height);
+		for (size_t i = 0; i < 300; i++) {
+			const glm::ivec2 from = { x_distribution(generator), y_distribution(generator) };
+			const glm::ivec2 to = { x_distribution(generator), y_distribution(generator) };
+			const auto a = repaired.find_path(from, to);
+			const auto b = fresh.find_path(from, to);
+			assert(a.has_value() == b.has_value());
+			assert(!a || (a->length == b->length && a->cells == b->cells));
+		}
+	}
+
+	// Interactive use on the largest map, 480x480 tiles
+	constexpr int size = 1920;
+	std::vector<uint8_t> static_cells(size * size, 0);
+	std::vector<uint8_t> dynamic_cells(size * size, 0);
+	scatter_obstacles(static_cells, size, size, 30'000, 12, generator);
+
+	auto begin = std::chrono::steady_clock::now();
+	HierarchicalPathfinder pathfinder(2, PathingMap::Flags::unwalkable);
+	pathfinder.build(static_cells, dynamic_cells, size, size);
+	const auto build_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	// Placing a doodad
+	begin = std::chrono::steady_clock::now();
+	for (int j = 900; j < 916; j++) {
+		for (int i = 900; i < 916; i++) {
+			dynamic_cells[j * size + i] = PathingMap::Flags::unwalkable;
+		}
+	}
+	pathfinder.repair(static_cells, dynamic_cells, 900, 900, 916, 916);
+	const auto repair_time = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
+
+	std::uniform_int_distribution<int> coordinate(0, size - 1);
+	std::vector<float> query_times;
+	size_t found = 0;
+	while (query_times.size() < 200) {
+		const glm::ivec2 from = { coordinate(generator), coordinate(generator) };
+		const glm::ivec2 to = { coordinate(generator), coordinate(generator) };
+		begin = std::chrono::steady_clock::now();
+		const auto path = pathfinder.find_path(from, to);
+		query_times.push_back((std::chrono::steady_clock::now() - begin).count() / 1'000'000.f);
+		found += path.has_value();
+	}
+	std::sort(query_times.begin(), query_times.end());
+	const float average = std::accumulate(query_times.begin(), query_times.end(), 0.f) / query_times.size();
+	const float p95 = query_times[query_times.size() * 95 / 100];
+	assert(p95 < 5.f);
+
+	std::print("[INFO] Pathfinding on {}x{} cells: {}ms build, {}ms repair, {} of {} queries found a path, {}ms average, {}ms p95, {}ms max\n", size, size, build_time, repair_time, found, query_times.size(), average, p95, query_times.back());
+}
+
+void test_undo_delta() {
+	// A height brush stroke on 256x256 corners, the corners inside a circle are raised
+	constexpr int size = 256;
+	std::mt19937 generator(6);
+	std::uniform_real_distribution<float> height(-2.f, 2.f);
+	std::vector<Corner> before(size * size);
+	for (auto& i : before) {
+		i.height = height(generator);
+		i.ground_texture = generator() % 4;
+		i.layer_height = 2;
+	}
+	std::vector<Corner> after = before;
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			if ((x - 128) * (x - 128) + (y - 128) * (y - 128) < 100 * 100) {
+				after[y * size + x].height += 0.25f;
+			}
+		}
+	}
+
+	ByteDelta delta = ByteDelta::between<Corner>(before, after);
+	const size_t encoded_size = delta.memory_size();
+	std::vector<Corner> corners = before;
+	const auto corner = [&](const size_t i) -> Corner& {
+		return corners[i];
+	};
+	// The delta goes both ways
+	delta.redo<Corner>(corner);
+	assert(std::memcmp(corners.data(), after.data(), corners.size() * sizeof(Corner)) == 0);
+	delta.undo<Corner>(corner);
+	assert(std::memcmp(corners.data(), before.data(), corners.size() * sizeof(Corner)) == 0);
+
+	delta.compress();
+	delta.redo<Corner>(corner);
+	assert(std::memcmp(corners.data(), after.data(), corners.size() * sizeof(Corner)) == 0);
+
+	// Something else changed the corners after the stroke without going through the history, like the tile pather does with the pathing cells.
+	// Undo writes the heights from before the stroke instead of toggling bytes, so it keeps the other change and doing it twice changes nothing
+	for (auto& i : corners) {
+		i.blight = true;
+	}
+	delta.undo<Corner>(corner);
+	delta.undo<Corner>(corner);
+	for (size_t i = 0; i < corners.size(); i++) {
+		assert(corners[i].height == before[i].height);
+		assert(corners[i].blight);
+	}
+	delta.redo<Corner>(corner);
+	delta.redo<Corner>(corner);
+	for (size_t i = 0; i < corners.size(); i++) {
+		assert(corners[i].height == after[i].height);
+		assert(corners[i].blight);
+	}
+
+	std::print("[INFO] Undo of {} corners: {} KiB as copies, {} KiB as delta, {} KiB compressed\n", before.size(), 2 * before.size() * sizeof(Corner) / 1024, encoded_size / 1024, delta.memory_size() / 1024);
+	assert(encoded_size * 8 < 2 * before.size() * sizeof(Corner));
+
+	// Nothing changed, and nothing at all
+	const std::vector<uint8_t> cells(1000, 7);
+	const ByteDelta unchanged = ByteDelta::between<uint8_t>(cells, cells);
+	assert(unchanged.memory_size() < sizeof(ByteDelta) + 16);
+	const ByteDelta empty = ByteDelta::between<uint8_t>({}, {});
+	empty.undo<uint8_t>([&](const size_t) -> uint8_t& { std::unreachable(); });
+}
+
+ECA make_eca(ECA::Type type, std::string name, std::vector<TriggerParameter> parameters, std::vector<ECA> ecas = {}) {
+	return { .type = type, .group = 0, .name = std::move(name), .enabled = true, .parameters = std::move(parameters), .ecas = std::move(ecas) };
+}
+
+TriggerParameter make_parameter(TriggerParameter::Type type, std::string value) {
+	return { .type = type, .unknown = 0, .value = std::move(value), .has_sub_parameter = false, .sub_parameter = {} };
+}
+
+void benchmark_trigger_conversion() {
+	Triggers triggers;
+	for (const auto section : { "TriggerActions", "TriggerEvents", "TriggerConditions", "TriggerCalls", "TriggerTypes", "TriggerParams" }) {
+		triggers.trigger_data.set_whole_data(section, "_", "");
+	}
+	triggers.variables.push_back({ .name = "Count", .type = "integer", .is_array = false, .is_initialized = false });
+
+	// GUI triggers with nested blocks, helper functions, preplaced object references and custom script
+	using enum TriggerParameter::Type;
+	std::mt19937 generator(8);
+	for (int i = 0; i < 3000; i++) {
+		std::vector<ECA> actions;
+		for (int j = 0; j < 8; j++) {
+			const std::string unit = std::format("gg_unit_hfoo_{:0>4}", generator() % 500);
+			actions.push_back(make_eca(ECA::Type::action, "KillUnit", { make_parameter(variable, unit) }));
+			actions.push_back(make_eca(ECA::Type::action, "SetVariable", { make_parameter(variable, "Count"), make_parameter(string, std::to_string(j)) }));
+		}
+		actions.push_back(make_eca(ECA::Type::action, "CustomScriptCode", { make_parameter(string, std::format("call RemoveDestructable(gg_dest_LTlt_{})", generator() % 500)) }));
+
+		ECA branch = make_eca(ECA::Type::action, "IfThenElseMultiple", {}, actions);
+		for (auto& j : branch.ecas) {
+			j.group = 1 + generator() % 2;
+		}
+		branch.ecas.push_back(make_eca(ECA::Type::condition, "OperatorCompareInteger", { make_parameter(variable, "Count"), make_parameter(string, "=="), make_parameter(string, "3") }));
+
+		Trigger trigger;
+		trigger.name = std::format("Trigger {}", i);
+		trigger.initially_on = i % 3 != 0;
+		trigger.ecas.push_back(make_eca(ECA::Type::event, i % 10 == 0 ? "MapInitializationEvent" : "TriggerRegisterTimerEventPeriodic", { make_parameter(string, "2.00") }));
+		trigger.ecas.push_back(make_eca(ECA::Type::condition, "OperatorCompareInteger", { make_parameter(variable, "Count"), make_parameter(string, ">"), make_parameter(string, "0") }));
+		trigger.ecas.push_back(make_eca(ECA::Type::action, "ForLoopAMultiple", { make_parameter(string, "1"), make_parameter(string, "10") }, { branch }));
+		trigger.ecas.insert(trigger.ecas.end(), actions.begin(), actions.end());
+		if (i % 100 == 0) {
+			trigger.custom_text = std::format("function InitTrig_Custom_{} takes nothing returns nothing\n\tcall KillUnit(gg_unit_hpea_{:0>4})\nendfunction", i, i);
+		}
+		triggers.triggers.push_back(std::move(trigger));
+	}
+
+	// Triggers may spell a creation number with or without zero padding, the globals have to be declared as spelled
+	Trigger spellings;
+	spellings.name = "Spellings";
+	spellings.ecas.push_back(make_eca(ECA::Type::action, "KillUnit", { make_parameter(variable, "gg_unit_hfoo_0012") }));
+	spellings.ecas.push_back(make_eca(ECA::Type::action, "KillUnit", { make_parameter(variable, "gg_unit_hfoo_12") }));
+	spellings.ecas.push_back(make_eca(ECA::Type::action, "CustomScriptCode", { make_parameter(string, "call RemoveDestructable(gg_dest_LTlt_0012)") }));
+	triggers.triggers.push_back(std::move(spellings));
+
+	const auto same = [](const TriggerScripts& a, const TriggerScripts& b) {
+		return a.script == b.script && a.map_initializations == b.map_initializations && a.references.units == b.references.units
+			&& a.references.destructables == b.references.destructables;
+	};
+
+	for (const auto mode : { ScriptMode::jass, ScriptMode::lua }) {
+		auto begin = std::chrono::steady_clock::now();
+		const TriggerScripts serial = triggers.convert_triggers(mode, false);
+		const double serial_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+		begin = std::chrono::steady_clock::now();
+		const TriggerScripts cold = triggers.convert_triggers(mode);
+		const double cold_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+		begin = std::chrono::steady_clock::now();
+		const TriggerScripts warm = triggers.convert_triggers(mode);
+		const double warm_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+		assert(same(serial, cold));
+		assert(same(serial, warm));
+		assert(!serial.references.units.empty() && !serial.references.destructables.empty());
+		assert((serial.references.units.at(12) == std::set<std::string>{ "gg_unit_hfoo_0012", "gg_unit_hfoo_12" }));
+		assert(serial.references.destructables.at(12).contains("gg_dest_LTlt_0012"));
+
+		// Only the edited trigger is converted again
+		triggers.triggers[42].ecas[1].parameters[2].value = "5";
+		begin = std::chrono::steady_clock::now();
+		const TriggerScripts edited = triggers.convert_triggers(mode);
+		const double edited_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		assert(same(edited, triggers.convert_triggers(mode, false)));
+		assert(edited.script != serial.script);
+		triggers.triggers[42].ecas[1].parameters[2].value = "0";
+
+		std::print("[INFO] Converting {} triggers ({} KiB of {}): {:.1f}ms serial, {:.1f}ms parallel, {:.1f}ms cached, {:.1f}ms with one edit\n",
+			triggers.triggers.size(), serial.script.size() / 1024, mode == ScriptMode::jass ? "jass" : "lua", serial_ms, cold_ms, warm_ms, edited_ms);
+	}
+}
+
+void test_jass_checker() {
+	// A small part of common.j
+	JassChecker checker;
+	const std::vector<JassError> base_errors = checker.add_base_script(R"(
+type agent extends handle
+type widget extends agent
+type unit extends widget
+type trigger extends agent
+constant native GetTriggerUnit takes nothing returns unit
+native KillUnit takes unit whichUnit returns nothing
+native CreateTrigger takes nothing returns trigger
+native TriggerAddAction takes trigger whichTrigger, code actionFunc returns nothing
+native R2I takes real r returns integer
+globals
+	constant integer bj_MAX_PLAYERS = 24
+endglobals
+)", "common.j");
+	assert(base_errors.empty());
+
+	const JassCheckResult valid = checker.check(R"(globals
+	integer array udg_counts
+	trigger gg_trg_Test = null
+endglobals
+
+function Helper takes integer a, real b returns real
+	local real result = a * b + 'hfoo' - $FF + 0x10 + .5
+	if a > 0 and not (b == 0) then
+		set result = -result
+	elseif a == 0 then
+		return 0
+	else
+		loop
+			exitwhen a >= 10 // a comment
+			set a = a + 1
+			set udg_counts[a] = R2I(b)
+		endloop
+	endif
+	return result
+endfunction
+
+function Trig_Test_Actions takes nothing returns nothing
+	local unit u = GetTriggerUnit()
+	call KillUnit(u)
+	debug call Helper(1, 2)
+endfunction
+
+function InitTrig_Test takes nothing returns nothing
+	set gg_trg_Test = CreateTrigger()
+	call TriggerAddAction(gg_trg_Test, function Trig_Test_Actions)
+endfunction
+)");
+	assert(!valid.uses_vjass && valid.errors.empty());
+
+	const JassCheckResult invalid = checker.check(R"(globals
+	integer udg_count = "text"
+endglobals
+function A takes integer a returns integer
+	local real r = 1.5
+	set a = r
+	set udg_missing = 1
+	call KillUnit(a)
+	set bj_MAX_PLAYERS = 3
+	exitwhen true
+	if a then
+		return
+	endif
+	return a + "s"
+endfunction
+function B takes nothing returns nothing
+	call A(1, 2)
+	loop
+endfunction
+function C takes nothing returns nothing
+	call TriggerAddAction(null, function A)
+endfunction
+)");
+	std::vector<int> lines;
+	for (const auto& i : invalid.errors) {
+		lines.push_back(i.line);
+	}
+	assert((lines == std::vector { 2, 6, 7, 8, 9, 10, 11, 12, 14, 17, 18, 21 }));
+
+	assert(checker.check("library Damage\nendlibrary\n").uses_vjass);
+	assert(checker.check("//! textmacro Foo\n").uses_vjass);
+	assert(checker.check("function interface Filter takes unit u returns boolean\n").uses_vjass);
+	assert(checker.check("/* Written\nfor JassHelper */ function Foo takes nothing returns nothing\nendfunction\n").uses_vjass);
+	assert(checker.check("function Foo takes nothing returns nothing\n\tlocal integer i = 1 /* inline */ + 2\nendfunction\n").uses_vjass);
+
+	// About the size of the script of a large map
+	std::string script = "globals\n\tinteger array udg_counts\nendglobals\n";
+	for (int i = 0; script.size() < 5'000'000; i++) {
+		script += std::format(R"(function F{0} takes integer a, real b returns real
+	local real result = a * b + 'hfoo'
+	local unit u = GetTriggerUnit()
+	if a > 0 and not (b == 0) then
+		set result = -result
+	else
+		loop
+			exitwhen a >= 10
+			set a = a + 1
+			set udg_counts[a] = R2I(b) + 2 * (a - 1)
+		endloop
+	endif
+	call KillUnit(u)
+	return result
+endfunction
+)", i);
+	}
+	const auto begin = std::chrono::steady_clock::now();
+	const JassCheckResult large = checker.check(script);
+	const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	assert(large.errors.empty());
+	std::print("[INFO] Checked {} KiB of JASS in {:.1f}ms\n", script.size() / 1024, elapsed);
+}
+
+// Packs runs of plain units between special ones, checks the JASS with JassChecker and that the units are created in the same order as without packing
+void test_packed_preplaced_objects() {
+	JassChecker checker;
+	const std::vector<JassError> base_errors = checker.add_base_script(R"(
+type agent extends handle
+type widget extends agent
+type unit extends widget
+type item extends widget
+type player extends agent
+type trigger extends agent
+type unitstate extends handle
+constant native ConvertUnitState takes integer i returns unitstate
+globals
+	constant unitstate UNIT_STATE_LIFE = ConvertUnitState(0)
+	constant unitstate UNIT_STATE_MANA = ConvertUnitState(2)
+endglobals
+native Player takes integer number returns player
+native BlzCreateUnitWithSkin takes player id, integer unitid, real x, real y, real face, integer skinId returns unit
+native BlzCreateItemWithSkin takes integer itemid, real x, real y, integer skinId returns item
+native GetUnitState takes unit whichUnit, unitstate whichUnitState returns real
+native SetUnitState takes unit whichUnit, unitstate whichUnitState, real newVal returns nothing
+native SetHeroLevel takes unit whichHero, integer level, boolean showEyeCandy returns nothing
+native UnitAddItemToSlotById takes unit whichUnit, integer itemId, integer itemSlot returns boolean
+native ExecuteFunc takes string funcName returns nothing
+)", "common.j");
+	assert(base_errors.empty());
+
+	// A run of 2100 plain units that takes three chunks, a special unit, 3 plain units which are too few to pack,
+	// another special unit and a start location followed by 24 plain units
+	Units units;
+	for (int i = 0; i < 2130; i++) {
+		Unit& unit = units.units.emplace_back();
+		unit.id = i == 2105 ? "sloc" : "hfoo";
+		unit.skin_id = unit.id;
+		unit.player = i % 4;
+		unit.position = glm::vec3(i * 0.25f, -i * 0.5f, 0.f);
+		unit.angle = i * 0.01f;
+		if (i == 2100) {
+			unit.health = 50;
+			unit.mana = 20;
+		} else if (i == 2104) {
+			unit.level = 3;
+			unit.items.push_back({ 0, "ratc" });
+		}
+	}
+	for (int i = 0; i < 5; i++) {
+		Unit& item = units.items.emplace_back();
+		item.id = "ratc";
+		item.position = glm::vec3(i, i, 0.f);
+	}
+
+	const auto [unpacked_script, unpacked_count] = generate_preplaced_object_script(units, glm::vec2(-2048.f), ScriptMode::jass, false);
+	assert(unpacked_count == 0);
+	const JassCheckResult unpacked = checker.check(unpacked_script);
+	assert(!unpacked.uses_vjass && unpacked.errors.empty());
+
+	const auto [jass, jass_count] = generate_preplaced_object_script(units, glm::vec2(-2048.f), ScriptMode::jass, true);
+	assert(jass_count == 2100 + 24 + 5);
+	const JassCheckResult packed = checker.check(jass);
+	assert(!packed.uses_vjass && packed.errors.empty());
+
+	// E for a packed chunk, U for an explicitly created unit
+	std::string order;
+	std::istringstream lines(jass.substr(jass.find("function CreateAllUnits")));
+	for (std::string line; std::getline(lines, line);) {
+		if (line.contains("ExecuteFunc(\"CreateUnits_")) {
+			order += 'E';
+		} else if (line.contains("= BlzCreateUnitWithSkin(")) {
+			order += 'U';
+		}
+	}
+	assert(order == "EEEUUUUUE");
+
+	const auto [lua, lua_count] = generate_preplaced_object_script(units, glm::vec2(-2048.f), ScriptMode::lua, true);
+	assert(lua_count == jass_count);
+	assert(lua.contains("local data = {") && lua.contains("CreateUnits_1_0()") && !lua.contains("HiveWE_CreateUnit"));
+
+	std::print("[INFO] Packed preplaced objects: {} KiB of JASS instead of {} KiB, {} KiB of Lua\n", jass.size() / 1024, unpacked_script.size() / 1024, lua.size() / 1024);
+}
+
 export void execute_tests() {
 	std::print("[INFO] Parsing all MDX files\n");
 	auto begin = std::chrono::steady_clock::now();
 	parse_all_mdx();
 	auto delta = (std::chrono::steady_clock::now() - begin).count() / 1'000'000.f;
 	std::print("[INFO] Done parsing in {}ms\n", delta);
+
+	benchmark_skeleton_update("D:/Warcraft/WC3/Assets/Units/Human/Footman/Footman.mdx");
+	test_gpu_buffers();
+	test_draw_command_sorting();
+	test_terrain_chunk_culling();
+	benchmark_visibility();
+	test_frame_arena();
+	benchmark_transparent_sort();
+	test_picking();
+	test_heightfield_ray();
+	benchmark_profiler();
+	test_pathing_stamps();
+	test_walkability();
+	test_pathfinding();
+	test_undo_delta();
+	benchmark_trigger_conversion();
+	test_jass_checker();
+	test_packed_preplaced_objects();
 }
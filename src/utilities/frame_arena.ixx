@@ -0,0 +1,153 @@
+module;
+
+#include <cassert>
+
+export module FrameArena;
+
+import std;
+
+/// Linear allocator for data that only lives for one frame, like the render lists.
+/// Allocating bumps a pointer and freeing does nothing, reset() makes all memory available again at once.
+/// When a frame needs more than the current block the rest comes from the upstream resource.
+/// On the next reset the memory is merged into one block, so later frames of the same size no longer reach upstream.
+/// Not thread safe, only allocate from the render thread
+export class FrameArena : public std::pmr::memory_resource {
+	static constexpr size_t block_alignment = 64;
+
+	struct Overflow {
+		void* pointer;
+		size_t size;
+		size_t alignment;
+	};
+
+	std::pmr::memory_resource* upstream;
+	std::byte* block = nullptr;
+	size_t block_size = 0;
+	size_t head = 0;
+	std::pmr::vector<Overflow> overflow;
+	size_t overflow_bytes = 0;
+	size_t live_allocations = 0;
+
+	void release_overflow() {
+		for (const auto& i : overflow) {
+			upstream->deallocate(i.pointer, i.size, i.alignment);
+		}
+		overflow.clear();
+		overflow_bytes = 0;
+	}
+
+  public:
+	/// Bytes handed out since the last reset, including those that had to come from upstream
+	size_t used = 0;
+	/// Largest amount of bytes a single frame used
+	size_t peak = 0;
+	/// How often memory was requested from the upstream resource
+	size_t upstream_allocations = 0;
+
+	explicit FrameArena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+		: upstream(upstream), overflow(upstream) {
+	}
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	~FrameArena() override {
+		release_overflow();
+		if (block) {
+			upstream->deallocate(block, block_size, block_alignment);
+		}
+	}
+
+	size_t capacity() const {
+		return block_size;
+	}
+
+	/// Starts a new frame. All memory allocated during the previous frame must have been freed by its owners
+	void reset() {
+		assert(live_allocations == 0);
+
+		peak = std::max(peak, used);
+		if (!overflow.empty()) {
+			const size_t required = head + overflow_bytes;
+			release_overflow();
+			if (block) {
+				upstream->deallocate(block, block_size, block_alignment);
+			}
+			block_size = std::bit_ceil(required);
+			block = static_cast<std::byte*>(upstream->allocate(block_size, block_alignment));
+			upstream_allocations += 1;
+		}
+
+		head = 0;
+		used = 0;
+	}
+
+  protected:
+	void* do_allocate(const size_t bytes, const size_t alignment) override {
+		used += bytes;
+		live_allocations += 1;
+
+		const size_t offset = (head + alignment - 1) / alignment * alignment;
+		if (offset + bytes <= block_size) {
+			head = offset + bytes;
+			return block + offset;
+		}
+
+		// Counted with the worst case padding so the merged block is always large enough
+		void* pointer = upstream->allocate(bytes, alignment);
+		overflow.push_back({ pointer, bytes, alignment });
+		overflow_bytes += bytes + alignment - 1;
+		upstream_allocations += 1;
+		return pointer;
+	}
+
+	void do_deallocate(void*, size_t, size_t) override {
+		live_allocations -= 1;
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+/// The arena for the render lists, reset at the start of Map::render().
+/// Intentionally leaked like instance_pool() so that it outlives any static object still holding memory from it
+export FrameArena& frame_arena() {
+	static auto* arena = new FrameArena();
+	return *arena;
+}
+
+/// Stateless allocator drawing from frame_arena(). Containers using it have to release their memory (not just clear) before the next reset
+export template <typename T>
+class frame_allocator {
+  public:
+	using value_type = T;
+
+	frame_allocator() noexcept = default;
+
+	template <typename U>
+	frame_allocator(const frame_allocator<U>&) noexcept {
+	}
+
+	T* allocate(const size_t count) {
+		return static_cast<T*>(frame_arena().allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* pointer, const size_t count) noexcept {
+		frame_arena().deallocate(pointer, count * sizeof(T), alignof(T));
+	}
+
+	template <typename U>
+	bool operator==(const frame_allocator<U>&) const noexcept {
+		return true;
+	}
+};
+
+export template <typename T>
+using frame_vector = std::vector<T, frame_allocator<T>>;
+
+/// Frees the memory of the vector, unlike clear() or assigning {} which keep the capacity
+export template <typename T>
+void release(frame_vector<T>& vector) {
+	frame_vector<T>().swap(vector);
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+export module PoolAllocator;
+
+import std;
+
+/// A shared, thread safe pool for small arrays that get allocated and freed often, like the per instance animation state.
+/// Intentionally leaked so that it outlives any static object still holding memory from it
+export std::pmr::memory_resource& instance_pool() {
+	static auto* pool = new std::pmr::synchronized_pool_resource();
+	return *pool;
+}
+
+/// Stateless allocator drawing from instance_pool(), so containers using it can be copied and moved freely
+export template <typename T>
+class pool_allocator {
+  public:
+	using value_type = T;
+
+	pool_allocator() noexcept = default;
+
+	template <typename U>
+	pool_allocator(const pool_allocator<U>&) noexcept {
+	}
+
+	T* allocate(const size_t count) {
+		return static_cast<T*>(instance_pool().allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* pointer, const size_t count) noexcept {
+		instance_pool().deallocate(pointer, count * sizeof(T), alignof(T));
+	}
+
+	template <typename U>
+	bool operator==(const pool_allocator<U>&) const noexcept {
+		return true;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,324 @@
+export module Profiler;
+
+import std;
+import <glad/glad.h>;
+
+/// The last capacity values of a per frame metric, for percentiles over a rolling window
+export class RollingSamples {
+	std::vector<float> samples;
+	size_t next = 0;
+	size_t capacity;
+
+  public:
+	RollingSamples()
+		: RollingSamples(240) {
+	}
+
+	explicit RollingSamples(const size_t capacity)
+		: capacity(capacity) {
+		samples.reserve(capacity);
+	}
+
+	void push(const float value) {
+		if (samples.size() < capacity) {
+			samples.push_back(value);
+		} else {
+			samples[next] = value;
+		}
+		next = (next + 1) % capacity;
+	}
+
+	size_t size() const {
+		return samples.size();
+	}
+
+	float last() const {
+		if (samples.empty()) {
+			return 0.f;
+		}
+		return samples[(next + capacity - 1) % capacity];
+	}
+
+	/// p50, p95 and p99 using the nearest rank
+	std::array<float, 3> percentiles() const {
+		if (samples.empty()) {
+			return { 0.f, 0.f, 0.f };
+		}
+
+		std::vector<float> sorted = samples;
+		std::sort(sorted.begin(), sorted.end());
+		// In integer percent so that 99% of 100 samples is exactly rank 99
+		const auto rank = [&](const size_t percent) {
+			return sorted[(percent * sorted.size() + 99) / 100 - 1];
+		};
+		return { rank(50), rank(95), rank(99) };
+	}
+};
+
+/// Frame profiler with nested CPU scopes, GPU timings and per frame counters, shown in the debug overlay.
+/// GPU scopes use GL_TIME_ELAPSED queries, which can't nest, so only the outermost GPU scope is timed on the GPU.
+/// The queries of a frame are read two frames later so reading them never waits on the GPU.
+/// While disabled a ProfileScope is a single branch
+export class Profiler {
+  public:
+	struct Scope {
+		std::string_view name;
+		size_t parent; // npos for top level scopes
+		int depth;
+		RollingSamples cpu;
+		RollingSamples gpu;
+		double cpu_frame = 0.0;
+		double gpu_frame = 0.0;
+		bool cpu_touched = false;
+		bool gpu_touched = false;
+	};
+
+	struct Counter {
+		std::string_view name;
+		RollingSamples values;
+		double current = 0.0;
+	};
+
+	static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+	bool enabled = false;
+	size_t frames = 0;
+	/// In the order they were first entered
+	std::vector<Scope> scopes;
+	std::vector<Counter> counters;
+
+  private:
+	struct QueryFrame {
+		std::vector<GLuint> queries;
+		std::vector<size_t> query_scopes;
+		size_t used = 0;
+	};
+
+	std::array<QueryFrame, 2> query_frames;
+	size_t query_frame = 0;
+	bool gpu_active = false;
+
+	struct OpenScope {
+		size_t scope;
+		std::chrono::steady_clock::time_point begin;
+		bool gpu;
+	};
+	std::vector<OpenScope> open;
+
+	size_t find_scope(const std::string_view name, const size_t parent) {
+		for (size_t i = 0; i < scopes.size(); i++) {
+			if (scopes[i].parent == parent && scopes[i].name == name) {
+				return i;
+			}
+		}
+		const int depth = parent == npos ? 0 : scopes[parent].depth + 1;
+		scopes.push_back({ name, parent, depth });
+		return scopes.size() - 1;
+	}
+
+	/// Collects the GPU times of the frame that last used this query frame, skipping queries that somehow aren't done yet
+	void read_queries(QueryFrame& frame) {
+		for (size_t i = 0; i < frame.used; i++) {
+			GLint available = 0;
+			glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				continue;
+			}
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &nanoseconds);
+
+			Scope& scope = scopes[frame.query_scopes[i]];
+			scope.gpu_frame += nanoseconds / 1'000'000.0;
+			scope.gpu_touched = true;
+		}
+		frame.used = 0;
+
+		for (auto& scope : scopes) {
+			if (scope.gpu_touched) {
+				scope.gpu.push(static_cast<float>(scope.gpu_frame));
+				scope.gpu_frame = 0.0;
+				scope.gpu_touched = false;
+			}
+		}
+	}
+
+	void append_children(const size_t parent, std::vector<size_t>& order) const {
+		for (size_t i = 0; i < scopes.size(); i++) {
+			if (scopes[i].parent == parent) {
+				order.push_back(i);
+				append_children(i, order);
+			}
+		}
+	}
+
+  public:
+	/// Requires the OpenGL context to be current
+	void begin_frame() {
+		if (!enabled) {
+			return;
+		}
+		query_frame = (query_frame + 1) % query_frames.size();
+		read_queries(query_frames[query_frame]);
+	}
+
+	void end_frame() {
+		if (!enabled) {
+			return;
+		}
+		frames += 1;
+
+		for (auto& scope : scopes) {
+			if (scope.cpu_touched) {
+				scope.cpu.push(static_cast<float>(scope.cpu_frame));
+				scope.cpu_frame = 0.0;
+				scope.cpu_touched = false;
+			}
+		}
+
+		for (auto& counter : counters) {
+			counter.values.push(static_cast<float>(counter.current));
+			counter.current = 0.0;
+		}
+	}
+
+	/// Scopes with the same name under the same parent are summed per frame
+	void begin_scope(const std::string_view name, const bool gpu) {
+		const size_t scope = find_scope(name, open.empty() ? npos : open.back().scope);
+
+		const bool time_gpu = gpu && !gpu_active;
+		if (time_gpu) {
+			QueryFrame& frame = query_frames[query_frame];
+			if (frame.used == frame.queries.size()) {
+				GLuint query;
+				glCreateQueries(GL_TIME_ELAPSED, 1, &query);
+				frame.queries.push_back(query);
+				frame.query_scopes.push_back(scope);
+			}
+			frame.query_scopes[frame.used] = scope;
+			glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.used]);
+			frame.used += 1;
+			gpu_active = true;
+		}
+
+		open.push_back({ scope, std::chrono::steady_clock::now(), time_gpu });
+	}
+
+	void end_scope() {
+		const OpenScope closing = open.back();
+		open.pop_back();
+
+		Scope& scope = scopes[closing.scope];
+		scope.cpu_frame += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - closing.begin).count();
+		scope.cpu_touched = true;
+
+		if (closing.gpu) {
+			glEndQuery(GL_TIME_ELAPSED);
+			gpu_active = false;
+		}
+	}
+
+	/// Adds to a per frame counter like draw calls or uploaded bytes
+	void count(const std::string_view name, const double value) {
+		if (!enabled) {
+			return;
+		}
+		for (auto& counter : counters) {
+			if (counter.name == name) {
+				counter.current += value;
+				return;
+			}
+		}
+		counters.push_back({ name });
+		counters.back().current = value;
+	}
+
+	/// Scopes in depth first order, so that every scope directly follows its parent or a sibling
+	std::vector<size_t> scope_order() const {
+		std::vector<size_t> order;
+		append_children(npos, order);
+		return order;
+	}
+
+	std::string to_json() const {
+		std::string json = std::format("{{\n\t\"frames\": {},\n\t\"scopes\": [", frames);
+		bool first = true;
+		for (const auto i : scope_order()) {
+			const Scope& scope = scopes[i];
+			const auto cpu = scope.cpu.percentiles();
+			const auto gpu = scope.gpu.percentiles();
+			json += std::format(
+				"{}\n\t\t{{ \"name\": \"{}\", \"parent\": \"{}\", \"depth\": {}, \"cpu_ms\": {{ \"p50\": {}, \"p95\": {}, \"p99\": {} }}",
+				first ? "" : ",",
+				scope.name,
+				scope.parent == npos ? "" : scopes[scope.parent].name,
+				scope.depth,
+				cpu[0],
+				cpu[1],
+				cpu[2]
+			);
+			if (scope.gpu.size()) {
+				json += std::format(", \"gpu_ms\": {{ \"p50\": {}, \"p95\": {}, \"p99\": {} }}", gpu[0], gpu[1], gpu[2]);
+			}
+			json += " }";
+			first = false;
+		}
+		json += "\n\t],\n\t\"counters\": [";
+
+		first = true;
+		for (const auto& counter : counters) {
+			const auto values = counter.values.percentiles();
+			json += std::format(
+				"{}\n\t\t{{ \"name\": \"{}\", \"last\": {}, \"p50\": {}, \"p95\": {}, \"p99\": {} }}",
+				first ? "" : ",",
+				counter.name,
+				counter.values.last(),
+				values[0],
+				values[1],
+				values[2]
+			);
+			first = false;
+		}
+		json += "\n\t]\n}\n";
+		return json;
+	}
+
+	bool dump_json(const std::filesystem::path& path) const {
+		std::ofstream file(path);
+		if (!file) {
+			return false;
+		}
+		file << to_json();
+		return true;
+	}
+};
+
+// Lives as long as the GL context, so the queries are left for the driver to clean up
+export inline Profiler profiler;
+
+/// Times the enclosing block when the profiler is enabled. The name has to outlive the profiler, so use string literals
+export class ProfileScope {
+	bool active;
+
+  public:
+	explicit ProfileScope(const std::string_view name, const bool gpu = false)
+		: active(profiler.enabled) {
+		if (active) {
+			profiler.begin_scope(name, gpu);
+		}
+	}
+
+	~ProfileScope() {
+		end();
+	}
+
+	/// Ends the scope before the end of the block, for the sections of a long function
+	void end() {
+		if (active) {
+			profiler.end_scope();
+			active = false;
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
\ No newline at end of file